@@ -13,7 +13,9 @@
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/persistent_cache.h"
 #include "leveldb/write_batch.h"
+#include "leveldb/write_buffer_manager.h"
 #include "port/port.h"
 #include "util/crc32c.h"
 #include "util/histogram.h"
@@ -43,6 +45,7 @@
 //      compact     -- Compact the entire DB
 //      stats       -- Print DB stats
 //      sstables    -- Print sstable info
+//      cachestats  -- Print block cache usage and hits per shard
 //      heapprofile -- Dump a heap profile (if supported by this port)
 static const char* FLAGS_benchmarks =
     "fillseq,"
@@ -88,6 +91,10 @@ static bool FLAGS_comparisons = false;
 // (initialized to default value by "main")
 static int FLAGS_write_buffer_size = 0;
 
+// Number of bytes all memtables may hold together, enforced by a
+// WriteBufferManager.  Negative means no write buffer manager.
+static int FLAGS_write_buffer_manager_size = -1;
+
 // Number of bytes written to each file.
 // (initialized to default value by "main")
 static int FLAGS_max_file_size = 0;
@@ -100,6 +107,35 @@ static int FLAGS_block_size = 0;
 // Negative means use default settings.
 static int FLAGS_cache_size = -1;
 
+// Block cache used when --cache_size is set: "lru" or "clock".
+static const char* FLAGS_cache_type = "lru";
+
+// Log2 of the number of LRU cache shards; negative picks one by core count.
+static int FLAGS_cache_shard_bits = 4;
+
+// If true, LRU cache inserts fail rather than exceed the capacity.
+static bool FLAGS_cache_strict_capacity = false;
+
+// If true, keep index and filter blocks in the block cache.
+static bool FLAGS_cache_index_and_filter_blocks = false;
+
+// If true, reload the blocks cached when the DB was last closed on open.
+static bool FLAGS_warm_block_cache = false;
+
+// Number of bytes to use as a cache of compressed blocks.
+// Negative means no compressed block cache.
+static int FLAGS_compressed_cache_size = -1;
+
+// If non-null, keep a persistent block cache in this directory.
+static const char* FLAGS_persistent_cache_dir = nullptr;
+
+// Number of bytes the persistent block cache may hold.
+static int FLAGS_persistent_cache_size = 256 << 20;
+
+// Number of bytes to use as a cache of point lookup results.
+// Negative means no row cache.
+static int FLAGS_row_cache_size = -1;
+
 // Maximum number of files to keep open at the same time (use default if == 0)
 static int FLAGS_open_files = 0;
 
@@ -107,6 +143,19 @@ static int FLAGS_open_files = 0;
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
 
+// Filter built when --bloom_bits is set: "bloom", "blocked" (cache-line
+// blocked bloom filter) or "ribbon".
+static const char* FLAGS_filter_type = "bloom";
+
+// If true, build one filter per table instead of one per 2KB of data.
+static bool FLAGS_full_filter = false;
+
+// If true, end each data block with a hash index for point lookups.
+static bool FLAGS_data_block_hash_index = false;
+
+// If true, do not build filters for tables on the deepest level.
+static bool FLAGS_optimize_filters_for_hits = false;
+
 // Common key prefix length.
 static int FLAGS_key_prefix = 0;
 
@@ -369,6 +418,10 @@ struct ThreadState {
 class Benchmark {
  private:
   Cache* cache_;
+  Cache* compressed_cache_;
+  Cache* row_cache_;
+  PersistentCache* persistent_cache_;
+  WriteBufferManager* write_buffer_manager_;
   const FilterPolicy* filter_policy_;
   DB* db_;
   int num_;
@@ -459,11 +512,38 @@ class Benchmark {
   }
 
  public:
+  static const FilterPolicy* NewFilterPolicy() {
+    if (strcmp(FLAGS_filter_type, "blocked") == 0) {
+      return NewBlockedBloomFilterPolicy(FLAGS_bloom_bits);
+    }
+    if (strcmp(FLAGS_filter_type, "ribbon") == 0) {
+      return NewRibbonFilterPolicy(FLAGS_bloom_bits);
+    }
+    return NewBloomFilterPolicy(FLAGS_bloom_bits);
+  }
+
+  static Cache* NewCache() {
+    if (strcmp(FLAGS_cache_type, "clock") == 0) {
+      return NewClockCache(FLAGS_cache_size, FLAGS_block_size);
+    }
+    return NewLRUCache(FLAGS_cache_size, FLAGS_cache_shard_bits,
+                       FLAGS_cache_strict_capacity);
+  }
+
   Benchmark()
-      : cache_(FLAGS_cache_size >= 0 ? NewLRUCache(FLAGS_cache_size) : nullptr),
-        filter_policy_(FLAGS_bloom_bits >= 0
-                           ? NewBloomFilterPolicy(FLAGS_bloom_bits)
-                           : nullptr),
+      : cache_(FLAGS_cache_size >= 0 ? NewCache() : nullptr),
+        compressed_cache_(FLAGS_compressed_cache_size >= 0
+                              ? NewLRUCache(FLAGS_compressed_cache_size)
+                              : nullptr),
+        row_cache_(FLAGS_row_cache_size >= 0
+                       ? NewLRUCache(FLAGS_row_cache_size)
+                       : nullptr),
+        persistent_cache_(nullptr),
+        write_buffer_manager_(
+            FLAGS_write_buffer_manager_size >= 0
+                ? new WriteBufferManager(FLAGS_write_buffer_manager_size)
+                : nullptr),
+        filter_policy_(FLAGS_bloom_bits >= 0 ? NewFilterPolicy() : nullptr),
         db_(nullptr),
         num_(FLAGS_num),
         value_size_(FLAGS_value_size),
@@ -482,11 +562,25 @@ class Benchmark {
     if (!FLAGS_use_existing_db) {
       DestroyDB(FLAGS_db, Options());
     }
+    if (FLAGS_persistent_cache_dir != nullptr) {
+      Status s = NewPersistentCache(g_env, FLAGS_persistent_cache_dir,
+                                    FLAGS_persistent_cache_size,
+                                    &persistent_cache_);
+      if (!s.ok()) {
+        std::fprintf(stderr, "persistent cache error: %s\n",
+                     s.ToString().c_str());
+        std::exit(1);
+      }
+    }
   }
 
   ~Benchmark() {
     delete db_;
     delete cache_;
+    delete compressed_cache_;
+    delete row_cache_;
+    delete persistent_cache_;
+    delete write_buffer_manager_;
     delete filter_policy_;
   }
 
@@ -582,6 +676,8 @@ class Benchmark {
         PrintStats("leveldb.stats");
       } else if (name == Slice("sstables")) {
         PrintStats("leveldb.sstables");
+      } else if (name == Slice("cachestats")) {
+        PrintCacheStats();
       } else if (name == Slice("usage")) {
         PrintStats("leveldb.approximate-memory-usage");
       } else if (name == Slice("usages")) {
@@ -766,14 +862,23 @@ class Benchmark {
     options.env = g_env;
     options.create_if_missing = !FLAGS_use_existing_db;
     options.block_cache = cache_;
+    options.compressed_block_cache = compressed_cache_;
+    options.row_cache = row_cache_;
+    options.persistent_cache = persistent_cache_;
     options.write_buffer_size = FLAGS_write_buffer_size;
+    options.write_buffer_manager = write_buffer_manager_;
     options.max_file_size = FLAGS_max_file_size;
     options.block_size = FLAGS_block_size;
     if (FLAGS_comparisons) {
       options.comparator = &count_comparator_;
     }
     options.max_open_files = FLAGS_open_files;
+    options.cache_index_and_filter_blocks = FLAGS_cache_index_and_filter_blocks;
+    options.warm_block_cache = FLAGS_warm_block_cache;
     options.filter_policy = filter_policy_;
+    options.full_filter = FLAGS_full_filter;
+    options.data_block_hash_index = FLAGS_data_block_hash_index;
+    options.optimize_filters_for_hits = FLAGS_optimize_filters_for_hits;
     options.reuse_logs = FLAGS_reuse_logs;
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
@@ -997,6 +1102,26 @@ class Benchmark {
     std::fprintf(stdout, "%s:\n%s\n", key, stats.c_str());
   }
 
+  void PrintCacheStats() {
+    if (cache_ == nullptr) {
+      std::fprintf(stdout, "cachestats: (no block cache)\n");
+      return;
+    }
+    std::fprintf(stdout, "cachestats:\n");
+    std::fprintf(stdout, "shard   capacity      usage     pinned       hits"
+                         "     misses\n");
+    for (int i = 0; i < cache_->NumShards(); i++) {
+      Cache::ShardStats stats;
+      cache_->GetShardStats(i, &stats);
+      std::fprintf(stdout, "%5d %10llu %10llu %10llu %10llu %10llu\n", i,
+                   static_cast<unsigned long long>(stats.capacity),
+                   static_cast<unsigned long long>(stats.usage),
+                   static_cast<unsigned long long>(stats.pinned_usage),
+                   static_cast<unsigned long long>(stats.hits),
+                   static_cast<unsigned long long>(stats.misses));
+    }
+  }
+
   static void WriteToFile(void* arg, const char* buf, int n) {
     reinterpret_cast<WritableFile*>(arg)->Append(Slice(buf, n));
   }
@@ -1049,6 +1174,17 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--reuse_logs=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_reuse_logs = n;
+    } else if (sscanf(argv[i], "--full_filter=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_full_filter = n;
+    } else if (sscanf(argv[i], "--data_block_hash_index=%d%c", &n, &junk) ==
+                   1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_data_block_hash_index = n;
+    } else if (sscanf(argv[i], "--optimize_filters_for_hits=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_optimize_filters_for_hits = n;
     } else if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
       FLAGS_num = n;
     } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
@@ -1059,6 +1195,9 @@ int main(int argc, char** argv) {
       FLAGS_value_size = n;
     } else if (sscanf(argv[i], "--write_buffer_size=%d%c", &n, &junk) == 1) {
       FLAGS_write_buffer_size = n;
+    } else if (sscanf(argv[i], "--write_buffer_manager_size=%d%c", &n,
+                      &junk) == 1) {
+      FLAGS_write_buffer_manager_size = n;
     } else if (sscanf(argv[i], "--max_file_size=%d%c", &n, &junk) == 1) {
       FLAGS_max_file_size = n;
     } else if (sscanf(argv[i], "--block_size=%d%c", &n, &junk) == 1) {
@@ -1067,10 +1206,37 @@ int main(int argc, char** argv) {
       FLAGS_key_prefix = n;
     } else if (sscanf(argv[i], "--cache_size=%d%c", &n, &junk) == 1) {
       FLAGS_cache_size = n;
+    } else if (sscanf(argv[i], "--cache_shard_bits=%d%c", &n, &junk) == 1) {
+      FLAGS_cache_shard_bits = n;
+    } else if (sscanf(argv[i], "--cache_strict_capacity=%d%c", &n, &junk) ==
+                   1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_cache_strict_capacity = n;
+    } else if (sscanf(argv[i], "--cache_index_and_filter_blocks=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_cache_index_and_filter_blocks = n;
+    } else if (sscanf(argv[i], "--warm_block_cache=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_warm_block_cache = n;
+    } else if (sscanf(argv[i], "--compressed_cache_size=%d%c", &n, &junk) ==
+               1) {
+      FLAGS_compressed_cache_size = n;
+    } else if (sscanf(argv[i], "--persistent_cache_size=%d%c", &n, &junk) ==
+               1) {
+      FLAGS_persistent_cache_size = n;
+    } else if (sscanf(argv[i], "--row_cache_size=%d%c", &n, &junk) == 1) {
+      FLAGS_row_cache_size = n;
     } else if (sscanf(argv[i], "--bloom_bits=%d%c", &n, &junk) == 1) {
       FLAGS_bloom_bits = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
+    } else if (strncmp(argv[i], "--filter_type=", 14) == 0) {
+      FLAGS_filter_type = argv[i] + 14;
+    } else if (strncmp(argv[i], "--cache_type=", 13) == 0) {
+      FLAGS_cache_type = argv[i] + 13;
+    } else if (strncmp(argv[i], "--persistent_cache_dir=", 23) == 0) {
+      FLAGS_persistent_cache_dir = argv[i] + 23;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
       FLAGS_db = argv[i] + 5;
     } else {
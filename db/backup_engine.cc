@@ -0,0 +1,694 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// The backup directory holds
+//
+//    shared/<number>_<size>_<crc32c>.<ext>
+//                                   table files, shared by every backup
+//                                   holding them
+//    private/<id>/                  the logs and MANIFEST of each backup
+//    meta/<id>                      the files of each backup
+//
+// A meta file is a line with the creation time followed by one line per
+// file, "<path> <size> <crc32c>", with paths relative to the backup
+// directory.  It is written last, so a backup exists once its meta file
+// does; shared and private files no meta file lists are left over from a
+// backup that failed, and are removed.
+
+#include "leveldb/backup_engine.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <set>
+
+#include "db/filename.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/crc32c.h"
+#include "util/logging.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+BackupEngineOptions::BackupEngineOptions() : env(Env::Default()) {}
+
+BackupEngine::~BackupEngine() = default;
+
+// A utility routine: write "data" to the named file and Sync() it.
+Status WriteStringToFileSync(Env* env, const Slice& data,
+                             const std::string& fname);
+
+namespace {
+
+const size_t kCopyBufferSize = 64 * 1024;
+
+// Holds the copying of all threads together to a rate.
+class RateLimiter {
+ public:
+  RateLimiter(Env* env, uint64_t bytes_per_second)
+      : env_(env), bytes_per_second_(bytes_per_second), next_micros_(0) {}
+
+  // Wait until "bytes" more may be copied.
+  void Request(size_t bytes) {
+    if (bytes_per_second_ == 0) {
+      return;
+    }
+    uint64_t wait;
+    {
+      MutexLock l(&mutex_);
+      const uint64_t now = env_->NowMicros();
+      next_micros_ = std::max(next_micros_, now);
+      wait = next_micros_ - now;
+      next_micros_ += bytes * 1000000 / bytes_per_second_;
+    }
+    if (wait > 0) {
+      env_->SleepForMicroseconds(
+          static_cast<int>(std::min<uint64_t>(wait, INT_MAX)));
+    }
+  }
+
+ private:
+  Env* const env_;
+  const uint64_t bytes_per_second_;
+  port::Mutex mutex_;
+  uint64_t next_micros_ GUARDED_BY(mutex_);
+};
+
+struct BackupFile {
+  std::string path;  // Relative to the backup directory
+  uint64_t size;
+  uint32_t crc;
+};
+
+struct BackupMeta {
+  int64_t timestamp;
+  std::vector<BackupFile> files;
+};
+
+// Reads the first "size" bytes of "src", and writes them to "dst" unless
+// it is empty.  Fills "crc" with their crc32c.
+struct CopyJob {
+  std::string src;
+  std::string dst;
+  uint64_t size;
+  uint32_t crc;
+};
+
+Status RunCopyJob(Env* env, RateLimiter* limiter, CopyJob* job) {
+  SequentialFile* in;
+  Status s = env->NewSequentialFile(job->src, &in);
+  if (!s.ok()) {
+    return s;
+  }
+  WritableFile* out = nullptr;
+  if (!job->dst.empty()) {
+    s = env->NewWritableFile(job->dst, &out);
+  }
+  char* buffer = new char[kCopyBufferSize];
+  uint32_t crc = 0;
+  uint64_t left = job->size;
+  while (s.ok() && left > 0) {
+    const size_t n = std::min<uint64_t>(left, kCopyBufferSize);
+    limiter->Request(n);
+    Slice fragment;
+    s = in->Read(n, &fragment, buffer);
+    if (s.ok() && fragment.empty()) {
+      s = Status::Corruption("file shorter than expected", job->src);
+    }
+    if (s.ok()) {
+      crc = crc32c::Extend(crc, fragment.data(), fragment.size());
+      left -= fragment.size();
+      if (out != nullptr) {
+        s = out->Append(fragment);
+      }
+    }
+  }
+  delete[] buffer;
+  delete in;
+  if (out != nullptr) {
+    if (s.ok()) {
+      s = out->Sync();
+    }
+    if (s.ok()) {
+      s = out->Close();
+    }
+    delete out;
+  }
+  job->crc = crc;
+  return s;
+}
+
+// Shared by the threads running a set of copy jobs.
+struct CopyJobQueue {
+  explicit CopyJobQueue(Env* e, RateLimiter* l, std::vector<CopyJob>* j)
+      : env(e), limiter(l), jobs(j), done_cv(&mu), next(0), running(0) {}
+
+  Env* const env;
+  RateLimiter* const limiter;
+  std::vector<CopyJob>* const jobs;
+  port::Mutex mu;
+  port::CondVar done_cv;
+  size_t next GUARDED_BY(mu);
+  int running GUARDED_BY(mu);
+  Status status GUARDED_BY(mu);  // First error of any job
+};
+
+void CopyThread(void* arg) {
+  CopyJobQueue* queue = reinterpret_cast<CopyJobQueue*>(arg);
+  queue->mu.Lock();
+  while (queue->status.ok() && queue->next < queue->jobs->size()) {
+    CopyJob* job = &(*queue->jobs)[queue->next++];
+    queue->mu.Unlock();
+    Status s = RunCopyJob(queue->env, queue->limiter, job);
+    queue->mu.Lock();
+    if (queue->status.ok()) {
+      queue->status = s;
+    }
+  }
+  queue->running--;
+  queue->done_cv.SignalAll();
+  queue->mu.Unlock();
+}
+
+std::string MetaPath(uint32_t backup_id) {
+  std::string path = "meta/";
+  AppendNumberTo(&path, backup_id);
+  return path;
+}
+
+std::string PrivateDir(uint32_t backup_id) {
+  std::string path = "private/";
+  AppendNumberTo(&path, backup_id);
+  return path;
+}
+
+// Returns the path in the shared directory of the table file "name" of
+// "size" bytes with checksum "crc", or an empty string if "name" is not a
+// table file name.
+std::string SharedPath(const std::string& name, uint64_t size, uint32_t crc) {
+  uint64_t number;
+  FileType type;
+  if (!ParseFileName(name, &number, &type) || type != kTableFile) {
+    return std::string();
+  }
+  std::string path = "shared/";
+  AppendNumberTo(&path, number);
+  path.push_back('_');
+  AppendNumberTo(&path, size);
+  path.push_back('_');
+  AppendNumberTo(&path, crc);
+  path.append(name, name.find('.'), std::string::npos);
+  return path;
+}
+
+// Returns the "shared/<number>_<size>" part of a shared path.  Tables with
+// the same one may still differ: a DB restored from a backup writes new
+// tables under numbers it wrote before.
+std::string SharedKey(const std::string& path) {
+  return path.substr(0, path.find_first_of("_.", path.find('_') + 1));
+}
+
+// Returns the name in the DB directory of the backup file at "path".
+std::string DBFileName(const std::string& path) {
+  std::string name = path.substr(path.rfind('/') + 1);
+  if (path.compare(0, 7, "shared/") == 0) {
+    Slice in(name);
+    uint64_t number;
+    if (ConsumeDecimalNumber(&in, &number)) {
+      const std::string ext = name.substr(name.find('.'));
+      name = TableFileName("", number).substr(1);
+      name = name.substr(0, name.find('.')) + ext;
+    }
+  }
+  return name;
+}
+
+std::string EncodeMeta(const BackupMeta& meta) {
+  std::string contents;
+  AppendNumberTo(&contents, static_cast<uint64_t>(meta.timestamp));
+  contents.push_back('\n');
+  for (const BackupFile& file : meta.files) {
+    contents.append(file.path);
+    contents.push_back(' ');
+    AppendNumberTo(&contents, file.size);
+    contents.push_back(' ');
+    AppendNumberTo(&contents, file.crc);
+    contents.push_back('\n');
+  }
+  return contents;
+}
+
+bool DecodeMeta(Slice in, BackupMeta* meta) {
+  uint64_t timestamp;
+  if (!ConsumeDecimalNumber(&in, &timestamp) || !in.starts_with("\n")) {
+    return false;
+  }
+  meta->timestamp = static_cast<int64_t>(timestamp);
+  in.remove_prefix(1);
+  meta->files.clear();
+  while (!in.empty()) {
+    const char* space = static_cast<const char*>(
+        memchr(in.data(), ' ', in.size()));
+    if (space == nullptr) {
+      return false;
+    }
+    BackupFile file;
+    file.path.assign(in.data(), space - in.data());
+    in.remove_prefix(space - in.data() + 1);
+    uint64_t crc;
+    if (!ConsumeDecimalNumber(&in, &file.size) || !in.starts_with(" ")) {
+      return false;
+    }
+    in.remove_prefix(1);
+    if (!ConsumeDecimalNumber(&in, &crc) || !in.starts_with("\n")) {
+      return false;
+    }
+    in.remove_prefix(1);
+    file.crc = static_cast<uint32_t>(crc);
+    meta->files.push_back(file);
+  }
+  return true;
+}
+
+class BackupEngineImpl : public BackupEngine {
+ public:
+  BackupEngineImpl(const BackupEngineOptions& options,
+                   const std::string& backup_dir)
+      : env_(options.env),
+        options_(options),
+        dir_(backup_dir),
+        limiter_(options.env, options.rate_limit) {}
+
+  ~BackupEngineImpl() override = default;
+
+  Status Load();
+
+  Status CreateNewBackup(DB* db, uint32_t* backup_id) override;
+  void GetBackupInfo(std::vector<BackupInfo>* infos) override;
+  Status VerifyBackup(uint32_t backup_id) override;
+  Status DeleteBackup(uint32_t backup_id) override;
+  Status PurgeOldBackups(int num_backups_to_keep) override;
+  Status RestoreDBFromBackup(uint32_t backup_id,
+                             const std::string& db_dir) override;
+  Status RestoreDBFromLatestBackup(const std::string& db_dir) override;
+
+ private:
+  // Run the jobs on up to options_.max_background_operations threads.
+  Status RunCopyJobs(std::vector<CopyJob>* jobs);
+
+  // Remove the files that no backup holds.
+  void GarbageCollect() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  Status DoCreateNewBackup(DB* db, uint32_t backup_id, BackupMeta* meta)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  Env* const env_;
+  const BackupEngineOptions options_;
+  const std::string dir_;
+  RateLimiter limiter_;
+
+  // Held for the whole of each operation.
+  port::Mutex mutex_;
+  std::map<uint32_t, BackupMeta> backups_ GUARDED_BY(mutex_);
+};
+
+Status BackupEngineImpl::RunCopyJobs(std::vector<CopyJob>* jobs) {
+  CopyJobQueue queue(env_, &limiter_, jobs);
+  const int threads = static_cast<int>(std::min<size_t>(
+      std::max(options_.max_background_operations, 1), jobs->size()));
+  if (threads == 0) {
+    return Status::OK();
+  }
+  queue.mu.Lock();
+  queue.running = threads;
+  queue.mu.Unlock();
+  for (int i = 1; i < threads; i++) {
+    env_->StartThread(&CopyThread, &queue);
+  }
+  CopyThread(&queue);  // The calling thread is one of them
+
+  MutexLock l(&queue.mu);
+  while (queue.running > 0) {
+    queue.done_cv.Wait();
+  }
+  return queue.status;
+}
+
+Status BackupEngineImpl::Load() {
+  env_->CreateDir(dir_);
+  env_->CreateDir(dir_ + "/shared");
+  env_->CreateDir(dir_ + "/private");
+  env_->CreateDir(dir_ + "/meta");
+
+  MutexLock l(&mutex_);
+  std::vector<std::string> filenames;
+  Status s = env_->GetChildren(dir_ + "/meta", &filenames);
+  for (size_t i = 0; s.ok() && i < filenames.size(); i++) {
+    Slice in(filenames[i]);
+    uint64_t backup_id;
+    if (!ConsumeDecimalNumber(&in, &backup_id) || !in.empty() ||
+        backup_id > UINT32_MAX) {
+      continue;  // Not a meta file, or one being written
+    }
+    std::string contents;
+    s = ReadFileToString(env_, dir_ + "/meta/" + filenames[i], &contents);
+    BackupMeta& meta = backups_[static_cast<uint32_t>(backup_id)];
+    if (s.ok() && !DecodeMeta(contents, &meta)) {
+      s = Status::Corruption("bad backup meta file", filenames[i]);
+    }
+  }
+  if (s.ok()) {
+    GarbageCollect();
+  }
+  return s;
+}
+
+void BackupEngineImpl::GarbageCollect() {
+  std::set<std::string> live;
+  for (const auto& backup : backups_) {
+    live.insert(MetaPath(backup.first));
+    live.insert(PrivateDir(backup.first));
+    for (const BackupFile& file : backup.second.files) {
+      live.insert(file.path);
+    }
+  }
+
+  // Ignoring errors on purpose: removal is retried on the next call.
+  std::vector<std::string> filenames;
+  for (const char* subdir : {"shared", "meta"}) {
+    env_->GetChildren(dir_ + "/" + subdir, &filenames);
+    for (const std::string& filename : filenames) {
+      const std::string path = std::string(subdir) + "/" + filename;
+      if (filename != "." && filename != ".." &&
+          live.find(path) == live.end()) {
+        env_->RemoveFile(dir_ + "/" + path);
+      }
+    }
+  }
+  std::vector<std::string> children;
+  env_->GetChildren(dir_ + "/private", &filenames);
+  for (const std::string& filename : filenames) {
+    const std::string path = "private/" + filename;
+    if (filename != "." && filename != ".." &&
+        live.find(path) == live.end()) {
+      env_->GetChildren(dir_ + "/" + path, &children);
+      for (const std::string& child : children) {
+        if (child != "." && child != "..") {
+          env_->RemoveFile(dir_ + "/" + path + "/" + child);
+        }
+      }
+      env_->RemoveDir(dir_ + "/" + path);
+    }
+  }
+}
+
+Status BackupEngineImpl::CreateNewBackup(DB* db, uint32_t* backup_id) {
+  MutexLock l(&mutex_);
+  const uint32_t id = backups_.empty() ? 1 : backups_.rbegin()->first + 1;
+  BackupMeta meta;
+  Status s = DoCreateNewBackup(db, id, &meta);
+  if (s.ok()) {
+    backups_[id] = meta;
+    if (backup_id != nullptr) {
+      *backup_id = id;
+    }
+  } else {
+    GarbageCollect();
+  }
+  return s;
+}
+
+Status BackupEngineImpl::DoCreateNewBackup(DB* db, uint32_t backup_id,
+                                           BackupMeta* meta) {
+  meta->timestamp = static_cast<int64_t>(env_->NowMicros() / 1000000);
+  const std::string private_dir = PrivateDir(backup_id);
+  Status s = env_->CreateDir(dir_ + "/" + private_dir);
+  if (!s.ok()) {
+    return s;
+  }
+
+  // Tables already held by an earlier backup are not copied again.  They
+  // are looked up by number and size, and only reused if their checksums
+  // match too.
+  std::map<std::string, std::vector<const BackupFile*>> shared;
+  for (const auto& backup : backups_) {
+    for (const BackupFile& file : backup.second.files) {
+      if (file.path.compare(0, 7, "shared/") == 0) {
+        shared[SharedKey(file.path)].push_back(&file);
+      }
+    }
+  }
+
+  db->DisableFileDeletions();
+  LiveFiles live;
+  s = db->GetLiveFiles(&live);
+
+  // Checksum the tables that may be held already.
+  std::vector<CopyJob> checks;
+  for (size_t i = 0; s.ok() && i < live.tables.size(); i++) {
+    const LiveFiles::File& table = live.tables[i];
+    const std::string key = SharedKey(SharedPath(table.name, table.size, 0));
+    if (shared.find(key) != shared.end()) {
+      CopyJob job;
+      job.src = live.dir + "/" + table.name;
+      job.size = table.size;
+      checks.push_back(job);
+    }
+  }
+  if (s.ok()) {
+    s = RunCopyJobs(&checks);
+  }
+
+  // Copy the others.  A table is copied under a temporary name, and named
+  // once its checksum is known.
+  std::vector<CopyJob> jobs;
+  std::vector<size_t> job_files;  // Index in meta->files of each job's file
+  size_t next_check = 0;
+  for (size_t i = 0; s.ok() && i < live.tables.size(); i++) {
+    const LiveFiles::File& table = live.tables[i];
+    const std::string path = SharedPath(table.name, table.size, 0);
+    auto it = shared.find(SharedKey(path));
+    const BackupFile* held = nullptr;
+    if (it != shared.end()) {
+      const uint32_t crc = checks[next_check++].crc;
+      for (const BackupFile* file : it->second) {
+        if (file->crc == crc) {
+          held = file;
+        }
+      }
+    }
+    if (held != nullptr) {
+      meta->files.push_back(*held);
+    } else {
+      CopyJob job;
+      job.src = live.dir + "/" + table.name;
+      job.dst = dir_ + "/" + SharedKey(path) + ".tmp";
+      job.size = table.size;
+      jobs.push_back(job);
+      job_files.push_back(meta->files.size());
+      meta->files.push_back(BackupFile{table.name, table.size, 0});
+    }
+  }
+  for (const LiveFiles::File& log : live.logs) {
+    const std::string path = private_dir + "/" + log.name;
+    CopyJob job;
+    job.src = live.dir + "/" + log.name;
+    job.dst = dir_ + "/" + path;
+    job.size = log.size;
+    jobs.push_back(job);
+    job_files.push_back(meta->files.size());
+    meta->files.push_back(BackupFile{path, log.size, 0});
+  }
+  if (s.ok()) {
+    s = RunCopyJobs(&jobs);
+  }
+  db->EnableFileDeletions();
+
+  // Fill in the checksums computed while copying, and name the tables.
+  for (size_t i = 0; s.ok() && i < jobs.size(); i++) {
+    BackupFile& file = meta->files[job_files[i]];
+    file.crc = jobs[i].crc;
+    const std::string path = SharedPath(file.path, file.size, file.crc);
+    if (!path.empty()) {
+      file.path = path;
+      s = env_->RenameFile(jobs[i].dst, dir_ + "/" + path);
+    }
+  }
+  if (!s.ok()) {
+    return s;
+  }
+
+  const std::string manifest_path = private_dir + "/" + live.manifest_name;
+  s = WriteStringToFileSync(env_, live.manifest, dir_ + "/" + manifest_path);
+  meta->files.push_back(BackupFile{
+      manifest_path, live.manifest.size(),
+      crc32c::Value(live.manifest.data(), live.manifest.size())});
+
+  const std::string meta_fname = dir_ + "/" + MetaPath(backup_id);
+  if (s.ok()) {
+    s = WriteStringToFileSync(env_, EncodeMeta(*meta), meta_fname + ".tmp");
+  }
+  if (s.ok()) {
+    s = env_->RenameFile(meta_fname + ".tmp", meta_fname);
+  }
+  return s;
+}
+
+void BackupEngineImpl::GetBackupInfo(std::vector<BackupInfo>* infos) {
+  MutexLock l(&mutex_);
+  infos->clear();
+  for (const auto& backup : backups_) {
+    BackupInfo info;
+    info.backup_id = backup.first;
+    info.timestamp = backup.second.timestamp;
+    info.size = 0;
+    for (const BackupFile& file : backup.second.files) {
+      info.size += file.size;
+    }
+    info.number_files = static_cast<uint32_t>(backup.second.files.size());
+    infos->push_back(info);
+  }
+}
+
+Status BackupEngineImpl::VerifyBackup(uint32_t backup_id) {
+  MutexLock l(&mutex_);
+  auto it = backups_.find(backup_id);
+  if (it == backups_.end()) {
+    return Status::NotFound("backup not found");
+  }
+  std::vector<CopyJob> jobs;
+  for (const BackupFile& file : it->second.files) {
+    const std::string fname = dir_ + "/" + file.path;
+    uint64_t size;
+    Status s = env_->GetFileSize(fname, &size);
+    if (s.ok() && size != file.size) {
+      s = Status::Corruption("file size mismatch", fname);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    CopyJob job;
+    job.src = fname;
+    job.size = file.size;
+    jobs.push_back(job);
+  }
+  Status s = RunCopyJobs(&jobs);
+  for (size_t i = 0; s.ok() && i < jobs.size(); i++) {
+    if (jobs[i].crc != it->second.files[i].crc) {
+      s = Status::Corruption("checksum mismatch", jobs[i].src);
+    }
+  }
+  return s;
+}
+
+Status BackupEngineImpl::DeleteBackup(uint32_t backup_id) {
+  MutexLock l(&mutex_);
+  if (backups_.find(backup_id) == backups_.end()) {
+    return Status::NotFound("backup not found");
+  }
+  Status s = env_->RemoveFile(dir_ + "/" + MetaPath(backup_id));
+  if (s.ok()) {
+    backups_.erase(backup_id);
+    GarbageCollect();
+  }
+  return s;
+}
+
+Status BackupEngineImpl::PurgeOldBackups(int num_backups_to_keep) {
+  MutexLock l(&mutex_);
+  Status s;
+  while (s.ok() && static_cast<int>(backups_.size()) >
+                       std::max(num_backups_to_keep, 0)) {
+    const uint32_t oldest = backups_.begin()->first;
+    s = env_->RemoveFile(dir_ + "/" + MetaPath(oldest));
+    if (s.ok()) {
+      backups_.erase(oldest);
+    }
+  }
+  GarbageCollect();
+  return s;
+}
+
+Status BackupEngineImpl::RestoreDBFromBackup(uint32_t backup_id,
+                                             const std::string& db_dir) {
+  MutexLock l(&mutex_);
+  auto it = backups_.find(backup_id);
+  if (it == backups_.end()) {
+    return Status::NotFound("backup not found");
+  }
+
+  env_->CreateDir(db_dir);
+  std::vector<std::string> filenames;
+  Status s = env_->GetChildren(db_dir, &filenames);
+  uint64_t number;
+  FileType type;
+  for (size_t i = 0; s.ok() && i < filenames.size(); i++) {
+    if (ParseFileName(filenames[i], &number, &type) && type != kDBLockFile) {
+      s = env_->RemoveFile(db_dir + "/" + filenames[i]);
+    }
+  }
+
+  std::vector<CopyJob> jobs;
+  uint64_t manifest_number = 0;
+  for (const BackupFile& file : it->second.files) {
+    const std::string name = DBFileName(file.path);
+    if (ParseFileName(name, &number, &type) && type == kDescriptorFile) {
+      manifest_number = number;
+    }
+    CopyJob job;
+    job.src = dir_ + "/" + file.path;
+    job.dst = db_dir + "/" + name;
+    job.size = file.size;
+    jobs.push_back(job);
+  }
+  if (s.ok() && manifest_number == 0) {
+    s = Status::Corruption("backup has no MANIFEST");
+  }
+  if (s.ok()) {
+    s = RunCopyJobs(&jobs);
+  }
+  for (size_t i = 0; s.ok() && i < jobs.size(); i++) {
+    if (jobs[i].crc != it->second.files[i].crc) {
+      s = Status::Corruption("checksum mismatch", jobs[i].src);
+    }
+  }
+  if (s.ok()) {
+    s = SetCurrentFile(env_, db_dir, manifest_number);
+  }
+  return s;
+}
+
+Status BackupEngineImpl::RestoreDBFromLatestBackup(const std::string& db_dir) {
+  uint32_t latest;
+  {
+    MutexLock l(&mutex_);
+    if (backups_.empty()) {
+      return Status::NotFound("no backups");
+    }
+    latest = backups_.rbegin()->first;
+  }
+  return RestoreDBFromBackup(latest, db_dir);
+}
+
+}  // namespace
+
+Status BackupEngine::Open(const BackupEngineOptions& options,
+                          const std::string& backup_dir,
+                          BackupEngine** result) {
+  *result = nullptr;
+  BackupEngineImpl* impl = new BackupEngineImpl(options, backup_dir);
+  Status s = impl->Load();
+  if (s.ok()) {
+    *result = impl;
+  } else {
+    delete impl;
+  }
+  return s;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,258 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/backup_engine.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+static std::string Key(int i) {
+  char buf[100];
+  std::snprintf(buf, sizeof(buf), "key%06d", i);
+  return std::string(buf);
+}
+
+class BackupEngineTest : public testing::Test {
+ public:
+  BackupEngineTest() : env_(Env::Default()), db_(nullptr), engine_(nullptr) {
+    dbname_ = testing::TempDir() + "backup_engine_db";
+    backup_dir_ = testing::TempDir() + "backup_engine_backups";
+    restore_dir_ = testing::TempDir() + "backup_engine_restore";
+    DestroyDB(dbname_, Options());
+    DestroyDB(restore_dir_, Options());
+    DestroyBackupDir();
+    Options options;
+    options.create_if_missing = true;
+    EXPECT_LEVELDB_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  ~BackupEngineTest() {
+    delete engine_;
+    delete db_;
+    DestroyDB(dbname_, Options());
+    DestroyDB(restore_dir_, Options());
+    DestroyBackupDir();
+  }
+
+  void DestroyBackupDir() {
+    std::vector<std::string> subdirs = {"shared", "meta"};
+    std::vector<std::string> children;
+    env_->GetChildren(backup_dir_ + "/private", &children);
+    for (const std::string& child : children) {
+      if (child != "." && child != "..") {
+        subdirs.push_back("private/" + child);
+      }
+    }
+    subdirs.push_back("private");
+    for (const std::string& subdir : subdirs) {
+      const std::string dir = backup_dir_ + "/" + subdir;
+      env_->GetChildren(dir, &children);
+      for (const std::string& child : children) {
+        env_->RemoveFile(dir + "/" + child);
+      }
+      env_->RemoveDir(dir);
+    }
+    env_->RemoveDir(backup_dir_);
+  }
+
+  void OpenEngine(const BackupEngineOptions& options = BackupEngineOptions()) {
+    delete engine_;
+    engine_ = nullptr;
+    ASSERT_LEVELDB_OK(BackupEngine::Open(options, backup_dir_, &engine_));
+  }
+
+  void Fill(int from, int to, const std::string& value) {
+    for (int i = from; i < to; i++) {
+      ASSERT_LEVELDB_OK(db_->Put(WriteOptions(), Key(i), value));
+    }
+  }
+
+  int CountSharedFiles() {
+    std::vector<std::string> children;
+    EXPECT_LEVELDB_OK(env_->GetChildren(backup_dir_ + "/shared", &children));
+    int count = 0;
+    for (const std::string& child : children) {
+      if (child != "." && child != "..") {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  // Returns "from..to=value" if the restored DB holds exactly keys
+  // [from,to) with that value, or a description of the first difference.
+  std::string CheckRestored(int from, int to, const std::string& value) {
+    DB* db;
+    Status s = DB::Open(Options(), restore_dir_, &db);
+    if (!s.ok()) {
+      return s.ToString();
+    }
+    std::string result;
+    Iterator* iter = db->NewIterator(ReadOptions());
+    int i = from;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      if (i >= to || iter->key() != Key(i) || iter->value() != value) {
+        result = "unexpected " + iter->key().ToString();
+        break;
+      }
+    }
+    if (result.empty() && i != to) {
+      result = "missing " + Key(i);
+    }
+    delete iter;
+    delete db;
+    return result.empty() ? "ok" : result;
+  }
+
+  Env* env_;
+  std::string dbname_;
+  std::string backup_dir_;
+  std::string restore_dir_;
+  DB* db_;
+  BackupEngine* engine_;
+};
+
+TEST_F(BackupEngineTest, BackupAndRestore) {
+  OpenEngine();
+  Fill(0, 1000, std::string(100, 'a'));
+  db_->CompactRange(nullptr, nullptr);
+  Fill(1000, 1100, std::string(100, 'a'));  // Only in the log
+  uint32_t id1;
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, &id1));
+
+  Fill(0, 1100, std::string(100, 'b'));
+  uint32_t id2;
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, &id2));
+  ASSERT_NE(id1, id2);
+
+  std::vector<BackupInfo> infos;
+  engine_->GetBackupInfo(&infos);
+  ASSERT_EQ(2, infos.size());
+  ASSERT_EQ(id1, infos[0].backup_id);
+  ASSERT_EQ(id2, infos[1].backup_id);
+  ASSERT_GT(infos[0].size, 0);
+  ASSERT_LEVELDB_OK(engine_->VerifyBackup(id1));
+  ASSERT_LEVELDB_OK(engine_->VerifyBackup(id2));
+
+  ASSERT_LEVELDB_OK(engine_->RestoreDBFromBackup(id1, restore_dir_));
+  ASSERT_EQ("ok", CheckRestored(0, 1100, std::string(100, 'a')));
+  ASSERT_LEVELDB_OK(engine_->RestoreDBFromLatestBackup(restore_dir_));
+  ASSERT_EQ("ok", CheckRestored(0, 1100, std::string(100, 'b')));
+
+  // Backups survive reopening the engine.
+  OpenEngine();
+  engine_->GetBackupInfo(&infos);
+  ASSERT_EQ(2, infos.size());
+  ASSERT_LEVELDB_OK(engine_->RestoreDBFromBackup(id1, restore_dir_));
+  ASSERT_EQ("ok", CheckRestored(0, 1100, std::string(100, 'a')));
+}
+
+TEST_F(BackupEngineTest, SharesTables) {
+  OpenEngine();
+  Fill(0, 1000, std::string(100, 'a'));
+  db_->CompactRange(nullptr, nullptr);
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, nullptr));
+  const int shared = CountSharedFiles();
+  ASSERT_GT(shared, 0);
+
+  // Unchanged tables are not copied again.
+  Fill(1000, 1010, std::string(100, 'a'));
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, nullptr));
+  ASSERT_EQ(shared, CountSharedFiles());
+
+  // Tables only the purged backups hold are removed.
+  Fill(0, 1010, std::string(100, 'b'));
+  db_->CompactRange(nullptr, nullptr);
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, nullptr));
+  ASSERT_GT(CountSharedFiles(), shared);
+  ASSERT_LEVELDB_OK(engine_->PurgeOldBackups(1));
+  std::vector<BackupInfo> infos;
+  engine_->GetBackupInfo(&infos);
+  ASSERT_EQ(1, infos.size());
+  ASSERT_LE(CountSharedFiles(), shared);
+  ASSERT_LEVELDB_OK(engine_->RestoreDBFromLatestBackup(restore_dir_));
+  ASSERT_EQ("ok", CheckRestored(0, 1010, std::string(100, 'b')));
+}
+
+TEST_F(BackupEngineTest, BackupAfterRestore) {
+  OpenEngine();
+  Fill(0, 1000, std::string(100, 'a'));
+  db_->CompactRange(nullptr, nullptr);
+  uint32_t id1;
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, &id1));
+  delete db_;
+  db_ = nullptr;
+  ASSERT_LEVELDB_OK(engine_->RestoreDBFromBackup(id1, dbname_));
+  ASSERT_LEVELDB_OK(DB::Open(Options(), dbname_, &db_));
+  Fill(0, 1000, std::string(100, 'b'));
+  db_->CompactRange(nullptr, nullptr);
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, nullptr));
+
+  // Restoring the first backup again and repeating the writes with other
+  // values produces tables with the numbers and sizes the second backup
+  // holds.
+  delete db_;
+  db_ = nullptr;
+  ASSERT_LEVELDB_OK(engine_->RestoreDBFromBackup(id1, dbname_));
+  ASSERT_LEVELDB_OK(DB::Open(Options(), dbname_, &db_));
+  Fill(0, 1000, std::string(100, 'c'));
+  db_->CompactRange(nullptr, nullptr);
+  uint32_t id3;
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, &id3));
+  ASSERT_LEVELDB_OK(engine_->VerifyBackup(id3));
+  ASSERT_LEVELDB_OK(engine_->RestoreDBFromBackup(id3, restore_dir_));
+  ASSERT_EQ("ok", CheckRestored(0, 1000, std::string(100, 'c')));
+}
+
+TEST_F(BackupEngineTest, DetectsCorruption) {
+  OpenEngine();
+  Fill(0, 1000, std::string(100, 'a'));
+  db_->CompactRange(nullptr, nullptr);
+  uint32_t id;
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, &id));
+
+  std::vector<std::string> children;
+  ASSERT_LEVELDB_OK(env_->GetChildren(backup_dir_ + "/shared", &children));
+  std::string table;
+  for (const std::string& child : children) {
+    if (child != "." && child != "..") {
+      table = backup_dir_ + "/shared/" + child;
+    }
+  }
+  ASSERT_TRUE(!table.empty());
+  std::string contents;
+  ASSERT_LEVELDB_OK(ReadFileToString(env_, table, &contents));
+  contents[contents.size() / 2] ^= 0x40;
+  ASSERT_LEVELDB_OK(WriteStringToFile(env_, contents, table));
+
+  ASSERT_TRUE(engine_->VerifyBackup(id).IsCorruption());
+  ASSERT_TRUE(engine_->RestoreDBFromBackup(id, restore_dir_).IsCorruption());
+}
+
+TEST_F(BackupEngineTest, ParallelThrottledCopy) {
+  BackupEngineOptions options;
+  options.max_background_operations = 4;
+  options.rate_limit = 20 << 20;
+  OpenEngine(options);
+  for (int i = 0; i < 5; i++) {
+    Fill(i * 1000, (i + 1) * 1000, std::string(100, 'a'));
+    db_->CompactRange(nullptr, nullptr);
+  }
+  ASSERT_LEVELDB_OK(engine_->CreateNewBackup(db_, nullptr));
+  ASSERT_LEVELDB_OK(engine_->RestoreDBFromLatestBackup(restore_dir_));
+  ASSERT_EQ("ok", CheckRestored(0, 5000, std::string(100, 'a')));
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -8,6 +8,8 @@
 #include <atomic>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
@@ -27,6 +29,7 @@
 #include "leveldb/status.h"
 #include "leveldb/table.h"
 #include "leveldb/table_builder.h"
+#include "leveldb/write_buffer_manager.h"
 #include "port/port.h"
 #include "table/block.h"
 #include "table/merger.h"
@@ -68,7 +71,9 @@ struct DBImpl::CompactionState {
         smallest_snapshot(0),
         outfile(nullptr),
         builder(nullptr),
-        total_bytes(0) {}
+        filter_policy(nullptr),
+        total_bytes(0),
+        job(nullptr) {}
 
   Compaction* const compaction;
 
@@ -84,7 +89,90 @@ struct DBImpl::CompactionState {
   WritableFile* outfile;
   TableBuilder* builder;
 
+  // Filter policy for every output file of this compaction
+  const FilterPolicy* filter_policy;
+
   uint64_t total_bytes;
+
+  // Set when run by DB::CompactRangeAsync(), whose cancellation stops it
+  // between output files.
+  CompactionJobImpl* job;
+};
+
+// A CompactionJob runs on a thread of its own, compacting one level after
+// another the way CompactRange() does.  Its progress is guarded by its own
+// mutex so that it can still be read once the DB is gone; where both are
+// held, DBImpl::mutex_ is acquired first.
+class DBImpl::CompactionJobImpl : public CompactionJob {
+ public:
+  CompactionJobImpl(DBImpl* db, const CompactRangeOptions& options,
+                    const Slice* begin, const Slice* end)
+      : db_(db),
+        options_(options),
+        has_begin_(begin != nullptr),
+        has_end_(end != nullptr),
+        begin_(has_begin_ ? begin->ToString() : std::string()),
+        end_(has_end_ ? end->ToString() : std::string()),
+        cancelled_(false),
+        done_cv_(&mu_),
+        done_(false),
+        level_(options.start_level),
+        total_bytes_(0) {}
+
+  ~CompactionJobImpl() override {
+    Cancel();
+    Wait();
+  }
+
+  void GetProgress(CompactionProgress* progress) override {
+    MutexLock l(&mu_);
+    progress->bytes_read = stats_.bytes_read;
+    progress->bytes_written = stats_.bytes_written;
+    progress->total_bytes = total_bytes_;
+    progress->level = level_;
+    progress->done = done_;
+  }
+
+  void Cancel() override { cancelled_.store(true, std::memory_order_release); }
+
+  Status Wait() override {
+    MutexLock l(&mu_);
+    while (!done_) {
+      done_cv_.Wait();
+    }
+    return status_;
+  }
+
+  bool cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+  // Called as each of its compactions finishes.
+  void AddStats(const CompactionStats& stats) {
+    MutexLock l(&mu_);
+    stats_.Add(stats);
+  }
+
+  static void RunThread(void* job) {
+    reinterpret_cast<CompactionJobImpl*>(job)->Run();
+  }
+
+ private:
+  void Run();
+
+  DBImpl* const db_;
+  const CompactRangeOptions options_;
+  const bool has_begin_;
+  const bool has_end_;
+  const std::string begin_;
+  const std::string end_;
+  std::atomic<bool> cancelled_;
+
+  port::Mutex mu_;
+  port::CondVar done_cv_ GUARDED_BY(mu_);
+  bool done_ GUARDED_BY(mu_);
+  Status status_ GUARDED_BY(mu_);
+  int level_ GUARDED_BY(mu_);
+  uint64_t total_bytes_ GUARDED_BY(mu_);
+  CompactionStats stats_ GUARDED_BY(mu_);
 };
 
 // Fix user-supplied options to be reasonable
@@ -146,20 +234,41 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       log_(nullptr),
       seed_(0),
       tmp_batch_(new WriteBatch),
+      write_buffer_usage_(0),
+      mutable_write_buffer_usage_(0),
       background_compaction_scheduled_(false),
+      warming_block_cache_(false),
+      file_deletions_disabled_(0),
       manual_compaction_(nullptr),
       versions_(new VersionSet(dbname_, &options_, table_cache_,
-                               &internal_comparator_)) {}
+                               &internal_comparator_)) {
+  for (const FilterPolicy* policy : raw_options.level_filter_policies) {
+    internal_level_filter_policies_.emplace_back(policy);
+  }
+}
 
 DBImpl::~DBImpl() {
+  // Keep the write buffer manager from flushing this DB from now on.
+  if (options_.write_buffer_manager != nullptr) {
+    options_.write_buffer_manager->Unregister(this);
+  }
+
   // Wait for background work to finish.
   mutex_.Lock();
   shutting_down_.store(true, std::memory_order_release);
-  while (background_compaction_scheduled_) {
+  while (background_compaction_scheduled_ || warming_block_cache_) {
     background_work_finished_signal_.Wait();
   }
+  if (options_.write_buffer_manager != nullptr) {
+    options_.write_buffer_manager->UpdateUsage(
+        write_buffer_usage_, 0, mutable_write_buffer_usage_.load(), 0);
+  }
   mutex_.Unlock();
 
+  if (options_.warm_block_cache && db_lock_ != nullptr) {
+    SaveBlockCacheManifest();  // Ignore error: the next open starts cold
+  }
+
   if (db_lock_ != nullptr) {
     env_->UnlockFile(db_lock_);
   }
@@ -232,6 +341,10 @@ void DBImpl::RemoveObsoleteFiles() {
     // or may not have been committed, so we cannot safely garbage collect.
     return;
   }
+  if (file_deletions_disabled_ > 0) {
+    // Files are being copied; EnableFileDeletions() catches up.
+    return;
+  }
 
   // Make a set of all of the live files
   std::set<uint64_t> live = pending_outputs_;
@@ -266,6 +379,7 @@ void DBImpl::RemoveObsoleteFiles() {
         case kCurrentFile:
         case kDBLockFile:
         case kInfoLogFile:
+        case kBlockCacheFile:
           keep = true;
           break;
       }
@@ -515,10 +629,15 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
   Log(options_.info_log, "Level-0 table #%llu: started",
       (unsigned long long)meta.number);
 
+  // The final level is only picked once the table is built; it is never
+  // deeper than config::kMaxMemCompactLevel, so use the level-0 filter.
+  Options options = options_;
+  options.filter_policy = FilterPolicyForLevel(0, false);
+
   Status s;
   {
     mutex_.Unlock();
-    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    s = BuildTable(dbname_, env_, options, table_cache_, iter, &meta);
     mutex_.Lock();
   }
 
@@ -575,6 +694,7 @@ void DBImpl::CompactMemTable() {
     imm_->Unref();
     imm_ = nullptr;
     has_imm_.store(false, std::memory_order_release);
+    UpdateWriteBufferUsage();
     RemoveObsoleteFiles();
   } else {
     RecordBackgroundError(s);
@@ -582,15 +702,10 @@ void DBImpl::CompactMemTable() {
 }
 
 void DBImpl::CompactRange(const Slice* begin, const Slice* end) {
-  int max_level_with_files = 1;
+  int max_level_with_files;
   {
     MutexLock l(&mutex_);
-    Version* base = versions_->current();
-    for (int level = 1; level < config::kNumLevels; level++) {
-      if (base->OverlapInLevel(level, begin, end)) {
-        max_level_with_files = level;
-      }
-    }
+    max_level_with_files = MaxOverlappingLevel(begin, end);
   }
   TEST_CompactMemTable();  // TODO(sanjay): Skip if memtable does not overlap
   for (int level = 0; level < max_level_with_files; level++) {
@@ -598,8 +713,110 @@ void DBImpl::CompactRange(const Slice* begin, const Slice* end) {
   }
 }
 
+int DBImpl::MaxOverlappingLevel(const Slice* begin, const Slice* end) {
+  mutex_.AssertHeld();
+  int max_level_with_files = 1;
+  Version* base = versions_->current();
+  for (int level = 1; level < config::kNumLevels; level++) {
+    if (base->OverlapInLevel(level, begin, end)) {
+      max_level_with_files = level;
+    }
+  }
+  return max_level_with_files;
+}
+
+uint64_t DBImpl::ManualCompactionInputBytes(int level, int last_level,
+                                            const Slice* begin,
+                                            const Slice* end) {
+  mutex_.AssertHeld();
+  InternalKey begin_storage, end_storage;
+  if (begin != nullptr) {
+    begin_storage = InternalKey(*begin, kMaxSequenceNumber, kValueTypeForSeek);
+  }
+  if (end != nullptr) {
+    end_storage = InternalKey(*end, 0, static_cast<ValueType>(0));
+  }
+  Version* base = versions_->current();
+  std::vector<FileMetaData*> inputs;
+  uint64_t bytes = 0;
+  for (int l = level; l <= last_level; l++) {
+    base->GetOverlappingInputs(l, begin != nullptr ? &begin_storage : nullptr,
+                               end != nullptr ? &end_storage : nullptr,
+                               &inputs);
+    uint64_t level_bytes = 0;
+    for (FileMetaData* f : inputs) {
+      level_bytes += f->file_size;
+    }
+    // The levels in between are read once as the output level of one
+    // compaction and again as the input level of the next.
+    bytes += (l == level || l == last_level) ? level_bytes : 2 * level_bytes;
+  }
+  return bytes;
+}
+
+Status DBImpl::CompactRangeAsync(const CompactRangeOptions& options,
+                                 const Slice* begin, const Slice* end,
+                                 CompactionJob** job) {
+  *job = nullptr;
+  if (options.start_level < 0 ||
+      options.start_level + 1 >= config::kNumLevels) {
+    return Status::InvalidArgument("start_level out of range");
+  }
+  if (options.max_output_level >= config::kNumLevels ||
+      (options.max_output_level >= 0 &&
+       options.max_output_level <= options.start_level)) {
+    return Status::InvalidArgument("max_output_level out of range");
+  }
+  CompactionJobImpl* impl = new CompactionJobImpl(this, options, begin, end);
+  env_->StartThread(&CompactionJobImpl::RunThread, impl);
+  *job = impl;
+  return Status::OK();
+}
+
+void DBImpl::CompactionJobImpl::Run() {
+  const Slice begin_slice(begin_), end_slice(end_);
+  const Slice* begin = has_begin_ ? &begin_slice : nullptr;
+  const Slice* end = has_end_ ? &end_slice : nullptr;
+
+  Status s;
+  if (options_.start_level == 0) {
+    s = db_->TEST_CompactMemTable();
+  }
+  int last_level;
+  {
+    MutexLock l(&db_->mutex_);
+    last_level = db_->MaxOverlappingLevel(begin, end);
+  }
+  if (options_.max_output_level >= 0) {
+    last_level = std::min(last_level, options_.max_output_level);
+  }
+  for (int level = options_.start_level;
+       s.ok() && level < last_level && !cancelled(); level++) {
+    {
+      MutexLock l(&db_->mutex_);
+      const uint64_t remaining =
+          db_->ManualCompactionInputBytes(level, last_level, begin, end);
+      MutexLock job_lock(&mu_);
+      level_ = level;
+      total_bytes_ = stats_.bytes_read + remaining;
+    }
+    s = db_->RunManualCompaction(level, begin, end, this);
+  }
+
+  MutexLock l(&mu_);
+  total_bytes_ = stats_.bytes_read;
+  status_ = s;
+  done_ = true;
+  done_cv_.SignalAll();
+}
+
 void DBImpl::TEST_CompactRange(int level, const Slice* begin,
                                const Slice* end) {
+  RunManualCompaction(level, begin, end, nullptr);
+}
+
+Status DBImpl::RunManualCompaction(int level, const Slice* begin,
+                                   const Slice* end, CompactionJobImpl* job) {
   assert(level >= 0);
   assert(level + 1 < config::kNumLevels);
 
@@ -608,6 +825,7 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,
   ManualCompaction manual;
   manual.level = level;
   manual.done = false;
+  manual.job = job;
   if (begin == nullptr) {
     manual.begin = nullptr;
   } else {
@@ -625,9 +843,13 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,
   while (!manual.done && !shutting_down_.load(std::memory_order_acquire) &&
          bg_error_.ok()) {
     if (manual_compaction_ == nullptr) {  // Idle
+      if (job != nullptr && job->cancelled()) {
+        break;
+      }
       manual_compaction_ = &manual;
       MaybeScheduleCompaction();
     } else {  // Running either my compaction or another compaction.
+      // A cancelled job ends my compaction early, setting manual.done.
       background_work_finished_signal_.Wait();
     }
   }
@@ -635,6 +857,13 @@ void DBImpl::TEST_CompactRange(int level, const Slice* begin,
     // Cancel my manual compaction since we aborted early for some reason.
     manual_compaction_ = nullptr;
   }
+  if (!bg_error_.ok()) {
+    return bg_error_;
+  }
+  if (!manual.done && shutting_down_.load(std::memory_order_acquire)) {
+    return Status::IOError("Deleting DB during compaction");
+  }
+  return Status::OK();
 }
 
 Status DBImpl::TEST_CompactMemTable() {
@@ -653,6 +882,21 @@ Status DBImpl::TEST_CompactMemTable() {
   return s;
 }
 
+void DBImpl::UpdateWriteBufferUsage() {
+  mutex_.AssertHeld();
+  WriteBufferManager* const manager = options_.write_buffer_manager;
+  if (manager == nullptr) {
+    return;
+  }
+  const size_t mutable_usage = mem_->ApproximateMemoryUsage();
+  const size_t usage =
+      mutable_usage + (imm_ != nullptr ? imm_->ApproximateMemoryUsage() : 0);
+  manager->UpdateUsage(write_buffer_usage_, usage,
+                       mutable_write_buffer_usage_.load(), mutable_usage);
+  write_buffer_usage_ = usage;
+  mutable_write_buffer_usage_.store(mutable_usage, std::memory_order_relaxed);
+}
+
 void DBImpl::RecordBackgroundError(const Status& s) {
   mutex_.AssertHeld();
   if (bg_error_.ok()) {
@@ -703,6 +947,101 @@ void DBImpl::BackgroundCall() {
   background_work_finished_signal_.SignalAll();
 }
 
+// The block cache manifest lists, for each table file with cached blocks,
+//    file_number: varint64
+//    count: varint32
+//    offset deltas: varint64[count]  (from the previous offset, in order)
+Status DBImpl::SaveBlockCacheManifest() {
+  std::map<uint64_t, std::vector<uint64_t>> blocks;
+  table_cache_->GetCachedBlocks(&blocks);
+  std::string contents;
+  for (const auto& file : blocks) {
+    PutVarint64(&contents, file.first);
+    PutVarint32(&contents, static_cast<uint32_t>(file.second.size()));
+    uint64_t last = 0;
+    for (uint64_t offset : file.second) {
+      PutVarint64(&contents, offset - last);
+      last = offset;
+    }
+  }
+
+  uint64_t number;
+  {
+    MutexLock l(&mutex_);
+    number = versions_->NewFileNumber();
+    pending_outputs_.insert(number);
+  }
+  const std::string tmp = TempFileName(dbname_, number);
+  Status s = WriteStringToFile(env_, contents, tmp);
+  if (s.ok()) {
+    s = env_->RenameFile(tmp, BlockCacheFileName(dbname_));
+  }
+  if (!s.ok()) {
+    env_->RemoveFile(tmp);
+  }
+  MutexLock l(&mutex_);
+  pending_outputs_.erase(number);
+  return s;
+}
+
+void DBImpl::WarmBlockCacheWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->WarmBlockCache();
+}
+
+void DBImpl::WarmBlockCache() {
+  std::string contents;
+  std::map<uint64_t, uint64_t> sizes;
+  Version* current = nullptr;
+  if (ReadFileToString(env_, BlockCacheFileName(dbname_), &contents).ok()) {
+    MutexLock l(&mutex_);
+    current = versions_->current();
+    current->Ref();
+    current->GetFileSizes(&sizes);
+  }
+
+  Slice input(contents);
+  uint64_t number;
+  uint32_t count;
+  std::vector<uint64_t> offsets;
+  while (current != nullptr &&
+         !shutting_down_.load(std::memory_order_acquire) &&
+         GetVarint64(&input, &number) && GetVarint32(&input, &count)) {
+    offsets.clear();
+    uint64_t offset = 0;
+    uint64_t delta;
+    while (offsets.size() < count && GetVarint64(&input, &delta)) {
+      offset += delta;
+      offsets.push_back(offset);
+    }
+    if (offsets.size() < count) {
+      break;  // Truncated
+    }
+    auto it = sizes.find(number);
+    if (it == sizes.end()) {
+      continue;  // Compacted away since the manifest was saved
+    }
+    Status s = table_cache_->PrefetchBlocks(number, it->second, offsets);
+    if (!s.ok()) {
+      Log(options_.info_log, "Warming block cache from #%llu: %s\n",
+          static_cast<unsigned long long>(number), s.ToString().c_str());
+    }
+  }
+
+  MutexLock l(&mutex_);
+  if (current != nullptr) {
+    current->Unref();
+  }
+  warming_block_cache_ = false;
+  background_work_finished_signal_.SignalAll();
+}
+
+void DBImpl::TEST_WaitForBlockCacheWarmUp() {
+  MutexLock l(&mutex_);
+  while (warming_block_cache_) {
+    background_work_finished_signal_.Wait();
+  }
+}
+
 void DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
@@ -751,6 +1090,9 @@ void DBImpl::BackgroundCompaction() {
         status.ToString().c_str(), versions_->LevelSummary(&tmp));
   } else {
     CompactionState* compact = new CompactionState(c);
+    if (is_manual) {
+      compact->job = manual_compaction_->job;
+    }
     status = DoCompactionWork(compact);
     if (!status.ok()) {
       RecordBackgroundError(status);
@@ -771,7 +1113,7 @@ void DBImpl::BackgroundCompaction() {
 
   if (is_manual) {
     ManualCompaction* m = manual_compaction_;
-    if (!status.ok()) {
+    if (!status.ok() || (m->job != nullptr && m->job->cancelled())) {
       m->done = true;
     }
     if (!m->done) {
@@ -801,6 +1143,23 @@ void DBImpl::CleanupCompaction(CompactionState* compact) {
   delete compact;
 }
 
+const FilterPolicy* DBImpl::FilterPolicyForLevel(int level,
+                                                 bool bottommost) const {
+  if (options_.filter_policy == nullptr) {
+    return nullptr;
+  }
+  if (bottommost && options_.optimize_filters_for_hits) {
+    return nullptr;
+  }
+  if (level < static_cast<int>(internal_level_filter_policies_.size())) {
+    if (options_.level_filter_policies[level] == nullptr) {
+      return nullptr;
+    }
+    return &internal_level_filter_policies_[level];
+  }
+  return options_.filter_policy;
+}
+
 Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   assert(compact != nullptr);
   assert(compact->builder == nullptr);
@@ -821,7 +1180,9 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   std::string fname = TableFileName(dbname_, file_number);
   Status s = env_->NewWritableFile(fname, &compact->outfile);
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    Options options = options_;
+    options.filter_policy = compact->filter_policy;
+    compact->builder = new TableBuilder(options, compact->outfile);
   }
   return s;
 }
@@ -911,6 +1272,20 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     compact->smallest_snapshot = snapshots_.oldest()->sequence_number();
   }
 
+  // A best-effort snapshot: the memtable compactions run inside the loop
+  // below may still place a file deeper than output_level (see
+  // PickLevelForMemTableOutput), making these outputs no longer the
+  // bottommost.  That only affects which filter they are written with.
+  const int output_level = compact->compaction->level() + 1;
+  bool bottommost = true;
+  for (int level = output_level + 1; level < config::kNumLevels; level++) {
+    if (versions_->NumLevelFiles(level) > 0) {
+      bottommost = false;
+      break;
+    }
+  }
+  compact->filter_policy = FilterPolicyForLevel(output_level, bottommost);
+
   Iterator* input = versions_->MakeInputIterator(compact->compaction);
 
   // Release mutex while we're actually doing the compaction work
@@ -922,7 +1297,14 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   std::string current_user_key;
   bool has_current_user_key = false;
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+  bool cancelled = false;
   while (input->Valid() && !shutting_down_.load(std::memory_order_acquire)) {
+    if (compact->job != nullptr && compact->builder == nullptr &&
+        compact->job->cancelled()) {
+      cancelled = true;
+      break;
+    }
+
     // Prioritize immutable compaction work
     if (has_imm_.load(std::memory_order_relaxed)) {
       const uint64_t imm_start = env_->NowMicros();
@@ -1041,9 +1423,15 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   }
 
   mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
-
-  if (status.ok()) {
+  if (cancelled) {
+    // Leave the output files for RemoveObsoleteFiles() to delete, and keep
+    // their reads and writes out of the stats.
+    Log(options_.info_log, "Manual compaction cancelled");
+  } else if (status.ok()) {
+    stats_[compact->compaction->level() + 1].Add(stats);
+    if (compact->job != nullptr) {
+      compact->job->AddStats(stats);
+    }
     status = InstallCompactionResults(compact);
   }
   if (!status.ok()) {
@@ -1116,8 +1504,18 @@ int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
   return versions_->MaxNextLevelOverlappingBytes();
 }
 
+static void AssignValue(void* arg, const Slice& value) {
+  reinterpret_cast<std::string*>(arg)->assign(value.data(), value.size());
+}
+
 Status DBImpl::Get(const ReadOptions& options, const Slice& key,
                    std::string* value) {
+  return GetPinned(options, key, value, &AssignValue);
+}
+
+Status DBImpl::GetPinned(const ReadOptions& options, const Slice& key,
+                         void* arg,
+                         void (*handle_value)(void* arg, const Slice& value)) {
   Status s;
   MutexLock l(&mutex_);
   SequenceNumber snapshot;
@@ -1143,12 +1541,12 @@ Status DBImpl::Get(const ReadOptions& options, const Slice& key,
     mutex_.Unlock();
     // First look in the memtable, then in the immutable memtable (if any).
     LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
+    if (mem->Get(lkey, arg, handle_value, &s)) {
       // Done
-    } else if (imm != nullptr && imm->Get(lkey, value, &s)) {
+    } else if (imm != nullptr && imm->Get(lkey, arg, handle_value, &s)) {
       // Done
     } else {
-      s = current->Get(options, lkey, value, &stats);
+      s = current->Get(options, lkey, arg, handle_value, &stats);
       have_stat_update = true;
     }
     mutex_.Lock();
@@ -1163,6 +1561,86 @@ Status DBImpl::Get(const ReadOptions& options, const Slice& key,
   return s;
 }
 
+void DBImpl::MultiGet(const ReadOptions& options, int n, const Slice* keys,
+                      std::string* values, Status* statuses) {
+  // Look the keys up in order, so that the keys a table may hold are
+  // searched for together.
+  std::vector<int> order(n);
+  for (int i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  const Comparator* ucmp = user_comparator();
+  std::sort(order.begin(), order.end(), [ucmp, keys](int a, int b) {
+    return ucmp->Compare(keys[a], keys[b]) < 0;
+  });
+
+  MutexLock l(&mutex_);
+  SequenceNumber snapshot;
+  if (options.snapshot != nullptr) {
+    snapshot =
+        static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+  } else {
+    snapshot = versions_->LastSequence();
+  }
+
+  MemTable* mem = mem_;
+  MemTable* imm = imm_;
+  Version* current = versions_->current();
+  mem->Ref();
+  if (imm != nullptr) imm->Ref();
+  current->Ref();
+
+  std::vector<Version::GetStats> stats;
+
+  // Unlock while reading from files and memtables
+  {
+    mutex_.Unlock();
+    std::deque<LookupKey> lkeys;
+    std::vector<const LookupKey*> table_keys;
+    std::vector<void*> table_values;
+    std::vector<int> table_order;
+    for (int i : order) {
+      lkeys.emplace_back(keys[i], snapshot);
+      const LookupKey& lkey = lkeys.back();
+      Status* s = &statuses[i];
+      *s = Status::OK();
+      if (mem->Get(lkey, &values[i], &AssignValue, s)) {
+        // Done
+      } else if (imm != nullptr &&
+                 imm->Get(lkey, &values[i], &AssignValue, s)) {
+        // Done
+      } else {
+        table_keys.push_back(&lkey);
+        table_values.push_back(&values[i]);
+        table_order.push_back(i);
+      }
+    }
+    if (!table_keys.empty()) {
+      const int m = static_cast<int>(table_keys.size());
+      std::vector<Status> table_statuses(m);
+      current->MultiGet(options, m, table_keys.data(), table_values.data(),
+                        &AssignValue, table_statuses.data(), &stats);
+      for (int j = 0; j < m; j++) {
+        statuses[table_order[j]] = table_statuses[j];
+      }
+    }
+    mutex_.Lock();
+  }
+
+  bool schedule_compaction = false;
+  for (const Version::GetStats& file_stats : stats) {
+    if (current->UpdateStats(file_stats)) {
+      schedule_compaction = true;
+    }
+  }
+  if (schedule_compaction) {
+    MaybeScheduleCompaction();
+  }
+  mem->Unref();
+  if (imm != nullptr) imm->Unref();
+  current->Unref();
+}
+
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
   SequenceNumber latest_snapshot;
   uint32_t seed;
@@ -1202,6 +1680,16 @@ Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
 }
 
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
+  Status s = DoWrite(options, updates);
+  if (options_.write_buffer_manager != nullptr) {
+    // Outside the writer queue and mutex_, since the memtable the manager
+    // flushes may be this DB's.
+    options_.write_buffer_manager->MaybeFlush();
+  }
+  return s;
+}
+
+Status DBImpl::DoWrite(const WriteOptions& options, WriteBatch* updates) {
   Writer w(&mutex_);
   w.batch = updates;
   w.sync = options.sync;
@@ -1253,6 +1741,7 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* updates) {
     if (write_batch == tmp_batch_) tmp_batch_->Clear();
 
     versions_->SetLastSequence(last_sequence);
+    UpdateWriteBufferUsage();
   }
 
   while (true) {
@@ -1381,6 +1870,7 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       has_imm_.store(true, std::memory_order_release);
       mem_ = new MemTable(internal_comparator_);
       mem_->Ref();
+      UpdateWriteBufferUsage();
       force = false;  // Do not force another compaction if have room
       MaybeScheduleCompaction();
     }
@@ -1446,11 +1936,14 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
     value->append(buf);
     return true;
   } else if (in == "approximate-memory-usages") {
+    size_t table_readers;
+    std::map<uint64_t, size_t> filters;
+    table_cache_->GetMemoryUsage(&table_readers, &filters);
     char buf[200];
     snprintf(buf, sizeof(buf), "mem_table=%lluK+%lluK; table_cache=%lluK(%llu); block_cache=%lluK",
              static_cast<unsigned long long>(mem_ ? mem_->ApproximateMemoryUsage() >> 10 : 0),
              static_cast<unsigned long long>(imm_ ? imm_->ApproximateMemoryUsage() >> 10 : 0),
-             static_cast<unsigned long long>(Table::GetTableCacheSize() >> 10),
+             static_cast<unsigned long long>(table_readers >> 10),
              static_cast<unsigned long long>(table_cache_->TotalCharge()),
              static_cast<unsigned long long>(options_.block_cache->TotalCharge() >> 10));
     value->append(buf);
@@ -1460,6 +1953,241 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
   return false;
 }
 
+Status DBImpl::GetMemoryUsage(MemoryUsage* usage) {
+  *usage = MemoryUsage();
+  std::map<uint64_t, int> levels;
+  {
+    MutexLock l(&mutex_);
+    usage->mem_table = mem_->ApproximateMemoryUsage();
+    usage->mem_table_unused = mem_->ApproximateUnusedMemory();
+    if (imm_ != nullptr) {
+      usage->imm_mem_table = imm_->ApproximateMemoryUsage();
+      usage->mem_table_unused += imm_->ApproximateUnusedMemory();
+    }
+    versions_->current()->GetFileLevels(&levels);
+  }
+
+  // Tables of files that compaction has just removed are counted in
+  // table_readers, but not at any level.
+  std::map<uint64_t, size_t> filters;
+  table_cache_->GetMemoryUsage(&usage->table_readers, &filters);
+  usage->level_filters.resize(config::kNumLevels);
+  for (const auto& filter : filters) {
+    auto it = levels.find(filter.first);
+    if (it != levels.end()) {
+      usage->level_filters[it->second] += filter.second;
+    }
+  }
+  usage->iterator_blocks = table_cache_->IteratorUsage();
+
+  usage->block_cache = options_.block_cache->TotalCharge();
+  if (options_.compressed_block_cache != nullptr) {
+    usage->compressed_block_cache =
+        options_.compressed_block_cache->TotalCharge();
+  }
+  if (options_.row_cache != nullptr) {
+    usage->row_cache = options_.row_cache->TotalCharge();
+  }
+  return Status::OK();
+}
+
+void DBImpl::DisableFileDeletions() {
+  MutexLock l(&mutex_);
+  file_deletions_disabled_++;
+}
+
+void DBImpl::EnableFileDeletions() {
+  MutexLock l(&mutex_);
+  assert(file_deletions_disabled_ > 0);
+  if (--file_deletions_disabled_ == 0) {
+    RemoveObsoleteFiles();
+  }
+}
+
+namespace {
+
+// Collects what is written to it in a string.
+class StringWritableFile : public WritableFile {
+ public:
+  explicit StringWritableFile(std::string* contents) : contents_(contents) {}
+
+  Status Append(const Slice& data) override {
+    contents_->append(data.data(), data.size());
+    return Status::OK();
+  }
+  Status Close() override { return Status::OK(); }
+  Status Flush() override { return Status::OK(); }
+  Status Sync() override { return Status::OK(); }
+
+ private:
+  std::string* const contents_;
+};
+
+}  // anonymous namespace
+
+Status DBImpl::GetLiveFiles(LiveFiles* files) {
+  // The current version plus all log files not yet compacted into it.
+  std::map<uint64_t, uint64_t> tables;
+  std::string record;
+  uint64_t manifest_number;
+  uint64_t min_log_number;
+  uint64_t prev_log_number;
+  uint64_t max_log_number;
+  {
+    MutexLock l(&mutex_);
+    versions_->current()->GetFileSizes(&tables);
+    manifest_number = versions_->NewFileNumber();
+    versions_->EncodeSnapshot(&record);
+    min_log_number = versions_->LogNumber();
+    prev_log_number = versions_->PrevLogNumber();
+    max_log_number = logfile_number_;
+  }
+
+  files->dir = dbname_;
+  files->tables.clear();
+  files->logs.clear();
+  for (const auto& table : tables) {
+    LiveFiles::File file;
+    file.name = TableFileName("", table.first).substr(1);
+    if (!env_->FileExists(dbname_ + "/" + file.name)) {
+      file.name = SSTTableFileName("", table.first).substr(1);
+    }
+    file.size = table.second;
+    files->tables.push_back(file);
+  }
+
+  // Logs are still written to, so only the prefix present now belongs to
+  // the state.  A record cut short at the end is dropped on recovery.
+  std::vector<std::string> filenames;
+  Status s = env_->GetChildren(dbname_, &filenames);
+  uint64_t number;
+  FileType type;
+  for (size_t i = 0; s.ok() && i < filenames.size(); i++) {
+    if (ParseFileName(filenames[i], &number, &type) && type == kLogFile &&
+        (number >= min_log_number || number == prev_log_number) &&
+        number <= max_log_number) {
+      LiveFiles::File file;
+      file.name = filenames[i];
+      s = env_->GetFileSize(dbname_ + "/" + file.name, &file.size);
+      files->logs.push_back(file);
+    }
+  }
+
+  files->manifest_name = DescriptorFileName("", manifest_number).substr(1);
+  files->manifest.clear();
+  if (s.ok()) {
+    StringWritableFile file(&files->manifest);
+    log::Writer writer(&file);
+    s = writer.AddRecord(record);
+  }
+  return s;
+}
+
+// A utility routine: write "data" to the named file and Sync() it.
+Status WriteStringToFileSync(Env* env, const Slice& data,
+                             const std::string& fname);
+
+// Copies the first "size" bytes of "src" to a new file "dst".
+static Status CopyFilePrefix(Env* env, const std::string& src,
+                             const std::string& dst, uint64_t size) {
+  SequentialFile* in;
+  Status s = env->NewSequentialFile(src, &in);
+  if (!s.ok()) {
+    return s;
+  }
+  WritableFile* out;
+  s = env->NewWritableFile(dst, &out);
+  if (!s.ok()) {
+    delete in;
+    return s;
+  }
+  const size_t kBufferSize = 64 * 1024;
+  char* buffer = new char[kBufferSize];
+  while (s.ok() && size > 0) {
+    Slice fragment;
+    s = in->Read(std::min<uint64_t>(size, kBufferSize), &fragment, buffer);
+    if (s.ok() && fragment.empty()) {
+      s = Status::Corruption("file shorter than expected", src);
+    }
+    if (s.ok()) {
+      s = out->Append(fragment);
+      size -= fragment.size();
+    }
+  }
+  delete[] buffer;
+  delete in;
+  if (s.ok()) {
+    s = out->Sync();
+  }
+  if (s.ok()) {
+    s = out->Close();
+  }
+  delete out;
+  return s;
+}
+
+static void RemoveCheckpointDir(Env* env, const std::string& dir) {
+  std::vector<std::string> filenames;
+  env->GetChildren(dir, &filenames);  // Ignoring errors on purpose
+  for (const std::string& filename : filenames) {
+    if (filename != "." && filename != "..") {
+      env->RemoveFile(dir + "/" + filename);
+    }
+  }
+  env->RemoveDir(dir);
+}
+
+Status DBImpl::CreateCheckpoint(const std::string& checkpoint_dir) {
+  // Files are gathered in a temporary directory renamed into place once
+  // complete, so a failed checkpoint never looks like a usable DB.  It may
+  // belong to someone else, so it must not exist either.
+  const std::string dir = checkpoint_dir + ".tmp";
+  if (env_->FileExists(checkpoint_dir)) {
+    return Status::InvalidArgument(checkpoint_dir, "exists");
+  }
+  if (env_->FileExists(dir)) {
+    return Status::InvalidArgument(dir, "exists");
+  }
+  DisableFileDeletions();
+  LiveFiles files;
+  Status s = GetLiveFiles(&files);
+  if (s.ok()) {
+    s = env_->CreateDir(dir);
+  }
+  for (size_t i = 0; s.ok() && i < files.tables.size(); i++) {
+    const LiveFiles::File& file = files.tables[i];
+    const std::string fname = dbname_ + "/" + file.name;
+    s = env_->LinkFile(fname, dir + "/" + file.name);
+    if (!s.ok()) {
+      // Unsupported, or across file systems
+      s = CopyFilePrefix(env_, fname, dir + "/" + file.name, file.size);
+    }
+  }
+  for (size_t i = 0; s.ok() && i < files.logs.size(); i++) {
+    const LiveFiles::File& file = files.logs[i];
+    s = CopyFilePrefix(env_, dbname_ + "/" + file.name,
+                       dir + "/" + file.name, file.size);
+  }
+  EnableFileDeletions();
+
+  uint64_t manifest_number = 0;
+  FileType type;
+  if (s.ok()) {
+    s = WriteStringToFileSync(env_, files.manifest,
+                              dir + "/" + files.manifest_name);
+  }
+  if (s.ok() && ParseFileName(files.manifest_name, &manifest_number, &type)) {
+    s = SetCurrentFile(env_, dir, manifest_number);
+  }
+  if (s.ok()) {
+    s = env_->RenameFile(dir, checkpoint_dir);
+  }
+  if (!s.ok()) {
+    RemoveCheckpointDir(env_, dir);
+  }
+  return s;
+}
+
 void DBImpl::GetApproximateSizes(const Range* range, int n, uint64_t* sizes) {
   // TODO(opt): better implementation
   MutexLock l(&mutex_);
@@ -1494,6 +2222,59 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
 
 DB::~DB() = default;
 
+Status DB::GetPinned(const ReadOptions& options, const Slice& key, void* arg,
+                     void (*handle_value)(void* arg, const Slice& value)) {
+  std::string value;
+  Status s = Get(options, key, &value);
+  if (s.ok()) {
+    (*handle_value)(arg, value);
+  }
+  return s;
+}
+
+void DB::MultiGet(const ReadOptions& options, int n, const Slice* keys,
+                  std::string* values, Status* statuses) {
+  ReadOptions snapshot_options = options;
+  const Snapshot* snapshot = nullptr;
+  if (options.snapshot == nullptr) {
+    snapshot = GetSnapshot();
+    snapshot_options.snapshot = snapshot;
+  }
+  for (int i = 0; i < n; i++) {
+    statuses[i] = Get(snapshot_options, keys[i], &values[i]);
+  }
+  if (snapshot != nullptr) {
+    ReleaseSnapshot(snapshot);
+  }
+}
+
+Status DB::SaveBlockCacheManifest() {
+  return Status::NotSupported("SaveBlockCacheManifest");
+}
+
+Status DB::GetMemoryUsage(MemoryUsage* usage) {
+  return Status::NotSupported("GetMemoryUsage");
+}
+
+Status DB::CreateCheckpoint(const std::string& checkpoint_dir) {
+  return Status::NotSupported("CreateCheckpoint");
+}
+
+void DB::DisableFileDeletions() {}
+
+void DB::EnableFileDeletions() {}
+
+Status DB::GetLiveFiles(LiveFiles* files) {
+  return Status::NotSupported("GetLiveFiles");
+}
+
+Status DB::CompactRangeAsync(const CompactRangeOptions& options,
+                             const Slice* begin, const Slice* end,
+                             CompactionJob** job) {
+  *job = nullptr;
+  return Status::NotSupported("CompactRangeAsync");
+}
+
 Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
   *dbptr = nullptr;
 
@@ -1524,12 +2305,20 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
     s = impl->versions_->LogAndApply(&edit, &impl->mutex_);
   }
   if (s.ok()) {
+    impl->UpdateWriteBufferUsage();
     impl->RemoveObsoleteFiles();
     impl->MaybeScheduleCompaction();
+    if (options.warm_block_cache) {
+      impl->warming_block_cache_ = true;
+      options.env->StartThread(&DBImpl::WarmBlockCacheWork, impl);
+    }
   }
   impl->mutex_.Unlock();
   if (s.ok()) {
     assert(impl->mem_ != nullptr);
+    if (options.write_buffer_manager != nullptr) {
+      options.write_buffer_manager->Register(impl);
+    }
     *dbptr = impl;
   } else {
     delete impl;
@@ -1539,6 +2328,8 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
 
 Snapshot::~Snapshot() = default;
 
+CompactionJob::~CompactionJob() = default;
+
 Status DestroyDB(const std::string& dbname, const Options& options) {
   Env* env = options.env;
   std::vector<std::string> filenames;
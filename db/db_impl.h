@@ -9,6 +9,7 @@
 #include <deque>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "db/dbformat.h"
 #include "db/log_writer.h"
@@ -42,12 +43,26 @@ class DBImpl : public DB {
   Status Write(const WriteOptions& options, WriteBatch* updates) override;
   Status Get(const ReadOptions& options, const Slice& key,
              std::string* value) override;
+  Status GetPinned(const ReadOptions& options, const Slice& key, void* arg,
+                   void (*handle_value)(void* arg,
+                                        const Slice& value)) override;
+  void MultiGet(const ReadOptions& options, int n, const Slice* keys,
+                std::string* values, Status* statuses) override;
   Iterator* NewIterator(const ReadOptions&) override;
   const Snapshot* GetSnapshot() override;
   void ReleaseSnapshot(const Snapshot* snapshot) override;
   bool GetProperty(const Slice& property, std::string* value) override;
   void GetApproximateSizes(const Range* range, int n, uint64_t* sizes) override;
   void CompactRange(const Slice* begin, const Slice* end) override;
+  Status CompactRangeAsync(const CompactRangeOptions& options,
+                           const Slice* begin, const Slice* end,
+                           CompactionJob** job) override;
+  Status SaveBlockCacheManifest() override;
+  Status GetMemoryUsage(MemoryUsage* usage) override;
+  Status CreateCheckpoint(const std::string& checkpoint_dir) override;
+  void DisableFileDeletions() override;
+  void EnableFileDeletions() override;
+  Status GetLiveFiles(LiveFiles* files) override;
 
   // Extra methods (for testing) that are not in the public DB interface
 
@@ -66,6 +81,9 @@ class DBImpl : public DB {
   // file at a level >= 1.
   int64_t TEST_MaxNextLevelOverlappingBytes();
 
+  // Wait until the block cache warm-up started by DB::Open() has finished.
+  void TEST_WaitForBlockCacheWarmUp();
+
   // Record a sample of bytes read at the specified internal key.
   // Samples are taken approximately once every config::kReadBytesPeriod
   // bytes.
@@ -75,6 +93,8 @@ class DBImpl : public DB {
 
  private:
   friend class DB;
+  friend class WriteBufferManager;
+  class CompactionJobImpl;
   struct CompactionState;
   struct Writer;
 
@@ -85,6 +105,7 @@ class DBImpl : public DB {
     const InternalKey* begin;  // null means beginning of key range
     const InternalKey* end;    // null means end of key range
     InternalKey tmp_storage;   // Used to keep track of compaction progress
+    CompactionJobImpl* job;    // null unless run by CompactRangeAsync()
   };
 
   // Per level compaction stats.  stats_[level] stores the stats for
@@ -132,6 +153,9 @@ class DBImpl : public DB {
   Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Write() without consulting options_.write_buffer_manager.
+  Status DoWrite(const WriteOptions& options, WriteBatch* updates);
+
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   WriteBatch* BuildBatchGroup(Writer** last_writer)
@@ -139,15 +163,53 @@ class DBImpl : public DB {
 
   void RecordBackgroundError(const Status& s);
 
+  // Report the memory held by mem_ and imm_ to
+  // options_.write_buffer_manager, if any.
+  void UpdateWriteBufferUsage() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // For options_.write_buffer_manager: the memory held by mem_ as last
+  // reported, and a request to switch to a new memtable and flush mem_.
+  size_t MutableWriteBufferUsage() const {
+    return mutable_write_buffer_usage_.load(std::memory_order_relaxed);
+  }
+  Status FlushForWriteBufferManager() {
+    return DoWrite(WriteOptions(), nullptr);
+  }
+
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
   void BackgroundCall();
+
+  // Reads the blocks listed by SaveBlockCacheManifest() into the block
+  // cache, on a thread started by DB::Open().
+  static void WarmBlockCacheWork(void* db);
+  void WarmBlockCache();
   void BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Compact the files in "level" that overlap [*begin,*end] into the next
+  // level, on the background thread; "job" may be null.  Returns once done,
+  // or once the job is cancelled.
+  Status RunManualCompaction(int level, const Slice* begin, const Slice* end,
+                             CompactionJobImpl* job);
+
+  // Return the deepest level from 1 on holding files in [*begin,*end], or 1.
+  int MaxOverlappingLevel(const Slice* begin, const Slice* end)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Estimate the bytes that compacting [*begin,*end] from "level" down to
+  // "last_level" reads.
+  uint64_t ManualCompactionInputBytes(int level, int last_level,
+                                      const Slice* begin, const Slice* end)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void CleanupCompaction(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Filter policy for tables written to "level"; "bottommost" is true if
+  // no deeper level holds any files.
+  const FilterPolicy* FilterPolicyForLevel(int level, bool bottommost) const;
+
   Status OpenCompactionOutputFile(CompactionState* compact);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
   Status InstallCompactionResults(CompactionState* compact)
@@ -161,6 +223,7 @@ class DBImpl : public DB {
   Env* const env_;
   const InternalKeyComparator internal_comparator_;
   const InternalFilterPolicy internal_filter_policy_;
+  std::vector<InternalFilterPolicy> internal_level_filter_policies_;
   const Options options_;  // options_.comparator == &internal_comparator_
   const bool owns_info_log_;
   const bool owns_cache_;
@@ -190,6 +253,10 @@ class DBImpl : public DB {
 
   SnapshotList snapshots_ GUARDED_BY(mutex_);
 
+  // Memory of mem_ and imm_ last reported to options_.write_buffer_manager.
+  size_t write_buffer_usage_ GUARDED_BY(mutex_);
+  std::atomic<size_t> mutable_write_buffer_usage_;
+
   // Set of table files to protect from deletion because they are
   // part of ongoing compactions.
   std::set<uint64_t> pending_outputs_ GUARDED_BY(mutex_);
@@ -197,6 +264,13 @@ class DBImpl : public DB {
   // Has a background compaction been scheduled or is running?
   bool background_compaction_scheduled_ GUARDED_BY(mutex_);
 
+  // Is the thread warming up the block cache running?
+  bool warming_block_cache_ GUARDED_BY(mutex_);
+
+  // Number of DisableFileDeletions() calls not yet matched by
+  // EnableFileDeletions().  Obsolete files are only deleted while zero.
+  int file_deletions_disabled_ GUARDED_BY(mutex_);
+
   ManualCompaction* manual_compaction_ GUARDED_BY(mutex_);
 
   VersionSet* const versions_ GUARDED_BY(mutex_);
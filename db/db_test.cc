@@ -17,7 +17,9 @@
 #include "leveldb/cache.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/persistent_cache.h"
 #include "leveldb/table.h"
+#include "leveldb/write_buffer_manager.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
 #include "util/hash.h"
@@ -121,6 +123,7 @@ class SpecialEnv : public EnvWrapper {
 
   bool count_random_reads_;
   AtomicCounter random_read_counter_;
+  AtomicCounter prefetch_counter_;
 
   explicit SpecialEnv(Env* base)
       : EnvWrapper(base),
@@ -208,21 +211,29 @@ class SpecialEnv : public EnvWrapper {
      private:
       RandomAccessFile* target_;
       AtomicCounter* counter_;
+      AtomicCounter* prefetch_counter_;
 
      public:
-      CountingFile(RandomAccessFile* target, AtomicCounter* counter)
-          : target_(target), counter_(counter) {}
+      CountingFile(RandomAccessFile* target, AtomicCounter* counter,
+                   AtomicCounter* prefetch_counter)
+          : target_(target),
+            counter_(counter),
+            prefetch_counter_(prefetch_counter) {}
       ~CountingFile() override { delete target_; }
       Status Read(uint64_t offset, size_t n, Slice* result,
                   char* scratch) const override {
         counter_->Increment();
         return target_->Read(offset, n, result, scratch);
       }
+      void Prefetch(uint64_t offset, size_t n) const override {
+        prefetch_counter_->Increment();
+        target_->Prefetch(offset, n);
+      }
     };
 
     Status s = target()->NewRandomAccessFile(f, r);
     if (s.ok() && count_random_reads_) {
-      *r = new CountingFile(*r, &random_read_counter_);
+      *r = new CountingFile(*r, &random_read_counter_, &prefetch_counter_);
     }
     return s;
   }
@@ -274,6 +285,13 @@ class DBTest : public testing::Test {
       case kFilter:
         options.filter_policy = filter_policy_;
         break;
+      case kFullFilter:
+        options.filter_policy = filter_policy_;
+        options.full_filter = true;
+        break;
+      case kHashIndex:
+        options.data_block_hash_index = true;
+        break;
       case kUncompressed:
         options.compression = kNoCompression;
         break;
@@ -533,7 +551,15 @@ class DBTest : public testing::Test {
 
  private:
   // Sequence of option configurations to try
-  enum OptionConfig { kDefault, kReuse, kFilter, kUncompressed, kEnd };
+  enum OptionConfig {
+    kDefault,
+    kReuse,
+    kFilter,
+    kFullFilter,
+    kHashIndex,
+    kUncompressed,
+    kEnd
+  };
 
   const FilterPolicy* filter_policy_;
   int option_config_;
@@ -1641,6 +1667,92 @@ TEST_F(DBTest, ManualCompaction) {
   ASSERT_EQ("0,0,1", FilesPerLevel());
 }
 
+TEST_F(DBTest, ManualCompactionAsync) {
+  MakeTables(3, "p", "q");
+  ASSERT_EQ("1,1,1", FilesPerLevel());
+
+  CompactRangeOptions options;
+  CompactionJob* job;
+  options.start_level = -1;
+  ASSERT_TRUE(db_->CompactRangeAsync(options, nullptr, nullptr, &job)
+                  .IsInvalidArgument());
+  options.start_level = 1;
+  options.max_output_level = 1;
+  ASSERT_TRUE(db_->CompactRangeAsync(options, nullptr, nullptr, &job)
+                  .IsInvalidArgument());
+
+  // Stop at level 1
+  options.start_level = 0;
+  ASSERT_LEVELDB_OK(db_->CompactRangeAsync(options, nullptr, nullptr, &job));
+  ASSERT_LEVELDB_OK(job->Wait());
+  ASSERT_EQ("0,1,1", FilesPerLevel());
+  CompactionProgress progress;
+  job->GetProgress(&progress);
+  ASSERT_TRUE(progress.done);
+  ASSERT_GT(progress.bytes_read, 0);
+  ASSERT_GT(progress.bytes_written, 0);
+  ASSERT_EQ(progress.bytes_read, progress.total_bytes);
+  delete job;
+
+  // Start at level 1
+  options.start_level = 1;
+  options.max_output_level = -1;
+  const Slice p1("p1");
+  ASSERT_LEVELDB_OK(db_->CompactRangeAsync(options, &p1, nullptr, &job));
+  ASSERT_LEVELDB_OK(job->Wait());
+  ASSERT_EQ("0,0,1", FilesPerLevel());
+  job->GetProgress(&progress);
+  ASSERT_EQ(1, progress.level);
+  delete job;
+}
+
+TEST_F(DBTest, ManualCompactionAsyncCancel) {
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.compression = kNoCompression;
+  Reopen(&options);
+  for (int i = 0; i < 3000; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), std::string(1000, 'a')));
+  }
+  db_->CompactRange(nullptr, nullptr);
+  for (int i = 0; i < 3000; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), std::string(1000, 'b')));
+  }
+  ASSERT_LEVELDB_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_EQ("0,1,1", FilesPerLevel());
+  const int files = CountFiles();
+  std::string stats;
+  ASSERT_TRUE(db_->GetProperty("leveldb.stats", &stats));
+
+  // Compacting level 1 writes many output files.  Block the first one,
+  // cancel, and let it finish: the compaction is dropped before the next
+  // output file is started.
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+  CompactRangeOptions compact_options;
+  compact_options.start_level = 1;
+  CompactionJob* job;
+  ASSERT_LEVELDB_OK(
+      db_->CompactRangeAsync(compact_options, nullptr, nullptr, &job));
+  DelayMilliseconds(200);
+  job->Cancel();
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  ASSERT_LEVELDB_OK(job->Wait());
+  CompactionProgress progress;
+  job->GetProgress(&progress);
+  ASSERT_TRUE(progress.done);
+  ASSERT_EQ(0, progress.bytes_read);
+  delete job;
+
+  ASSERT_EQ("0,1,1", FilesPerLevel());
+  ASSERT_EQ(files, CountFiles());
+  std::string stats_after;
+  ASSERT_TRUE(db_->GetProperty("leveldb.stats", &stats_after));
+  ASSERT_EQ(stats, stats_after);
+  for (int i = 0; i < 3000; i++) {
+    ASSERT_EQ(std::string(1000, 'b'), Get(Key(i)));
+  }
+}
+
 TEST_F(DBTest, DBOpen_Options) {
   std::string dbname = testing::TempDir() + "db_options_test";
   DestroyDB(dbname, Options());
@@ -1942,6 +2054,699 @@ TEST_F(DBTest, BloomFilter) {
   delete options.filter_policy;
 }
 
+TEST_F(DBTest, FullBloomFilter) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.full_filter = true;
+  Reopen(&options);
+
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+  for (int i = 0; i < N; i += 100) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  dbfull()->TEST_CompactMemTable();
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+  }
+  int reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d present => %d reads\n", N, reads);
+  ASSERT_GE(reads, N);
+  ASSERT_LE(reads, N + 2 * N / 100);
+
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d missing => %d reads\n", N, reads);
+  ASSERT_LE(reads, 3 * N / 100);
+
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+
+  // Tables written with per-block filters stay readable.
+  options.full_filter = false;
+  Reopen(&options);
+  for (int i = 0; i < N; i += 10) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+  }
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
+TEST_F(DBTest, CacheIndexAndFilterBlocks) {
+  Options options = CurrentOptions();
+  options.block_cache = NewLRUCache(1 << 20);
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.cache_index_and_filter_blocks = true;
+  Reopen(&options);
+
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+  ASSERT_EQ(0, Table::GetTableCacheSize());
+  ASSERT_GT(options.block_cache->TotalCharge(), 0);
+
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+
+  // Index and filter blocks dropped from the cache are read back in.
+  options.block_cache->Prune();
+  ASSERT_EQ(0, options.block_cache->TotalCharge());
+  for (int i = 0; i < N; i += 100) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_EQ(N, count);
+  delete iter;
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
+TEST_F(DBTest, IteratorReadahead) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.compression = kNoCompression;
+  Reopen(&options);
+
+  const int N = 200;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), std::string(1000, 'v')));
+  }
+  Compact("a", "z");
+  ASSERT_EQ(1, TotalTableFiles());
+
+  ReadOptions ropts;
+  ropts.fill_cache = false;
+  env_->prefetch_counter_.Reset();
+  Iterator* iter = db_->NewIterator(ropts);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_EQ(N, count);
+  delete iter;
+  ASSERT_EQ(0, env_->prefetch_counter_.Read());
+
+  // About 200KB of blocks are read, with one hint per 16KB.
+  ropts.readahead_size = 16 << 10;
+  iter = db_->NewIterator(ropts);
+  count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_EQ(N, count);
+  delete iter;
+  const int hints = env_->prefetch_counter_.Read();
+  ASSERT_GE(hints, 10);
+  ASSERT_LE(hints, 14);
+
+  // Point lookups never read ahead.
+  env_->prefetch_counter_.Reset();
+  for (int i = 0; i < N; i += 10) {
+    std::string value;
+    ASSERT_LEVELDB_OK(db_->Get(ropts, Key(i), &value));
+  }
+  ASSERT_EQ(0, env_->prefetch_counter_.Read());
+}
+
+TEST_F(DBTest, RowCache) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Every block read goes to the file
+  options.row_cache = NewLRUCache(1 << 20);
+  Reopen(&options);
+
+  const int N = 100;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  ASSERT_LEVELDB_OK(Put("del", "v"));
+  ASSERT_LEVELDB_OK(Put("snap", "v1"));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_LEVELDB_OK(Put("snap", "v2"));
+  ASSERT_LEVELDB_OK(Delete("del"));
+  Compact("a", "z");
+  ASSERT_EQ(1, TotalTableFiles());
+
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+  }
+  ASSERT_EQ("NOT_FOUND", Get("del"));
+  ASSERT_EQ("v2", Get("snap"));
+  ASSERT_GE(env_->random_read_counter_.Read(), N);
+  ASSERT_GT(options.row_cache->TotalCharge(), 0);
+
+  // Repeated reads, including of the deletion, are served from the cache.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i), Get(Key(i)));
+  }
+  ASSERT_EQ("NOT_FOUND", Get("del"));
+  ASSERT_EQ("v2", Get("snap"));
+  ASSERT_EQ(0, env_->random_read_counter_.Read());
+
+  // A snapshot older than the cached entry reads the table.
+  ASSERT_EQ("v1", Get("snap", snapshot));
+  ASSERT_GT(env_->random_read_counter_.Read(), 0);
+  db_->ReleaseSnapshot(snapshot);
+
+  // Entries of a table replaced by compaction are not used.
+  ASSERT_LEVELDB_OK(Put(Key(0), "new"));
+  Compact("a", "z");
+  ASSERT_EQ("new", Get(Key(0)));
+  ASSERT_EQ(Key(1), Get(Key(1)));
+
+  env_->count_random_reads_ = false;
+  Close();
+  delete options.block_cache;
+  delete options.row_cache;
+}
+
+TEST_F(DBTest, WarmBlockCache) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(1 << 20);
+  options.warm_block_cache = true;
+  Reopen(&options);
+
+  const int N = 1000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), std::string(100, 'v')));
+  }
+  Compact("a", "z");
+  for (int i = 0; i < N; i += 2) {
+    ASSERT_EQ(std::string(100, 'v'), Get(Key(i)));
+  }
+
+  // Blocks cached before the DB was closed are loaded back after it opens.
+  Close();
+  delete options.block_cache;
+  options.block_cache = NewLRUCache(1 << 20);
+  Reopen(&options);
+  dbfull()->TEST_WaitForBlockCacheWarmUp();
+  ASSERT_GT(options.block_cache->TotalCharge(), 0);
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i += 2) {
+    ASSERT_EQ(std::string(100, 'v'), Get(Key(i)));
+  }
+  ASSERT_EQ(0, env_->random_read_counter_.Read());
+
+  // Blocks of tables that no longer exist are skipped.
+  ASSERT_LEVELDB_OK(db_->SaveBlockCacheManifest());
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), "new"));
+  }
+  Compact("a", "z");
+  options.warm_block_cache = false;  // Keep the manifest from this point
+  Close();
+  delete options.block_cache;
+  options.block_cache = NewLRUCache(1 << 20);
+  options.warm_block_cache = true;
+  Reopen(&options);
+  dbfull()->TEST_WaitForBlockCacheWarmUp();
+  ASSERT_EQ(0, options.block_cache->TotalCharge());
+  ASSERT_EQ("new", Get(Key(0)));
+
+  env_->count_random_reads_ = false;
+  Close();
+  delete options.block_cache;
+}
+
+TEST_F(DBTest, WriteBufferManager) {
+  WriteBufferManager manager(1 << 20);
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100 << 20;  // Only the manager flushes
+  options.write_buffer_manager = &manager;
+  Reopen(&options);
+  ASSERT_LEVELDB_OK(Put("foo", "v1"));
+  ASSERT_GT(manager.memory_usage(), 0);
+
+  const std::string other_name = testing::TempDir() + "db_test_other";
+  DestroyDB(other_name, Options());
+  DB* other = nullptr;
+  options.create_if_missing = true;
+  ASSERT_LEVELDB_OK(DB::Open(options, other_name, &other));
+  auto other_files = [other]() {
+    int result = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      std::string property;
+      EXPECT_TRUE(other->GetProperty(
+          "leveldb.num-files-at-level" + NumberToString(level), &property));
+      result += std::stoi(property);
+    }
+    return result;
+  };
+  const std::string value(1000, 'v');
+  for (int i = 0; i < 600; i++) {
+    ASSERT_LEVELDB_OK(other->Put(WriteOptions(), Key(i), value));
+  }
+  ASSERT_EQ(0, other_files());
+  const size_t other_usage = manager.memory_usage();
+
+  // Writes to this DB push the total over the budget, and the other DB,
+  // holding the larger memtable, flushes it.
+  for (int i = 0; i < 300; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), value));
+  }
+  ASSERT_LT(manager.mutable_memory_usage(), other_usage);
+  ASSERT_LEVELDB_OK(reinterpret_cast<DBImpl*>(other)->TEST_CompactMemTable());
+  ASSERT_GT(other_files(), 0);
+  ASSERT_EQ(0, TotalTableFiles());
+  for (int i = 0; i < 600; i++) {
+    std::string result;
+    ASSERT_LEVELDB_OK(other->Get(ReadOptions(), Key(i), &result));
+    ASSERT_EQ(value, result);
+  }
+
+  // Closed DBs no longer count.
+  delete other;
+  DestroyDB(other_name, Options());
+  Close();
+  ASSERT_EQ(0, manager.memory_usage());
+  ASSERT_EQ(0, manager.mutable_memory_usage());
+}
+
+namespace {
+
+struct WriteBufferManagerThread {
+  DB* db;
+  std::atomic<bool> done;
+};
+
+void FillForWriteBufferManager(void* arg) {
+  auto* t = reinterpret_cast<WriteBufferManagerThread*>(arg);
+  for (int i = 0; i < 3000; i++) {
+    t->db->Put(WriteOptions(), Key(i), std::string(1000, 'v'));
+  }
+  t->done.store(true, std::memory_order_release);
+}
+
+void CloseForWriteBufferManager(void* arg) {
+  auto* t = reinterpret_cast<WriteBufferManagerThread*>(arg);
+  for (int i = 0; i < 10; i++) {
+    t->db->Put(WriteOptions(), Key(i), std::string(1000, 'v'));
+  }
+  delete t->db;
+  t->done.store(true, std::memory_order_release);
+}
+
+}  // namespace
+
+TEST_F(DBTest, WriteBufferManagerStalledFlush) {
+  WriteBufferManager manager(1 << 20);
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.write_buffer_size = 100 << 20;  // Only the manager flushes
+  options.write_buffer_manager = &manager;
+  Reopen(&options);
+
+  const std::string other_name = testing::TempDir() + "db_test_other";
+  DestroyDB(other_name, Options());
+  Options other_options;
+  other_options.create_if_missing = true;
+  other_options.write_buffer_size = 100 << 20;
+  other_options.write_buffer_manager = &manager;
+  WriteBufferManagerThread closer;
+  closer.done = false;
+  ASSERT_LEVELDB_OK(DB::Open(other_options, other_name, &closer.db));
+
+  // The first flush of this DB leaves a memtable whose write is blocked,
+  // and the next one waits for it.
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+  WriteBufferManagerThread writer;
+  writer.db = db_;
+  writer.done = false;
+  env_->StartThread(FillForWriteBufferManager, &writer);
+  DelayMilliseconds(500);
+
+  // Writers of the other DB, and its closing, are not held up meanwhile.
+  env_->StartThread(CloseForWriteBufferManager, &closer);
+  for (int i = 0; i < 50 && !closer.done.load(std::memory_order_acquire);
+       i++) {
+    DelayMilliseconds(100);
+  }
+  const bool closed = closer.done.load(std::memory_order_acquire);
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  while (!writer.done.load(std::memory_order_acquire) ||
+         !closer.done.load(std::memory_order_acquire)) {
+    DelayMilliseconds(10);
+  }
+  ASSERT_TRUE(closed);
+  DestroyDB(other_name, Options());
+  Close();
+}
+
+TEST_F(DBTest, MemoryUsage) {
+  const FilterPolicy* policy = NewBloomFilterPolicy(10);
+  Options options = CurrentOptions();
+  options.filter_policy = policy;
+  Reopen(&options);
+  MemoryUsage usage;
+  ASSERT_LEVELDB_OK(db_->GetMemoryUsage(&usage));
+  ASSERT_GT(usage.mem_table, 0);
+  ASSERT_EQ(0, usage.table_readers);
+  ASSERT_EQ(config::kNumLevels, usage.level_filters.size());
+
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), std::string(100, 'v')));
+  }
+  Compact("a", "z");
+  ASSERT_LEVELDB_OK(db_->GetMemoryUsage(&usage));
+  ASSERT_GT(usage.table_readers, 0);
+  size_t filters = 0;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    ASSERT_EQ(NumTableFilesAtLevel(level) > 0, usage.level_filters[level] > 0)
+        << level;
+    filters += usage.level_filters[level];
+  }
+  ASSERT_LT(filters, usage.table_readers);
+
+  // Blocks held by iterators are counted until the iterators are deleted.
+  ASSERT_EQ(0, usage.iterator_blocks);
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->SeekToFirst();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_LEVELDB_OK(db_->GetMemoryUsage(&usage));
+  ASSERT_GT(usage.iterator_blocks, 0);
+  ASSERT_GT(usage.block_cache, 0);
+  delete iter;
+  ASSERT_LEVELDB_OK(db_->GetMemoryUsage(&usage));
+  ASSERT_EQ(0, usage.iterator_blocks);
+
+  // Another DB does not report the tables of this one.
+  const std::string other_name = testing::TempDir() + "db_test_other";
+  DestroyDB(other_name, Options());
+  DB* other = nullptr;
+  options.create_if_missing = true;
+  ASSERT_LEVELDB_OK(DB::Open(options, other_name, &other));
+  ASSERT_LEVELDB_OK(other->GetMemoryUsage(&usage));
+  ASSERT_EQ(0, usage.table_readers);
+  delete other;
+  DestroyDB(other_name, Options());
+
+  Close();
+  delete policy;
+}
+
+TEST_F(DBTest, SharedPersistentCache) {
+  const std::string cache_dir = testing::TempDir() + "db_test_pcache";
+  PersistentCache* persistent_cache;
+  ASSERT_LEVELDB_OK(
+      NewPersistentCache(env_, cache_dir, 1 << 20, &persistent_cache));
+  Options options = CurrentOptions();
+  options.persistent_cache = persistent_cache;  // Each DB's own block cache
+  Reopen(&options);
+
+  // Both DBs hold "k" in a block at the same offset of table files with
+  // the same number.
+  const std::string other_name = testing::TempDir() + "db_test_other";
+  DestroyDB(other_name, Options());
+  DB* other = nullptr;
+  options.create_if_missing = true;
+  ASSERT_LEVELDB_OK(DB::Open(options, other_name, &other));
+  ASSERT_LEVELDB_OK(Put("k", "v0"));
+  ASSERT_LEVELDB_OK(other->Put(WriteOptions(), "k", "v1"));
+  db_->CompactRange(nullptr, nullptr);
+  other->CompactRange(nullptr, nullptr);
+
+  std::string value;
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ("v0", Get("k"));
+    ASSERT_LEVELDB_OK(other->Get(ReadOptions(), "k", &value));
+    ASSERT_EQ("v1", value);
+    Reopen(&options);  // Starts a new block cache
+  }
+  ASSERT_GT(persistent_cache->TotalSize(), 0);
+
+  delete other;
+  DestroyDB(other_name, Options());
+  Close();
+  delete persistent_cache;
+  env_->RemoveDir(cache_dir);
+}
+
+static void AppendValue(void* arg, const Slice& value) {
+  reinterpret_cast<std::string*>(arg)->append(value.data(), value.size());
+}
+
+TEST_F(DBTest, GetPinned) {
+  do {
+    std::string value;
+    ASSERT_TRUE(db_->GetPinned(ReadOptions(), "foo", &value, &AppendValue)
+                    .IsNotFound());
+    ASSERT_LEVELDB_OK(Put("foo", "v1"));
+    ASSERT_LEVELDB_OK(Put("bar", "v2"));
+    ASSERT_LEVELDB_OK(
+        db_->GetPinned(ReadOptions(), "foo", &value, &AppendValue));
+    ASSERT_EQ("v1", value);
+
+    // From a table, through the block cache.
+    ASSERT_LEVELDB_OK(dbfull()->TEST_CompactMemTable());
+    for (int i = 0; i < 2; i++) {
+      value.clear();
+      ASSERT_LEVELDB_OK(
+          db_->GetPinned(ReadOptions(), "bar", &value, &AppendValue));
+      ASSERT_EQ("v2", value);
+    }
+
+    ASSERT_LEVELDB_OK(Delete("foo"));
+    value.clear();
+    ASSERT_TRUE(db_->GetPinned(ReadOptions(), "foo", &value, &AppendValue)
+                    .IsNotFound());
+    ASSERT_EQ("", value);
+  } while (ChangeOptions());
+}
+
+TEST_F(DBTest, MultiGet) {
+  do {
+    ASSERT_LEVELDB_OK(Put("a", "va"));
+    ASSERT_LEVELDB_OK(Put("c", "vc"));
+    ASSERT_LEVELDB_OK(Put("e", "ve"));
+    ASSERT_LEVELDB_OK(dbfull()->TEST_CompactMemTable());
+    ASSERT_LEVELDB_OK(Put("b", "vb"));
+    ASSERT_LEVELDB_OK(Put("c", "vc2"));
+    ASSERT_LEVELDB_OK(Delete("e"));
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ASSERT_LEVELDB_OK(Put("a", "va2"));
+
+    // Keys from the memtable and from a table, in no particular order.
+    const int kNumKeys = 6;
+    const Slice keys[kNumKeys] = {"e", "c", "missing", "a", "b", "a"};
+    std::string values[kNumKeys];
+    Status statuses[kNumKeys];
+    db_->MultiGet(ReadOptions(), kNumKeys, keys, values, statuses);
+    ASSERT_TRUE(statuses[0].IsNotFound());
+    ASSERT_LEVELDB_OK(statuses[1]);
+    ASSERT_EQ("vc2", values[1]);
+    ASSERT_TRUE(statuses[2].IsNotFound());
+    ASSERT_LEVELDB_OK(statuses[3]);
+    ASSERT_EQ("va2", values[3]);
+    ASSERT_LEVELDB_OK(statuses[4]);
+    ASSERT_EQ("vb", values[4]);
+    ASSERT_EQ("va2", values[5]);
+
+    ReadOptions options;
+    options.snapshot = snapshot;
+    db_->MultiGet(options, kNumKeys, keys, values, statuses);
+    ASSERT_LEVELDB_OK(statuses[3]);
+    ASSERT_EQ("va", values[3]);
+    db_->ReleaseSnapshot(snapshot);
+  } while (ChangeOptions());
+}
+
+TEST_F(DBTest, MultiGetSharesTableReads) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Every block read goes to the file
+  Reopen(&options);
+
+  const int N = 100;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), std::string(100, 'a' + i % 26)));
+  }
+  Compact("a", "z");
+  ASSERT_EQ(1, TotalTableFiles());
+  ASSERT_EQ("NOT_FOUND", Get("missing"));  // Opens the table
+
+  std::vector<Slice> keys;
+  std::vector<std::string> key_storage(N);
+  for (int i = 0; i < N; i++) {
+    key_storage[i] = Key(N - 1 - i);
+    keys.push_back(key_storage[i]);
+  }
+
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    std::string value;
+    ASSERT_LEVELDB_OK(db_->Get(ReadOptions(), keys[i], &value));
+  }
+  const int get_reads = env_->random_read_counter_.Read();
+  ASSERT_GE(get_reads, N);
+
+  // Each data block is read once for all the keys it holds.
+  std::vector<std::string> values(N);
+  std::vector<Status> statuses(N);
+  env_->random_read_counter_.Reset();
+  db_->MultiGet(ReadOptions(), N, keys.data(), values.data(),
+                statuses.data());
+  const int multi_get_reads = env_->random_read_counter_.Read();
+  ASSERT_LT(multi_get_reads, get_reads / 10);
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(statuses[i]);
+    ASSERT_EQ(std::string(100, 'a' + (N - 1 - i) % 26), values[i]);
+  }
+
+  env_->count_random_reads_ = false;
+  Close();
+  delete options.block_cache;
+}
+
+TEST_F(DBTest, Checkpoint) {
+  const std::string checkpoint_dir = dbname_ + "_checkpoint";
+  DestroyDB(checkpoint_dir, Options());
+
+  const int N = 200;
+  for (int i = 0; i < N / 2; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+  ASSERT_GT(TotalTableFiles(), 0);
+  for (int i = N / 2; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));  // Only in the log
+  }
+  ASSERT_LEVELDB_OK(Delete(Key(5)));
+  ASSERT_LEVELDB_OK(Put(Key(6), "v6"));
+
+  // The temporary directory is never taken over.
+  const std::string tmp_dir = checkpoint_dir + ".tmp";
+  ASSERT_LEVELDB_OK(env_->CreateDir(tmp_dir));
+  ASSERT_LEVELDB_OK(WriteStringToFile(env_, "mine", tmp_dir + "/file"));
+  ASSERT_TRUE(db_->CreateCheckpoint(checkpoint_dir).IsInvalidArgument());
+  ASSERT_TRUE(env_->FileExists(tmp_dir + "/file"));
+  ASSERT_LEVELDB_OK(env_->RemoveFile(tmp_dir + "/file"));
+  ASSERT_LEVELDB_OK(env_->RemoveDir(tmp_dir));
+
+  ASSERT_LEVELDB_OK(db_->CreateCheckpoint(checkpoint_dir));
+  ASSERT_TRUE(db_->CreateCheckpoint(checkpoint_dir).IsInvalidArgument());
+
+  // Later writes and compactions do not reach the checkpoint, and the
+  // checkpoint outlives the DB.
+  ASSERT_LEVELDB_OK(Put(Key(N), "later"));
+  Compact("a", "z");
+  Close();
+  ASSERT_LEVELDB_OK(DestroyDB(dbname_, Options()));
+
+  Options options;
+  DB* db = nullptr;
+  ASSERT_LEVELDB_OK(DB::Open(options, checkpoint_dir, &db));
+  std::string value;
+  for (int i = 0; i <= N; i++) {
+    Status s = db->Get(ReadOptions(), Key(i), &value);
+    if (i == 5 || i == N) {
+      ASSERT_TRUE(s.IsNotFound()) << i;
+    } else {
+      ASSERT_LEVELDB_OK(s);
+      ASSERT_EQ(i == 6 ? "v6" : Key(i), value);
+    }
+  }
+  delete db;
+  ASSERT_LEVELDB_OK(DestroyDB(checkpoint_dir, Options()));
+}
+
+TEST_F(DBTest, LevelFilterPolicies) {
+  const FilterPolicy* policy = NewBloomFilterPolicy(10);
+  for (int config = 0; config < 2; config++) {
+    env_->count_random_reads_ = true;
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.create_if_missing = true;
+    options.block_cache = NewLRUCache(0);  // Prevent cache hits
+    options.filter_policy = policy;
+    if (config == 0) {
+      options.optimize_filters_for_hits = true;
+    } else {
+      // Filters on level 0 only
+      options.level_filter_policies.assign(config::kNumLevels, nullptr);
+      options.level_filter_policies[0] = policy;
+    }
+    DestroyAndReopen(&options);
+
+    // Two overlapping flushes so that the range compaction really merges
+    // them into the bottom level instead of moving a file down.
+    const int N = 10000;
+    for (int i = 0; i < N; i++) {
+      ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+    }
+    dbfull()->TEST_CompactMemTable();
+    for (int i = 0; i < N; i++) {
+      ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+    }
+    dbfull()->TEST_CompactMemTable();
+    Compact("a", "z");
+    ASSERT_EQ("0,0,1", FilesPerLevel());
+
+    // A small memtable flush, which is written with the level-0 filter
+    for (int i = 0; i < N; i += 100) {
+      ASSERT_LEVELDB_OK(Put(Key(i), Key(i)));
+    }
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_EQ("0,1,1", FilesPerLevel());
+
+    // Prevent auto compactions triggered by seeks
+    env_->delay_data_sync_.store(true, std::memory_order_release);
+
+    env_->random_read_counter_.Reset();
+    for (int i = 0; i < N; i++) {
+      ASSERT_EQ(Key(i), Get(Key(i)));
+    }
+    int reads = env_->random_read_counter_.Read();
+    ASSERT_GE(reads, N);
+    ASSERT_LE(reads, N + 2 * N / 100);
+
+    // Missing keys skip the level-0 table but read the unfiltered bottom.
+    env_->random_read_counter_.Reset();
+    for (int i = 0; i < N; i++) {
+      ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+    }
+    reads = env_->random_read_counter_.Read();
+    ASSERT_GE(reads, N);
+    ASSERT_LE(reads, N + 3 * N / 100);
+
+    env_->delay_data_sync_.store(false, std::memory_order_release);
+    Close();
+    delete options.block_cache;
+  }
+  delete policy;
+}
+
 // Multi-threaded test:
 namespace {
 
@@ -68,7 +68,12 @@ std::string OldInfoLogFileName(const std::string& dbname) {
   return dbname + "/LOG.old";
 }
 
+std::string BlockCacheFileName(const std::string& dbname) {
+  return dbname + "/BLOCKCACHE";
+}
+
 // Owned filenames have the form:
+//    dbname/BLOCKCACHE
 //    dbname/CURRENT
 //    dbname/LOCK
 //    dbname/LOG
@@ -87,6 +92,9 @@ bool ParseFileName(const std::string& filename, uint64_t* number,
   } else if (rest == "LOG" || rest == "LOG.old") {
     *number = 0;
     *type = kInfoLogFile;
+  } else if (rest == "BLOCKCACHE") {
+    *number = 0;
+    *type = kBlockCacheFile;
   } else if (rest.starts_with("MANIFEST-")) {
     rest.remove_prefix(strlen("MANIFEST-"));
     uint64_t num;
@@ -42,6 +42,10 @@ class MemTable {
   // data structure. It is safe to call when MemTable is being modified.
   size_t ApproximateMemoryUsage();
 
+  // Returns the part of ApproximateMemoryUsage() allocated but left unused.
+  // It is safe to call when MemTable is being modified.
+  size_t ApproximateUnusedMemory() { return arena_.UnusedMemory(); }
+
   // Return an iterator that yields the contents of the memtable.
   //
   // The caller must ensure that the underlying MemTable remains live
@@ -56,11 +60,12 @@ class MemTable {
   void Add(SequenceNumber seq, ValueType type, const Slice& key,
            const Slice& value);
 
-  // If memtable contains a value for key, store it in *value and return true.
-  // If memtable contains a deletion for key, store a NotFound() error
-  // in *status and return true.
+  // If memtable contains a value for key, call (*save_value)(arg, value)
+  // and return true.  If memtable contains a deletion for key, store a
+  // NotFound() error in *status and return true.
   // Else, return false.
-  bool Get(const LookupKey& key, std::string* value, Status* s);
+  bool Get(const LookupKey& key, void* arg,
+           void (*save_value)(void* arg, const Slice& value), Status* s);
 
  private:
   friend class MemTableIterator;
@@ -4,6 +4,9 @@
 
 #include "db/table_cache.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "db/filename.h"
 #include "leveldb/env.h"
 #include "leveldb/table.h"
@@ -29,12 +32,42 @@ static void UnrefEntry(void* arg1, void* arg2) {
   cache->Release(h);
 }
 
+// A row cache entry is the internal key and value found by a lookup:
+//    key_length: varint32
+//    key: char[key_length]
+//    value: char[rest]
+static void DeleteRow(const Slice& key, void* value) {
+  delete reinterpret_cast<std::string*>(value);
+}
+
+namespace {
+// Passes the result of a table lookup on to the caller's callback and
+// keeps a copy of it for the row cache.
+struct RowSaver {
+  void* arg;
+  void (*handle_result)(void*, const Slice&, const Slice&);
+  bool found;
+  std::string entry;
+};
+}  // namespace
+
+static void SaveRow(void* arg, const Slice& k, const Slice& v) {
+  RowSaver* saver = reinterpret_cast<RowSaver*>(arg);
+  saver->found = true;
+  PutLengthPrefixedSlice(&saver->entry, k);
+  saver->entry.append(v.data(), v.size());
+  (*saver->handle_result)(saver->arg, k, v);
+}
+
 TableCache::TableCache(const std::string& dbname, const Options& options,
                        int entries)
     : env_(options.env),
       dbname_(dbname),
       options_(options),
-      cache_(NewLRUCache(entries)) {}
+      cache_(NewLRUCache(entries)),
+      row_cache_id_(options.row_cache != nullptr ? options.row_cache->NewId()
+                                                 : 0),
+      iterator_usage_(0) {}
 
 TableCache::~TableCache() { delete cache_; }
 
@@ -59,6 +92,9 @@ Status TableCache::FindTable(uint64_t file_number, uint64_t file_size,
     if (s.ok()) {
       s = Table::Open(options_, file, file_size, &table);
     }
+    if (s.ok()) {
+      table->SetIteratorUsage(&iterator_usage_);
+    }
 
     if (!s.ok()) {
       assert(table == nullptr);
@@ -101,11 +137,235 @@ Status TableCache::Get(const ReadOptions& options, uint64_t file_number,
                        uint64_t file_size, const Slice& k, void* arg,
                        void (*handle_result)(void*, const Slice&,
                                              const Slice&)) {
+  Cache* row_cache = options_.row_cache;
+  std::string row_key;
+  if (row_cache != nullptr) {
+    row_key = RowKey(file_number, k);
+    if (LookupRow(row_key, k, arg, handle_result)) {
+      return Status::OK();
+    }
+  }
+
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, &handle);
+  if (s.ok()) {
+    Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    if (row_cache == nullptr || options.snapshot != nullptr ||
+        !options.fill_cache) {
+      s = t->InternalGet(options, k, arg, handle_result);
+    } else {
+      // Without a snapshot the read sees every entry in the table, so what
+      // it finds is the newest entry for the key in this table.
+      RowSaver saver;
+      saver.arg = arg;
+      saver.handle_result = handle_result;
+      saver.found = false;
+      s = t->InternalGet(options, k, &saver, SaveRow);
+      if (s.ok() && saver.found) {
+        InsertRow(row_key, k, &saver.entry);
+      }
+    }
+    cache_->Release(handle);
+  }
+  return s;
+}
+
+void TableCache::MultiGet(const ReadOptions& options, uint64_t file_number,
+                          uint64_t file_size, int n, const Slice* keys,
+                          void* const* args,
+                          void (*handle_result)(void*, const Slice&,
+                                                const Slice&),
+                          Status* statuses) {
+  // The keys the row cache does not answer.
+  Cache* row_cache = options_.row_cache;
+  std::vector<int> index;
+  std::vector<Slice> table_keys;
+  std::vector<std::string> row_keys;
+  for (int i = 0; i < n; i++) {
+    statuses[i] = Status::OK();
+    if (row_cache != nullptr) {
+      std::string row_key = RowKey(file_number, keys[i]);
+      if (LookupRow(row_key, keys[i], args[i], handle_result)) {
+        continue;
+      }
+      row_keys.push_back(std::move(row_key));
+    }
+    index.push_back(i);
+    table_keys.push_back(keys[i]);
+  }
+  if (index.empty()) {
+    return;
+  }
+
+  Cache::Handle* handle = nullptr;
+  Status s = FindTable(file_number, file_size, &handle);
+  if (!s.ok()) {
+    for (int i : index) {
+      statuses[i] = s;
+    }
+    return;
+  }
+  Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+  const int m = static_cast<int>(index.size());
+  std::vector<Status> table_statuses(m);
+  if (row_cache == nullptr || options.snapshot != nullptr ||
+      !options.fill_cache) {
+    std::vector<void*> table_args(m);
+    for (int j = 0; j < m; j++) {
+      table_args[j] = args[index[j]];
+    }
+    t->InternalMultiGet(options, m, table_keys.data(), table_args.data(),
+                        handle_result, table_statuses.data());
+  } else {
+    // As in Get(), what a read without a snapshot finds goes into the row
+    // cache.
+    std::vector<RowSaver> savers(m);
+    std::vector<void*> table_args(m);
+    for (int j = 0; j < m; j++) {
+      savers[j].arg = args[index[j]];
+      savers[j].handle_result = handle_result;
+      savers[j].found = false;
+      table_args[j] = &savers[j];
+    }
+    t->InternalMultiGet(options, m, table_keys.data(), table_args.data(),
+                        SaveRow, table_statuses.data());
+    for (int j = 0; j < m; j++) {
+      if (table_statuses[j].ok() && savers[j].found) {
+        InsertRow(row_keys[j], table_keys[j], &savers[j].entry);
+      }
+    }
+  }
+  for (int j = 0; j < m; j++) {
+    statuses[index[j]] = table_statuses[j];
+  }
+  cache_->Release(handle);
+}
+
+std::string TableCache::RowKey(uint64_t file_number, const Slice& k) const {
+  // The same user key in different tables, or in tables of different
+  // databases sharing the cache, must not collide.
+  const Slice user_key = ExtractUserKey(k);
+  std::string row_key;
+  PutFixed64(&row_key, row_cache_id_);
+  PutFixed64(&row_key, file_number);
+  row_key.append(user_key.data(), user_key.size());
+  return row_key;
+}
+
+void TableCache::InsertRow(const Slice& row_key, const Slice& k,
+                           std::string* entry) {
+  Slice input(*entry);
+  Slice found_key;
+  if (GetLengthPrefixedSlice(&input, &found_key) && found_key.size() >= 8 &&
+      ExtractUserKey(found_key) == ExtractUserKey(k)) {
+    Cache* row_cache = options_.row_cache;
+    const size_t charge = row_key.size() + entry->size();
+    std::string* value = new std::string;
+    value->swap(*entry);
+    row_cache->Release(row_cache->Insert(row_key, value, charge, &DeleteRow));
+  }
+}
+
+bool TableCache::LookupRow(const Slice& row_key, const Slice& k, void* arg,
+                           void (*handle_result)(void*, const Slice&,
+                                                 const Slice&)) {
+  Cache* row_cache = options_.row_cache;
+  Cache::Handle* handle = row_cache->Lookup(row_key);
+  if (handle == nullptr) {
+    return false;
+  }
+  const std::string* entry =
+      reinterpret_cast<const std::string*>(row_cache->Value(handle));
+  Slice value(*entry);
+  Slice found_key;
+  bool hit = false;
+  if (GetLengthPrefixedSlice(&value, &found_key) && found_key.size() >= 8) {
+    // The cached entry is the newest for the key in this table, so it is
+    // the answer to any read whose sequence number is at least its own.
+    const uint64_t found_seq =
+        DecodeFixed64(found_key.data() + found_key.size() - 8) >> 8;
+    const uint64_t read_seq = DecodeFixed64(k.data() + k.size() - 8) >> 8;
+    if (found_seq <= read_seq) {
+      (*handle_result)(arg, found_key, value);
+      hit = true;
+    }
+  }
+  row_cache->Release(handle);
+  return hit;
+}
+
+namespace {
+struct CachedBlocks {
+  std::map<uint64_t, uint64_t> files;  // Block cache id -> file number
+  std::map<uint64_t, std::vector<uint64_t>>* blocks;
+};
+}  // namespace
+
+void TableCache::AddTableCacheId(void* arg, const Slice& key, void* value) {
+  CachedBlocks* cached = reinterpret_cast<CachedBlocks*>(arg);
+  const Table* table = reinterpret_cast<TableAndFile*>(value)->table;
+  cached->files[table->CacheId()] = DecodeFixed64(key.data());
+}
+
+void TableCache::AddCachedBlock(void* arg, const Slice& key, void* value) {
+  CachedBlocks* cached = reinterpret_cast<CachedBlocks*>(arg);
+  if (key.size() != 16) {
+    return;
+  }
+  // Block cache keys are the table's cache id followed by the offset.
+  auto it = cached->files.find(DecodeFixed64(key.data()));
+  if (it != cached->files.end()) {
+    (*cached->blocks)[it->second].push_back(DecodeFixed64(key.data() + 8));
+  }
+}
+
+void TableCache::GetCachedBlocks(
+    std::map<uint64_t, std::vector<uint64_t>>* blocks) {
+  blocks->clear();
+  CachedBlocks cached;
+  cached.blocks = blocks;
+  cache_->ApplyToAllEntries(&AddTableCacheId, &cached);
+  options_.block_cache->ApplyToAllEntries(&AddCachedBlock, &cached);
+  for (auto& file : *blocks) {
+    std::sort(file.second.begin(), file.second.end());
+  }
+}
+
+namespace {
+struct MemoryUsageState {
+  size_t usage;
+  std::map<uint64_t, size_t>* filter_usage;
+};
+}  // namespace
+
+void TableCache::AddMemoryUsage(void* arg, const Slice& key, void* value) {
+  MemoryUsageState* state = reinterpret_cast<MemoryUsageState*>(arg);
+  const Table* table = reinterpret_cast<TableAndFile*>(value)->table;
+  size_t usage, filter_usage;
+  table->GetMemoryUsage(&usage, &filter_usage);
+  state->usage += usage;
+  if (filter_usage > 0) {
+    (*state->filter_usage)[DecodeFixed64(key.data())] = filter_usage;
+  }
+}
+
+void TableCache::GetMemoryUsage(size_t* usage,
+                                std::map<uint64_t, size_t>* filter_usage) {
+  filter_usage->clear();
+  MemoryUsageState state;
+  state.usage = 0;
+  state.filter_usage = filter_usage;
+  cache_->ApplyToAllEntries(&AddMemoryUsage, &state);
+  *usage = state.usage;
+}
+
+Status TableCache::PrefetchBlocks(uint64_t file_number, uint64_t file_size,
+                                  const std::vector<uint64_t>& offsets) {
   Cache::Handle* handle = nullptr;
   Status s = FindTable(file_number, file_size, &handle);
   if (s.ok()) {
     Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
-    s = t->InternalGet(options, k, arg, handle_result);
+    s = t->PrefetchBlocks(offsets);
     cache_->Release(handle);
   }
   return s;
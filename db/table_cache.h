@@ -7,8 +7,11 @@
 #ifndef STORAGE_LEVELDB_DB_TABLE_CACHE_H_
 #define STORAGE_LEVELDB_DB_TABLE_CACHE_H_
 
+#include <atomic>
 #include <cstdint>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "db/dbformat.h"
 #include "leveldb/cache.h"
@@ -35,23 +38,75 @@ class TableCache {
                         uint64_t file_size, Table** tableptr = nullptr);
 
   // If a seek to internal key "k" in specified file finds an entry,
-  // call (*handle_result)(arg, found_key, found_value).
+  // call (*handle_result)(arg, found_key, found_value).  Consults and
+  // fills options.row_cache if one is set.
   Status Get(const ReadOptions& options, uint64_t file_number,
              uint64_t file_size, const Slice& k, void* arg,
              void (*handle_result)(void*, const Slice&, const Slice&));
 
+  // Does what Get() does for each of the "n" internal keys, which must be
+  // sorted, passing args[i] to (*handle_result) and storing the status in
+  // statuses[i].  The table is looked up once for all of them.
+  void MultiGet(const ReadOptions& options, uint64_t file_number,
+                uint64_t file_size, int n, const Slice* keys,
+                void* const* args,
+                void (*handle_result)(void*, const Slice&, const Slice&),
+                Status* statuses);
+
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
 
+  // Store in *blocks, keyed by file number, the sorted offsets of the
+  // blocks of open tables that are in options.block_cache.
+  void GetCachedBlocks(std::map<uint64_t, std::vector<uint64_t>>* blocks);
+
+  // Read the data blocks at the sorted "offsets" of the specified file into
+  // options.block_cache.
+  Status PrefetchBlocks(uint64_t file_number, uint64_t file_size,
+                        const std::vector<uint64_t>& offsets);
+
+  // Store in *usage the memory held by open tables outside
+  // options.block_cache, and in (*filter_usage)[file_number] the part of it
+  // held by the filter of each table that has one there.
+  void GetMemoryUsage(size_t* usage, std::map<uint64_t, size_t>* filter_usage);
+
+  // Return the size of the data blocks held by live iterators over tables.
+  size_t IteratorUsage() const {
+    return iterator_usage_.load(std::memory_order_relaxed);
+  }
+
   size_t TotalCharge() const { return cache_->TotalCharge(); }
 
  private:
   Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
 
+  // Cache::ApplyToAllEntries() callbacks for GetCachedBlocks().
+  static void AddTableCacheId(void* arg, const Slice& key, void* value);
+  static void AddCachedBlock(void* arg, const Slice& key, void* value);
+
+  // Cache::ApplyToAllEntries() callback for GetMemoryUsage().
+  static void AddMemoryUsage(void* arg, const Slice& key, void* value);
+
+  // Returns the options_.row_cache key of the user key of internal key
+  // "k" in the specified file.
+  std::string RowKey(uint64_t file_number, const Slice& k) const;
+
+  // Inserts into options_.row_cache under "row_key" the entry found by a
+  // read of internal key "k", if it is for the same user key.  Takes the
+  // contents of *entry.
+  void InsertRow(const Slice& row_key, const Slice& k, std::string* entry);
+
+  // If options_.row_cache holds an entry for "row_key" that answers a read
+  // of internal key "k", pass it to (*handle_result) and return true.
+  bool LookupRow(const Slice& row_key, const Slice& k, void* arg,
+                 void (*handle_result)(void*, const Slice&, const Slice&));
+
   Env* const env_;
   const std::string dbname_;
   const Options& options_;
   Cache* cache_;
+  const uint64_t row_cache_id_;
+  std::atomic<size_t> iterator_usage_;
 };
 
 }  // namespace leveldb
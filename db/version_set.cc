@@ -256,7 +256,8 @@ struct Saver {
   SaverState state;
   const Comparator* ucmp;
   Slice user_key;
-  std::string* value;
+  void* arg;
+  void (*save_value)(void* arg, const Slice& value);
 };
 }  // namespace
 static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
@@ -268,7 +269,7 @@ static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
     if (s->ucmp->Compare(parsed_key.user_key, s->user_key) == 0) {
       s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
       if (s->state == kFound) {
-        s->value->assign(v.data(), v.size());
+        (*s->save_value)(s->arg, v);
       }
     }
   }
@@ -322,7 +323,9 @@ void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
 }
 
 Status Version::Get(const ReadOptions& options, const LookupKey& k,
-                    std::string* value, GetStats* stats) {
+                    void* arg,
+                    void (*save_value)(void* arg, const Slice& value),
+                    GetStats* stats) {
   stats->seek_file = nullptr;
   stats->seek_file_level = -1;
 
@@ -392,13 +395,147 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
   state.saver.state = kNotFound;
   state.saver.ucmp = vset_->icmp_.user_comparator();
   state.saver.user_key = k.user_key();
-  state.saver.value = value;
+  state.saver.arg = arg;
+  state.saver.save_value = save_value;
 
   ForEachOverlapping(state.saver.user_key, state.ikey, &state, &State::Match);
 
   return state.found ? state.s : Status::NotFound(Slice());
 }
 
+void Version::MultiGet(const ReadOptions& options, int n,
+                       const LookupKey* const* keys, void* const* args,
+                       void (*save_value)(void* arg, const Slice& value),
+                       Status* statuses, std::vector<GetStats>* stats) {
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+
+  // What the State of Get() keeps for one key.
+  struct KeyState {
+    Saver saver;
+    FileMetaData* last_file_read;
+    int last_file_read_level;
+    bool done;
+  };
+  std::vector<KeyState> states(n);
+  stats->assign(n, GetStats{nullptr, -1});
+  for (int i = 0; i < n; i++) {
+    KeyState& state = states[i];
+    state.saver.state = kNotFound;
+    state.saver.ucmp = ucmp;
+    state.saver.user_key = keys[i]->user_key();
+    state.saver.arg = args[i];
+    state.saver.save_value = save_value;
+    state.last_file_read = nullptr;
+    state.last_file_read_level = -1;
+    state.done = false;
+    statuses[i] = Status::NotFound(Slice());
+  }
+
+  // Searches "f" for the keys in "batch", as State::Match() in Get() does
+  // for one key, and empties "batch".
+  std::vector<int> batch;
+  std::vector<Slice> batch_keys;
+  std::vector<void*> batch_args;
+  std::vector<Status> batch_statuses;
+  auto search = [&](int level, FileMetaData* f) {
+    for (int i : batch) {
+      KeyState& state = states[i];
+      GetStats& key_stats = (*stats)[i];
+      if (key_stats.seek_file == nullptr && state.last_file_read != nullptr) {
+        // We have had more than one seek for this read.  Charge the 1st file.
+        key_stats.seek_file = state.last_file_read;
+        key_stats.seek_file_level = state.last_file_read_level;
+      }
+      state.last_file_read = f;
+      state.last_file_read_level = level;
+      batch_keys.push_back(keys[i]->internal_key());
+      batch_args.push_back(&state.saver);
+    }
+    const int m = static_cast<int>(batch.size());
+    batch_statuses.resize(m);
+    vset_->table_cache_->MultiGet(options, f->number, f->file_size, m,
+                                  batch_keys.data(), batch_args.data(),
+                                  SaveValue, batch_statuses.data());
+    for (int j = 0; j < m; j++) {
+      KeyState& state = states[batch[j]];
+      Status* s = &statuses[batch[j]];
+      if (!batch_statuses[j].ok()) {
+        *s = batch_statuses[j];
+        state.done = true;
+        continue;
+      }
+      switch (state.saver.state) {
+        case kNotFound:
+          break;  // Keep searching in other files
+        case kFound:
+          *s = Status::OK();
+          state.done = true;
+          break;
+        case kDeleted:
+          state.done = true;
+          break;
+        case kCorrupt:
+          *s = Status::Corruption("corrupted key for ", state.saver.user_key);
+          state.done = true;
+          break;
+      }
+    }
+    batch.clear();
+    batch_keys.clear();
+    batch_args.clear();
+  };
+
+  // Search level-0 in order from newest to oldest, each file for all the
+  // keys in its range.
+  std::vector<FileMetaData*> tmp(files_[0]);
+  std::sort(tmp.begin(), tmp.end(), NewestFirst);
+  for (FileMetaData* f : tmp) {
+    for (int i = 0; i < n; i++) {
+      if (!states[i].done &&
+          ucmp->Compare(keys[i]->user_key(), f->smallest.user_key()) >= 0 &&
+          ucmp->Compare(keys[i]->user_key(), f->largest.user_key()) <= 0) {
+        batch.push_back(i);
+      }
+    }
+    if (!batch.empty()) {
+      search(0, f);
+    }
+  }
+
+  // Search other levels.  Their files are sorted and disjoint, so the keys
+  // falling in one file are next to each other.
+  for (int level = 1; level < config::kNumLevels; level++) {
+    size_t num_files = files_[level].size();
+    if (num_files == 0) continue;
+
+    FileMetaData* batch_file = nullptr;
+    for (int i = 0; i < n; i++) {
+      if (states[i].done) continue;
+      FileMetaData* f = nullptr;
+      uint32_t index =
+          FindFile(vset_->icmp_, files_[level], keys[i]->internal_key());
+      if (index < num_files) {
+        f = files_[level][index];
+        if (ucmp->Compare(keys[i]->user_key(), f->smallest.user_key()) < 0) {
+          f = nullptr;  // All of "f" is past any data for the key
+        }
+      }
+      if (f != batch_file) {
+        if (!batch.empty()) {
+          search(level, batch_file);
+        }
+        batch_file = f;
+      }
+      if (f != nullptr) {
+        batch.push_back(i);
+      }
+    }
+    if (!batch.empty()) {
+      search(level, batch_file);
+    }
+  }
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != nullptr) {
@@ -1069,17 +1206,34 @@ void VersionSet::Finalize(Version* v) {
 
 Status VersionSet::WriteSnapshot(log::Writer* log) {
   // TODO: Break up into multiple records to reduce memory usage on recovery?
+  VersionEdit edit;
+  SnapshotEdit(&edit);
 
-  // Save metadata
+  std::string record;
+  edit.EncodeTo(&record);
+  return log->AddRecord(record);
+}
+
+void VersionSet::EncodeSnapshot(std::string* record) {
   VersionEdit edit;
-  edit.SetComparatorName(icmp_.user_comparator()->Name());
+  SnapshotEdit(&edit);
+  edit.SetLogNumber(log_number_);
+  edit.SetPrevLogNumber(prev_log_number_);
+  edit.SetNextFile(next_file_number_);
+  edit.SetLastSequence(last_sequence_);
+  edit.EncodeTo(record);
+}
+
+void VersionSet::SnapshotEdit(VersionEdit* edit) {
+  // Save metadata
+  edit->SetComparatorName(icmp_.user_comparator()->Name());
 
   // Save compaction pointers
   for (int level = 0; level < config::kNumLevels; level++) {
     if (!compact_pointer_[level].empty()) {
       InternalKey key;
       key.DecodeFrom(compact_pointer_[level]);
-      edit.SetCompactPointer(level, key);
+      edit->SetCompactPointer(level, key);
     }
   }
 
@@ -1088,13 +1242,9 @@ Status VersionSet::WriteSnapshot(log::Writer* log) {
     const std::vector<FileMetaData*>& files = current_->files_[level];
     for (size_t i = 0; i < files.size(); i++) {
       const FileMetaData* f = files[i];
-      edit.AddFile(level, f->number, f->file_size, f->smallest, f->largest);
+      edit->AddFile(level, f->number, f->file_size, f->smallest, f->largest);
     }
   }
-
-  std::string record;
-  edit.EncodeTo(&record);
-  return log->AddRecord(record);
 }
 
 int VersionSet::NumLevelFiles(int level) const {
@@ -1147,6 +1297,22 @@ uint64_t VersionSet::ApproximateOffsetOf(Version* v, const InternalKey& ikey) {
   return result;
 }
 
+void Version::GetFileSizes(std::map<uint64_t, uint64_t>* sizes) const {
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (const FileMetaData* f : files_[level]) {
+      (*sizes)[f->number] = f->file_size;
+    }
+  }
+}
+
+void Version::GetFileLevels(std::map<uint64_t, int>* levels) const {
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (const FileMetaData* f : files_[level]) {
+      (*levels)[f->number] = level;
+    }
+  }
+}
+
 void VersionSet::AddLiveFiles(std::set<uint64_t>* live) {
   for (Version* v = dummy_versions_.next_; v != &dummy_versions_;
        v = v->next_) {
@@ -59,8 +59,8 @@ bool SomeFileOverlapsRange(const InternalKeyComparator& icmp,
 
 class Version {
  public:
-  // Lookup the value for key.  If found, store it in *val and
-  // return OK.  Else return a non-OK status.  Fills *stats.
+  // Lookup the value for key.  If found, call (*save_value)(arg, value)
+  // and return OK.  Else return a non-OK status.  Fills *stats.
   // REQUIRES: lock is not held
   struct GetStats {
     FileMetaData* seek_file;
@@ -72,9 +72,20 @@ class Version {
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   void AddIterators(const ReadOptions&, std::vector<Iterator*>* iters);
 
-  Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
+  Status Get(const ReadOptions&, const LookupKey& key, void* arg,
+             void (*save_value)(void* arg, const Slice& value),
              GetStats* stats);
 
+  // Does what Get() does for each of the "n" keys, which must be sorted,
+  // passing args[i] to (*save_value), storing the status in statuses[i]
+  // and the stats in (*stats)[i].  Each table is searched once for all the
+  // keys it may hold.
+  // REQUIRES: lock is not held
+  void MultiGet(const ReadOptions&, int n, const LookupKey* const* keys,
+                void* const* args,
+                void (*save_value)(void* arg, const Slice& value),
+                Status* statuses, std::vector<GetStats>* stats);
+
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
   // REQUIRES: lock is held
@@ -111,6 +122,14 @@ class Version {
 
   int NumFiles(int level) const { return files_[level].size(); }
 
+  // Store in *sizes the size of every table file in this version, keyed by
+  // file number.
+  void GetFileSizes(std::map<uint64_t, uint64_t>* sizes) const;
+
+  // Store in *levels the level of every table file in this version, keyed
+  // by file number.
+  void GetFileLevels(std::map<uint64_t, int>* levels) const;
+
   // Return a human readable string that describes this version's contents.
   std::string DebugString() const;
 
@@ -258,6 +277,10 @@ class VersionSet {
   // May also mutate some internal state.
   void AddLiveFiles(std::set<uint64_t>* live);
 
+  // Store in *record a descriptor record that on its own recovers the
+  // current version: its files plus the log, file and sequence numbers.
+  void EncodeSnapshot(std::string* record);
+
   // Return the approximate offset in the database of the data for
   // "key" as of version "v".
   uint64_t ApproximateOffsetOf(Version* v, const InternalKey& key);
@@ -291,6 +314,9 @@ class VersionSet {
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
 
+  // Add the current contents to *edit
+  void SnapshotEdit(VersionEdit* edit);
+
   void AppendVersion(Version* v);
 
   Env* const env_;
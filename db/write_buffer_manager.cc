@@ -0,0 +1,136 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/write_buffer_manager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+#include "db/db_impl.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+struct WriteBufferManager::Rep {
+  explicit Rep(size_t size)
+      : buffer_size(size),
+        memory_usage(0),
+        mutable_memory_usage(0),
+        flush_done(&mutex),
+        flushing(nullptr) {}
+
+  // True if the mutable memtables should give up memory.  Memtables that
+  // are already being flushed free theirs soon, so they alone never cause
+  // a flush: most of the usage must be in mutable memtables.
+  bool ShouldFlush() const {
+    const size_t limit = buffer_size.load(std::memory_order_relaxed);
+    if (limit == 0) {
+      return false;
+    }
+    const size_t mutable_usage =
+        mutable_memory_usage.load(std::memory_order_relaxed);
+    if (mutable_usage > limit - limit / 8) {
+      return true;
+    }
+    return memory_usage.load(std::memory_order_relaxed) >= limit &&
+           mutable_usage >= limit / 2;
+  }
+
+  std::atomic<size_t> buffer_size;
+  std::atomic<size_t> memory_usage;
+  std::atomic<size_t> mutable_memory_usage;
+
+  // Never held while calling into a DB: a flush may wait for the DB's
+  // background work, and must not hold up writers of the other DBs or
+  // their closing meanwhile.
+  port::Mutex mutex;
+  port::CondVar flush_done;  // Signaled when flushing is reset
+  std::vector<DBImpl*> dbs GUARDED_BY(mutex);
+  DBImpl* flushing GUARDED_BY(mutex);  // The DB being flushed, if any
+};
+
+WriteBufferManager::WriteBufferManager(size_t buffer_size)
+    : rep_(new Rep(buffer_size)) {}
+
+WriteBufferManager::~WriteBufferManager() {
+  assert(rep_->dbs.empty());
+  delete rep_;
+}
+
+size_t WriteBufferManager::buffer_size() const {
+  return rep_->buffer_size.load(std::memory_order_relaxed);
+}
+
+void WriteBufferManager::SetBufferSize(size_t buffer_size) {
+  rep_->buffer_size.store(buffer_size, std::memory_order_relaxed);
+}
+
+size_t WriteBufferManager::memory_usage() const {
+  return rep_->memory_usage.load(std::memory_order_relaxed);
+}
+
+size_t WriteBufferManager::mutable_memory_usage() const {
+  return rep_->mutable_memory_usage.load(std::memory_order_relaxed);
+}
+
+void WriteBufferManager::Register(DBImpl* db) {
+  MutexLock l(&rep_->mutex);
+  rep_->dbs.push_back(db);
+}
+
+void WriteBufferManager::Unregister(DBImpl* db) {
+  MutexLock l(&rep_->mutex);
+  while (rep_->flushing == db) {
+    rep_->flush_done.Wait();
+  }
+  std::vector<DBImpl*>& dbs = rep_->dbs;
+  dbs.erase(std::remove(dbs.begin(), dbs.end(), db), dbs.end());
+}
+
+void WriteBufferManager::UpdateUsage(size_t old_total, size_t new_total,
+                                     size_t old_mutable, size_t new_mutable) {
+  rep_->memory_usage.fetch_add(new_total - old_total,
+                               std::memory_order_relaxed);
+  rep_->mutable_memory_usage.fetch_add(new_mutable - old_mutable,
+                                       std::memory_order_relaxed);
+}
+
+void WriteBufferManager::MaybeFlush() {
+  if (!rep_->ShouldFlush()) {
+    return;
+  }
+  // One flush at a time: concurrent writers would otherwise each flush a
+  // DB when one flush is enough.  Writers crossing the limit meanwhile go
+  // on, as the running flush frees memory soon.
+  MutexLock l(&rep_->mutex);
+  if (rep_->flushing != nullptr || !rep_->ShouldFlush()) {
+    return;
+  }
+  DBImpl* largest = nullptr;
+  size_t largest_usage = 0;
+  for (DBImpl* db : rep_->dbs) {
+    const size_t usage = db->MutableWriteBufferUsage();
+    if (usage > largest_usage) {
+      largest = db;
+      largest_usage = usage;
+    }
+  }
+  if (largest == nullptr) {
+    return;
+  }
+
+  // Unregister() waits for the flush, so the DB stays open until it ends.
+  rep_->flushing = largest;
+  rep_->mutex.Unlock();
+  largest->FlushForWriteBufferManager();  // Errors show up on its writes
+  rep_->mutex.Lock();
+  rep_->flushing = nullptr;
+  rep_->flush_done.SignalAll();
+}
+
+}  // namespace leveldb
@@ -0,0 +1,99 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A BackupEngine keeps a series of backups of one DB in a directory.  Table
+// files never change once written, so each is copied into the directory
+// only once, by the first backup holding it, and shared by all later ones;
+// a backup only copies the tables written since the previous one, plus the
+// logs and a MANIFEST of its own.  Every file is stored with its crc32c,
+// checked when the backup is verified or restored.  It has internal
+// synchronization and may be safely accessed concurrently from multiple
+// threads, though operations run one at a time.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_BACKUP_ENGINE_H_
+#define STORAGE_LEVELDB_INCLUDE_BACKUP_ENGINE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "leveldb/export.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class DB;
+class Env;
+
+struct LEVELDB_EXPORT BackupEngineOptions {
+  // Create a BackupEngineOptions object with default values for all fields.
+  BackupEngineOptions();
+
+  // Used to read the files of the DB and to access the backup directory.
+  // Default: Env::Default()
+  Env* env;
+
+  // Number of files copied at the same time.
+  int max_background_operations = 1;
+
+  // If non-zero, all copying together is held to about this many bytes
+  // per second.
+  uint64_t rate_limit = 0;
+};
+
+struct LEVELDB_EXPORT BackupInfo {
+  uint32_t backup_id;
+  int64_t timestamp;  // Seconds since the epoch when it was created
+  uint64_t size;      // Bytes of all its files, shared ones included
+  uint32_t number_files;
+};
+
+class LEVELDB_EXPORT BackupEngine {
+ public:
+  // Open the backups in "backup_dir", creating it if missing.  Files left
+  // by a backup that did not complete are removed.
+  // Stores a pointer to a heap-allocated engine in *result and returns OK
+  // on success.  Stores nullptr in *result and returns a non-OK status on
+  // error.  Caller should delete *result when it is no longer needed.
+  static Status Open(const BackupEngineOptions& options,
+                     const std::string& backup_dir, BackupEngine** result);
+
+  BackupEngine() = default;
+
+  BackupEngine(const BackupEngine&) = delete;
+  BackupEngine& operator=(const BackupEngine&) = delete;
+
+  virtual ~BackupEngine();
+
+  // Back up the current contents of "db", and store the id of the new
+  // backup in *backup_id if it is non-null.  Writes to the DB and its
+  // compactions keep running meanwhile.
+  // REQUIRES: every backup in this engine is of the same DB.
+  virtual Status CreateNewBackup(DB* db, uint32_t* backup_id) = 0;
+
+  // Store in *infos the backups, oldest first.
+  virtual void GetBackupInfo(std::vector<BackupInfo>* infos) = 0;
+
+  // Read every file of the backup and check its size and checksum.
+  virtual Status VerifyBackup(uint32_t backup_id) = 0;
+
+  // Delete the backup, and the shared files no other backup holds.
+  virtual Status DeleteBackup(uint32_t backup_id) = 0;
+
+  // Delete all but the newest "num_backups_to_keep" backups.
+  virtual Status PurgeOldBackups(int num_backups_to_keep) = 0;
+
+  // Write the DB held by the backup into "db_dir", replacing any DB files
+  // already there, and check the checksum of every file on the way.  The
+  // DB must not be open.
+  virtual Status RestoreDBFromBackup(uint32_t backup_id,
+                                     const std::string& db_dir) = 0;
+
+  // Same as above, from the newest backup.
+  virtual Status RestoreDBFromLatestBackup(const std::string& db_dir) = 0;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_BACKUP_ENGINE_H_
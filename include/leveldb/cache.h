@@ -31,6 +31,24 @@ class LEVELDB_EXPORT Cache;
 // of Cache uses a least-recently-used eviction policy.
 LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity);
 
+// Like NewLRUCache(capacity), but the cache is split into
+// 2^num_shard_bits independently locked shards.  If num_shard_bits is
+// negative, a shard count is picked from the number of cores, keeping each
+// shard at least 512KB.  If strict_capacity_limit is true, Insert() fails
+// instead of letting the entries pinned by clients exceed the capacity.
+LEVELDB_EXPORT Cache* NewLRUCache(size_t capacity, int num_shard_bits,
+                                  bool strict_capacity_limit);
+
+// Create a new cache with a fixed size capacity.  This implementation of
+// Cache uses CLOCK eviction: lookups take no locks and a hit only refreshes
+// the entry's clock bits, so it scales better than NewLRUCache() when many
+// threads read concurrently.  Entries are kept in fixed size tables with
+// room for about capacity / estimated_entry_charge of them (e.g. pass
+// Options::block_size for a block cache); if entries are much smaller than
+// estimated, fewer of them are cached than capacity would allow.
+LEVELDB_EXPORT Cache* NewClockCache(size_t capacity,
+                                    size_t estimated_entry_charge);
+
 class LEVELDB_EXPORT Cache {
  public:
   Cache() = default;
@@ -45,6 +63,18 @@ class LEVELDB_EXPORT Cache {
   // Opaque handle to an entry stored in the cache.
   struct Handle {};
 
+  // Eviction priority of an entry; see InsertWithPriority().
+  enum Priority { kLowPriority, kHighPriority };
+
+  // Usage and lookup counters of one shard; see GetShardStats().
+  struct ShardStats {
+    size_t capacity = 0;
+    size_t usage = 0;         // Combined charge of the cached entries
+    size_t pinned_usage = 0;  // Part of usage held by unreleased handles
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
   // Insert a mapping from key->value into the cache and assign it
   // the specified charge against the total cache capacity.
   //
@@ -52,11 +82,27 @@ class LEVELDB_EXPORT Cache {
   // must call this->Release(handle) when the returned mapping is no
   // longer needed.
   //
+  // A cache with a strict capacity limit returns nullptr if the entry
+  // does not fit.  The caller then still owns "value", and "deleter" is
+  // not called.
+  //
   // When the inserted entry is no longer needed, the key and
   // value will be passed to "deleter".
   virtual Handle* Insert(const Slice& key, void* value, size_t charge,
                          void (*deleter)(const Slice& key, void* value)) = 0;
 
+  // Like Insert(), but with an eviction priority.  Insert() uses
+  // kLowPriority.  The builtin LRU cache never evicts a kHighPriority entry
+  // to make room for a kLowPriority one.  The default implementation
+  // ignores the priority.
+  virtual Handle* InsertWithPriority(const Slice& key, void* value,
+                                     size_t charge,
+                                     void (*deleter)(const Slice& key,
+                                                     void* value),
+                                     Priority priority) {
+    return Insert(key, value, charge, deleter);
+  }
+
   // If the cache has no mapping for "key", returns nullptr.
   //
   // Else return a handle that corresponds to the mapping.  The caller
@@ -97,6 +143,22 @@ class LEVELDB_EXPORT Cache {
   // cache.
   virtual size_t TotalCharge() const = 0;
 
+  // Return the number of shards for which GetShardStats() reports
+  // statistics.  The default implementation reports none.
+  virtual int NumShards() const { return 0; }
+
+  // Store the statistics of shard "shard" in *stats.
+  // REQUIRES: 0 <= shard < NumShards()
+  virtual void GetShardStats(int shard, ShardStats* stats) const {}
+
+  // Call (*func)(arg, key, value) for each entry in the cache, in no
+  // particular order.  Entries inserted or erased concurrently may or may
+  // not be visited.  "func" must not call any method on the cache.  The
+  // default implementation visits no entries.
+  virtual void ApplyToAllEntries(void (*func)(void* arg, const Slice& key,
+                                              void* value),
+                                 void* arg) {}
+
  private:
   void LRU_Remove(Handle* e);
   void LRU_Append(Handle* e);
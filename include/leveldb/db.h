@@ -5,8 +5,10 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_DB_H_
 #define STORAGE_LEVELDB_INCLUDE_DB_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <vector>
 
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
@@ -40,6 +42,106 @@ struct LEVELDB_EXPORT Range {
   Slice limit;  // Not included in the range
 };
 
+// Approximate memory held by one DB, in bytes, by the component holding
+// it.  See DB::GetMemoryUsage().
+struct LEVELDB_EXPORT MemoryUsage {
+  MemoryUsage() = default;
+
+  // The memtable taking writes and the one being flushed, if any.
+  size_t mem_table = 0;
+  size_t imm_mem_table = 0;
+
+  // The part of mem_table and imm_mem_table allocated but left unused.
+  size_t mem_table_unused = 0;
+
+  // Index blocks and filters of open tables held outside the block cache,
+  // read into the heap or mapped from the table files.
+  size_t table_readers = 0;
+
+  // The part of table_readers held by the filters of the tables of each
+  // level, indexed by level.
+  std::vector<size_t> level_filters;
+
+  // Data blocks held by live iterators.  Blocks they pin in the block
+  // cache are also counted in block_cache.
+  size_t iterator_blocks = 0;
+
+  // Usage of the caches set in Options, which may be shared with other
+  // DBs.
+  size_t block_cache = 0;
+  size_t compressed_block_cache = 0;
+  size_t row_cache = 0;
+
+  // Return the memory held by this DB alone, which excludes the caches.
+  size_t DBTotal() const {
+    return mem_table + imm_mem_table + table_readers + iterator_blocks;
+  }
+};
+
+// The files that together hold the contents of a DB at one point in time.
+// See DB::GetLiveFiles().
+struct LEVELDB_EXPORT LiveFiles {
+  struct File {
+    std::string name;  // Relative to dir
+    uint64_t size;     // Bytes of the file that belong to this state
+  };
+
+  // The DB directory.
+  std::string dir;
+
+  // Table files, which never change once written.
+  std::vector<File> tables;
+
+  // Log files, which may still be appended to; only their first "size"
+  // bytes belong to this state.
+  std::vector<File> logs;
+
+  // Name and contents of a MANIFEST file describing this state.  It does
+  // not exist in dir: a copy of the DB writes it out and points CURRENT
+  // at it.
+  std::string manifest_name;
+  std::string manifest;
+};
+
+// Progress of a CompactionJob.  Bytes count the input and output table
+// files of the compactions it has finished.
+struct LEVELDB_EXPORT CompactionProgress {
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+
+  // Estimate of bytes_read once the job is done.  It is revised as the job
+  // moves down the levels, since each level it compacts grows the next.
+  uint64_t total_bytes = 0;
+
+  int level = 0;  // Level being compacted into the next one
+  bool done = false;
+};
+
+// Handle to a manual compaction running in the background.  See
+// DB::CompactRangeAsync().  It may be safely accessed concurrently from
+// multiple threads.
+class LEVELDB_EXPORT CompactionJob {
+ public:
+  CompactionJob() = default;
+
+  CompactionJob(const CompactionJob&) = delete;
+  CompactionJob& operator=(const CompactionJob&) = delete;
+
+  // Cancels the job and waits for it to stop.
+  virtual ~CompactionJob();
+
+  virtual void GetProgress(CompactionProgress* progress) = 0;
+
+  // Ask the job to stop.  It stops before starting its next output file;
+  // the output of an unfinished compaction is discarded, so the DB is
+  // left as if that compaction had never started.
+  virtual void Cancel() = 0;
+
+  // Wait for the job to finish and return its status.  A cancelled job
+  // returns OK.
+  virtual Status Wait() = 0;
+};
+
 // A DB is a persistent ordered map from keys to values.
 // A DB is safe for concurrent access from multiple threads without
 // any external synchronization.
@@ -87,6 +189,28 @@ class LEVELDB_EXPORT DB {
   virtual Status Get(const ReadOptions& options, const Slice& key,
                      std::string* value) = 0;
 
+  // Like Get(), but instead of copying the value into a string, call
+  // (*handle_value)(arg, value) with the value where it lies: in the
+  // memtable or in a table block, which stay pinned only for the duration
+  // of the call.  A caller with its own buffer then copies the value once.
+  // handle_value is called at most once, and is always called if OK is
+  // returned.
+  //
+  // The default implementation calls Get() and passes on its result.
+  virtual Status GetPinned(const ReadOptions& options, const Slice& key,
+                           void* arg,
+                           void (*handle_value)(void* arg,
+                                                const Slice& value));
+
+  // For each i in [0,n-1], look up keys[i] as Get() would, storing the
+  // result in statuses[i] and, if it is OK, the value in values[i].  All
+  // the lookups see the same state of the database, that of
+  // options.snapshot if it is set.
+  //
+  // The default implementation calls Get() for each key.
+  virtual void MultiGet(const ReadOptions& options, int n, const Slice* keys,
+                        std::string* values, Status* statuses);
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -145,6 +269,46 @@ class LEVELDB_EXPORT DB {
   // Therefore the following call will compact the entire database:
   //    db->CompactRange(nullptr, nullptr);
   virtual void CompactRange(const Slice* begin, const Slice* end) = 0;
+
+  // Compact the range as CompactRange() does, limited to the levels in
+  // "options", on a thread of its own.  Stores in *job a handle to watch
+  // or cancel it, which the caller should delete when no longer needed.
+  // REQUIRES: the job has finished or been deleted before the DB is.
+  // The default implementation returns NotSupported.
+  virtual Status CompactRangeAsync(const CompactRangeOptions& options,
+                                   const Slice* begin, const Slice* end,
+                                   CompactionJob** job);
+
+  // Record which table blocks are currently in the block cache, so that
+  // the next DB::Open() with Options::warm_block_cache can read them back.
+  // The default implementation returns NotSupported.
+  virtual Status SaveBlockCacheManifest();
+
+  // Store in *usage the memory this DB currently holds, by component.
+  // The default implementation returns NotSupported.
+  virtual Status GetMemoryUsage(MemoryUsage* usage);
+
+  // Create in "checkpoint_dir", which must not exist yet, a DB that can be
+  // opened on its own and holds the contents of this DB as of some point
+  // during the call.  Table files are hard linked where the Env allows it
+  // and copied otherwise; only the log files and a new MANIFEST are
+  // written out.  Compactions keep running meanwhile.  The files are
+  // gathered in "checkpoint_dir" + ".tmp" first, which must not exist
+  // either.
+  // The default implementation returns NotSupported.
+  virtual Status CreateCheckpoint(const std::string& checkpoint_dir);
+
+  // Stop deleting files that compactions have made obsolete, until a
+  // matching call to EnableFileDeletions(), so that files returned by
+  // GetLiveFiles() can be copied.  Calls may be nested.
+  // The default implementations do nothing.
+  virtual void DisableFileDeletions();
+  virtual void EnableFileDeletions();
+
+  // Store in *files the files holding the current contents of the DB.
+  // REQUIRES: file deletions are disabled while the files are used.
+  // The default implementation returns NotSupported.
+  virtual Status GetLiveFiles(LiveFiles* files);
 };
 
 // Destroy the contents of the specified database.
@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <cstddef>
+#include <vector>
 
 #include "leveldb/export.h"
 
@@ -16,7 +17,9 @@ class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class PersistentCache;
 class Snapshot;
+class WriteBufferManager;
 
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
@@ -81,6 +84,13 @@ struct LEVELDB_EXPORT Options {
   // the next time the database is opened.
   size_t write_buffer_size = 4 * 1024 * 1024;
 
+  // If non-null, the memtables of this DB count against the memory budget
+  // of the specified manager, shared with every other DB opened with it.
+  // When their total passes the budget, the DB holding the largest
+  // memtable flushes it even if it is below write_buffer_size.  The
+  // manager must outlive the DB.
+  WriteBufferManager* write_buffer_manager = nullptr;
+
   // Number of open files that can be used by the DB.  You may need to
   // increase this if your database has a large working set (budget
   // one open file per 2MB of working set).
@@ -93,6 +103,40 @@ struct LEVELDB_EXPORT Options {
   // If null, leveldb will automatically create and use an 8MB internal cache.
   Cache* block_cache = nullptr;
 
+  // If true and block_cache is set, the index and filter blocks of tables
+  // are kept in block_cache at high priority, where data blocks cannot
+  // evict them, instead of in memory held by each open table.  Their size
+  // then counts against the block cache capacity, so one budget bounds
+  // both, at the cost of a cache lookup for them on every read.
+  bool cache_index_and_filter_blocks = false;
+
+  // If true, the DB records which table blocks are in block_cache when it
+  // is closed (see DB::SaveBlockCacheManifest()), and after it is next
+  // opened reads them back into block_cache in the background, so reads
+  // do not start from a cold cache.  Blocks of tables that compaction has
+  // removed in the meantime are skipped.
+  bool warm_block_cache = false;
+
+  // If non-null, data blocks that are stored compressed are also kept in
+  // the specified cache in their compressed form, so it holds several
+  // times as many blocks per byte as block_cache.  A read that misses
+  // block_cache but finds the block here decompresses it rather than
+  // reading it from the file.
+  Cache* compressed_block_cache = nullptr;
+
+  // If non-null and block_cache is set, data blocks read from table files
+  // are also kept in the specified cache, typically on a local device
+  // faster than the one holding the database, and blocks missing from the
+  // in-memory caches are looked up there before reading the table file.
+  PersistentCache* persistent_cache = nullptr;
+
+  // If non-null, use the specified cache for the results of point lookups
+  // in tables, keyed by table file and user key, so repeated Gets of a hot
+  // key skip the block cache and block parsing.  Entries for a table are
+  // never read again once compaction has deleted it, and age out of the
+  // cache.  Only reads without a snapshot fill the cache.
+  Cache* row_cache = nullptr;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
@@ -104,6 +148,13 @@ struct LEVELDB_EXPORT Options {
   // leave this parameter alone.
   int block_restart_interval = 16;
 
+  // If true, each data block ends with a small hash index from user key to
+  // restart point, so that point lookups skip the binary search over the
+  // restart array.  Costs about one byte per distinct key in the block.
+  // Tables written with it can only be read by versions that know the
+  // format; tables written without it remain readable either way.
+  bool data_block_hash_index = false;
+
   // Leveldb will write up to this amount of bytes to a file before
   // switching to a new one.
   // Most clients should leave this parameter alone.  However if your
@@ -140,6 +191,34 @@ struct LEVELDB_EXPORT Options {
   // Many applications will benefit from passing the result of
   // NewBloomFilterPolicy() here.
   const FilterPolicy* filter_policy = nullptr;
+
+  // If true (and filter_policy is non-null), new tables store one filter
+  // built over all of their keys instead of one filter per 2KB of data
+  // blocks.  A lookup then probes a single filter before the index block
+  // is consulted at all.  Tables written either way remain readable.
+  //
+  // Default: false
+  bool full_filter = false;
+
+  // If non-empty, entry i replaces filter_policy for tables that memtable
+  // flushes (level 0) and compactions write to level i; a null entry means
+  // tables on that level get no filter at all.  Levels past the end of the
+  // vector use filter_policy.  Ignored if filter_policy is null.
+  //
+  // Tables are always read with filter_policy, so every entry must write
+  // filters it understands: the same Name(), e.g. NewBloomFilterPolicy()
+  // with a different bits_per_key.  Filters under any other name are
+  // ignored on read.
+  std::vector<const FilterPolicy*> level_filter_policies;
+
+  // If true, compactions whose output is the deepest level holding data
+  // write tables without filters.  When reads almost always find their
+  // key, those filters (most of the filter memory) only ever say "maybe";
+  // lookups for missing keys then read one index and data block from
+  // that level instead.
+  //
+  // Default: false
+  bool optimize_filters_for_hits = false;
 };
 
 // Options that control read operations
@@ -159,6 +238,12 @@ struct LEVELDB_EXPORT ReadOptions {
   // not have been released).  If "snapshot" is null, use an implicit
   // snapshot of the state at the beginning of this read operation.
   const Snapshot* snapshot = nullptr;
+
+  // If non-zero, iterators ask the file system to read this many bytes of
+  // a table file ahead of the blocks they read from it, so long scans over
+  // data that is not cached wait less on the disk.  Point lookups ignore
+  // it.
+  size_t readahead_size = 0;
 };
 
 // Options that control write operations
@@ -182,6 +267,19 @@ struct LEVELDB_EXPORT WriteOptions {
   bool sync = false;
 };
 
+// Options that control DB::CompactRangeAsync()
+struct LEVELDB_EXPORT CompactRangeOptions {
+  CompactRangeOptions() = default;
+
+  // Files in the range are compacted from this level down, each level into
+  // the next one.  The memtable is flushed first only when it is 0.
+  int start_level = 0;
+
+  // Stop once this level has been written to.  A negative value means the
+  // deepest level holding files in the range, as DB::CompactRange() does.
+  int max_output_level = -1;
+};
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
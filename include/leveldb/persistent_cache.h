@@ -0,0 +1,66 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A PersistentCache is a second tier behind Options::block_cache that keeps
+// table blocks on a device faster than the one holding the database, such
+// as a local SSD.  A block that misses the block cache is looked up here
+// before it is read from its table file, and blocks read from table files
+// are added here.  It has internal synchronization and may be safely
+// accessed concurrently from multiple threads.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_PERSISTENT_CACHE_H_
+#define STORAGE_LEVELDB_INCLUDE_PERSISTENT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class Env;
+
+class LEVELDB_EXPORT PersistentCache {
+ public:
+  PersistentCache() = default;
+
+  PersistentCache(const PersistentCache&) = delete;
+  PersistentCache& operator=(const PersistentCache&) = delete;
+
+  virtual ~PersistentCache();
+
+  // Store "data" under "key", replacing nothing if "key" is already
+  // present.  A non-OK status only means that the data was not cached.
+  virtual Status Insert(const Slice& key, const Slice& data) = 0;
+
+  // If "key" is present, store its data in *data and return OK.
+  // Otherwise return a non-OK status, NotFound if "key" was never cached
+  // or has been evicted.
+  virtual Status Lookup(const Slice& key, std::string* data) = 0;
+
+  // Return the number of bytes of cached data, including any overhead.
+  virtual size_t TotalSize() const = 0;
+
+  // Return a new numeric id.  Every table using the cache takes one and
+  // prepends it to its keys, so tables of different DBs sharing the cache
+  // never use the same key.
+  virtual uint64_t NewId() = 0;
+};
+
+// Create a persistent cache that keeps up to about "capacity" bytes in
+// log-structured files under directory "dir", written sequentially and
+// evicted a whole file at a time, oldest first.  Keys built from NewId() are
+// only meaningful within one cache, so the cache starts empty: any files an
+// earlier cache left in "dir" are removed.  The caller must delete the
+// result when it is no longer needed, after every DB using it is closed.
+LEVELDB_EXPORT Status NewPersistentCache(Env* env, const std::string& dir,
+                                         size_t capacity,
+                                         PersistentCache** result);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_PERSISTENT_CACHE_H_
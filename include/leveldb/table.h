@@ -5,7 +5,9 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_TABLE_H_
 #define STORAGE_LEVELDB_INCLUDE_TABLE_H_
 
+#include <atomic>
 #include <cstdint>
+#include <vector>
 
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
@@ -66,8 +68,32 @@ class LEVELDB_EXPORT Table {
 
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
 
+  // Returns an iterator over the block "index_value" points at.  If
+  // "get_key" is non-null the iterator is positioned for a point lookup of
+  // *get_key as by Block::NewIteratorForGet().
+  Iterator* NewBlockIterator(const ReadOptions&, const Slice& index_value,
+                             const Slice* get_key) const;
+
   explicit Table(Rep* rep) : rep_(rep) {}
 
+  // Returns the id that prefixes the block cache keys of this table.
+  uint64_t CacheId() const;
+
+  // Stores in *usage the memory held by this table's index block and
+  // filter outside the block cache, read into the heap or mapped from the
+  // file, and in *filter_usage the part of it held by the filter.
+  void GetMemoryUsage(size_t* usage, size_t* filter_usage) const;
+
+  // Makes iterators from NewIterator() add the size of each data block to
+  // *usage for as long as they hold it.  *usage must outlive the table.
+  void SetIteratorUsage(std::atomic<size_t>* usage);
+
+  // Reads the data blocks that start at "offsets", which must be sorted,
+  // into the block cache, with one read for each run of blocks that lie
+  // close together in the file.  Offsets that are not the start of a data
+  // block are ignored.
+  Status PrefetchBlocks(const std::vector<uint64_t>& offsets) const;
+
   // Calls (*handle_result)(arg, ...) with the entry found after a call
   // to Seek(key).  May not make such a call if filter policy says
   // that key is not present.
@@ -75,8 +101,18 @@ class LEVELDB_EXPORT Table {
                      void (*handle_result)(void* arg, const Slice& k,
                                            const Slice& v));
 
+  // Does what InternalGet() does for each of the "n" keys, which must be
+  // sorted, passing args[i] to (*handle_result) and storing the status in
+  // statuses[i].  The filter and index are consulted with one pass over
+  // the keys, and each data block is read once for all the keys in it.
+  void InternalMultiGet(const ReadOptions&, int n, const Slice* keys,
+                        void* const* args,
+                        void (*handle_result)(void* arg, const Slice& k,
+                                              const Slice& v),
+                        Status* statuses);
+
   void ReadMeta(const Footer& footer);
-  void ReadFilter(const Slice& filter_handle_value);
+  void ReadFilter(const Slice& filter_handle_value, bool full);
 
   Rep* const rep_;
 };
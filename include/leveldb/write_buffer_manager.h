@@ -0,0 +1,74 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A WriteBufferManager bounds the memory held in memtables by every DB
+// opened with it in Options::write_buffer_manager.  Each DB still switches
+// memtables at its own write_buffer_size, but once the memtables of all of
+// them together grow past the manager's buffer size, the DB holding the
+// largest mutable memtable is made to flush it, whichever DB is writing.
+// It has internal synchronization and may be safely accessed concurrently
+// from multiple threads.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
+#define STORAGE_LEVELDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
+
+#include <cstddef>
+
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+class DB;
+class DBImpl;
+
+class LEVELDB_EXPORT WriteBufferManager {
+ public:
+  // Create a manager that keeps the memtables of its DBs within about
+  // "buffer_size" bytes.  A buffer size of zero places no limit, but still
+  // tracks memory_usage().
+  explicit WriteBufferManager(size_t buffer_size);
+
+  WriteBufferManager(const WriteBufferManager&) = delete;
+  WriteBufferManager& operator=(const WriteBufferManager&) = delete;
+
+  // REQUIRES: every DB using this manager has been closed.
+  ~WriteBufferManager();
+
+  // Return the limit on the memory held by memtables.
+  size_t buffer_size() const;
+
+  // Change the limit.  It applies from the next write to any of the DBs.
+  void SetBufferSize(size_t buffer_size);
+
+  // Return the memory held by the memtables of all DBs, mutable and
+  // being flushed.
+  size_t memory_usage() const;
+
+  // Return the memory held by the mutable memtables of all DBs.
+  size_t mutable_memory_usage() const;
+
+ private:
+  friend class DB;
+  friend class DBImpl;
+  struct Rep;
+
+  // Called by DB::Open() and the DB destructor.
+  void Register(DBImpl* db);
+  void Unregister(DBImpl* db);
+
+  // Replace the usage a DB last reported with its current usage.
+  void UpdateUsage(size_t old_total, size_t new_total, size_t old_mutable,
+                   size_t new_mutable);
+
+  // If the memtables are over the limit, flush the largest mutable one.
+  // REQUIRES: the calling thread holds no DB mutex and is not writing to
+  // any DB.
+  void MaybeFlush();
+
+  Rep* const rep_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_WRITE_BUFFER_MANAGER_H_
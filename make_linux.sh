@@ -5,6 +5,7 @@ cd `dirname $0`
 # require gcc 4.8+ (c++11); 5+ for db-tools; 6+ for snappy
 
 CORE_FILES="\
+db/backup_engine.cc \
 db/builder.cc \
 db/db_impl.cc \
 db/db_iter.cc \
@@ -19,6 +20,7 @@ db/table_cache.cc \
 db/version_edit.cc \
 db/version_set.cc \
 db/write_batch.cc \
+db/write_buffer_manager.cc \
 table/block.cc \
 table/block_builder.cc \
 table/filter_block.cc \
@@ -31,6 +33,7 @@ table/two_level_iterator.cc \
 util/arena.cc \
 util/bloom.cc \
 util/cache.cc \
+util/clock_cache.cc \
 util/coding.cc \
 util/comparator.cc \
 util/crc32c.cc \
@@ -41,6 +44,8 @@ util/hash.cc \
 util/histogram.cc \
 util/logging.cc \
 util/options.cc \
+util/persistent_cache.cc \
+util/ribbon_filter.cc \
 util/status.cc \
 crc32c/crc32c_portable.cc \
 snappy/snappy.cc \
@@ -49,6 +54,7 @@ snappy/snappy-stubs-internal.cc \
 "
 
 OBJ_FILES="\
+backup_engine.o \
 builder.o \
 db_impl.o \
 db_iter.o \
@@ -63,6 +69,7 @@ table_cache.o \
 version_edit.o \
 version_set.o \
 write_batch.o \
+write_buffer_manager.o \
 block.o \
 block_builder.o \
 filter_block.o \
@@ -75,6 +82,7 @@ two_level_iterator.o \
 arena.o \
 bloom.o \
 cache.o \
+clock_cache.o \
 coding.o \
 comparator.o \
 crc32c.o \
@@ -85,6 +93,8 @@ hash.o \
 histogram.o \
 logging.o \
 options.o \
+persistent_cache.o \
+ribbon_filter.o \
 status.o \
 crc32c_portable.o \
 snappy.o \
@@ -7,6 +7,7 @@ cd `dirname $0`
 if [ "$JAVA_INCLUDE" = "" ]; then JAVA_INCLUDE=/System/Library/Frameworks/JavaVM.framework/Versions/A/Headers; fi
 
 CORE_FILES="\
+db/backup_engine.cc \
 db/builder.cc \
 db/db_impl.cc \
 db/db_iter.cc \
@@ -21,6 +22,7 @@ db/table_cache.cc \
 db/version_edit.cc \
 db/version_set.cc \
 db/write_batch.cc \
+db/write_buffer_manager.cc \
 table/block.cc \
 table/block_builder.cc \
 table/filter_block.cc \
@@ -33,6 +35,7 @@ table/two_level_iterator.cc \
 util/arena.cc \
 util/bloom.cc \
 util/cache.cc \
+util/clock_cache.cc \
 util/coding.cc \
 util/comparator.cc \
 util/crc32c.cc \
@@ -43,6 +46,8 @@ util/hash.cc \
 util/histogram.cc \
 util/logging.cc \
 util/options.cc \
+util/persistent_cache.cc \
+util/ribbon_filter.cc \
 util/status.cc \
 crc32c/crc32c_portable.cc \
 snappy/snappy.cc \
@@ -51,6 +56,7 @@ snappy/snappy-stubs-internal.cc \
 "
 
 OBJ_FILES="\
+backup_engine.o \
 builder.o \
 db_impl.o \
 db_iter.o \
@@ -65,6 +71,7 @@ table_cache.o \
 version_edit.o \
 version_set.o \
 write_batch.o \
+write_buffer_manager.o \
 block.o \
 block_builder.o \
 filter_block.o \
@@ -77,6 +84,7 @@ two_level_iterator.o \
 arena.o \
 bloom.o \
 cache.o \
+clock_cache.o \
 coding.o \
 comparator.o \
 crc32c.o \
@@ -87,6 +95,8 @@ hash.o \
 histogram.o \
 logging.o \
 options.o \
+persistent_cache.o \
+ribbon_filter.o \
 status.o \
 crc32c_portable.o \
 snappy.o \
@@ -6,6 +6,7 @@ rem require mingw-gcc 4.8+ (c++11) with posix thread; 5.0+ for db-tools
 set path=C:\TDM-GCC-64\bin;%path%
 
 set CORE_FILES=^
+db/backup_engine.cc ^
 db/builder.cc ^
 db/db_impl.cc ^
 db/db_iter.cc ^
@@ -20,6 +21,7 @@ db/table_cache.cc ^
 db/version_edit.cc ^
 db/version_set.cc ^
 db/write_batch.cc ^
+db/write_buffer_manager.cc ^
 table/block.cc ^
 table/block_builder.cc ^
 table/filter_block.cc ^
@@ -32,6 +34,7 @@ table/two_level_iterator.cc ^
 util/arena.cc ^
 util/bloom.cc ^
 util/cache.cc ^
+util/clock_cache.cc ^
 util/coding.cc ^
 util/comparator.cc ^
 util/crc32c.cc ^
@@ -42,6 +45,8 @@ util/hash.cc ^
 util/histogram.cc ^
 util/logging.cc ^
 util/options.cc ^
+util/persistent_cache.cc ^
+util/ribbon_filter.cc ^
 util/status.cc ^
 crc32c/crc32c.cc ^
 crc32c/crc32c_portable.cc ^
@@ -19,23 +19,43 @@ namespace leveldb {
 
 inline uint32_t Block::NumRestarts() const {
   assert(size_ >= sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  return DecodeFixed32(data_ + size_ - sizeof(uint32_t)) & ~kBlockHashIndexFlag;
 }
 
 Block::Block(const BlockContents& contents)
     : data_(contents.data.data()),
       size_(contents.data.size()),
+      hash_index_(nullptr),
+      num_buckets_(0),
       owned_(contents.heap_allocated) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
-  } else {
-    size_t max_restarts_allowed = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
-    if (NumRestarts() > max_restarts_allowed) {
-      // The size is too small for NumRestarts()
+    return;
+  }
+  // Size of the trailer that follows the restart array
+  size_t trailer = sizeof(uint32_t);
+  if ((DecodeFixed32(data_ + size_ - sizeof(uint32_t)) &
+       kBlockHashIndexFlag) != 0) {
+    if (size_ < trailer + sizeof(uint16_t)) {
       size_ = 0;
-    } else {
-      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+      return;
+    }
+    const uint8_t* count =
+        reinterpret_cast<const uint8_t*>(data_ + size_ - trailer) - 2;
+    num_buckets_ = count[0] | (count[1] << 8);
+    trailer += sizeof(uint16_t) + num_buckets_;
+    if (num_buckets_ == 0 || size_ < trailer) {
+      size_ = 0;
+      return;
     }
+    hash_index_ = reinterpret_cast<const uint8_t*>(data_ + size_ - trailer);
+  }
+  size_t max_restarts_allowed = (size_ - trailer) / sizeof(uint32_t);
+  if (NumRestarts() > max_restarts_allowed) {
+    // The size is too small for NumRestarts()
+    size_ = 0;
+  } else {
+    restart_offset_ = size_ - trailer - NumRestarts() * sizeof(uint32_t);
   }
 }
 
@@ -226,6 +246,15 @@ class Block::Iter : public Iterator {
     }
   }
 
+  // Position at the first key >= target, which is known to be at or
+  // after restart point "index".
+  void SeekFromRestartPoint(uint32_t index, const Slice& target) {
+    SeekToRestartPoint(index);
+    while (ParseNextKey() && Compare(key_, target) < 0) {
+      // Keep skipping
+    }
+  }
+
   void SeekToFirst() override {
     SeekToRestartPoint(0);
     ParseNextKey();
@@ -289,4 +318,28 @@ Iterator* Block::NewIterator(const Comparator* comparator) {
   }
 }
 
+Iterator* Block::NewIteratorForGet(const Comparator* comparator,
+                                   const Slice& target) {
+  if (hash_index_ == nullptr || size_ < sizeof(uint32_t)) {
+    Iterator* iter = NewIterator(comparator);
+    iter->Seek(target);
+    return iter;
+  }
+  const uint32_t num_restarts = NumRestarts();
+  if (num_restarts == 0) {
+    return NewEmptyIterator();
+  }
+  Iter* iter = new Iter(comparator, data_, restart_offset_, num_restarts);
+  const uint8_t entry =
+      hash_index_[BlockHashIndexHash(target) % num_buckets_];
+  if (entry == kBlockHashIndexEmpty) {
+    // No entry has this user key; leave the iterator !Valid()
+  } else if (entry == kBlockHashIndexCollision || entry >= num_restarts) {
+    iter->Seek(target);
+  } else {
+    iter->SeekFromRestartPoint(entry, target);
+  }
+  return iter;
+}
+
 }  // namespace leveldb
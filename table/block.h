@@ -28,6 +28,13 @@ class Block {
   size_t size() const { return size_; }
   Iterator* NewIterator(const Comparator* comparator);
 
+  // Returns an iterator positioned as if by Seek(target), for a point
+  // lookup of internal key "target".  Uses the block's hash index when it
+  // has one; the iterator is then !Valid() if no entry has target's user
+  // key, and may be positioned past target otherwise.
+  Iterator* NewIteratorForGet(const Comparator* comparator,
+                              const Slice& target);
+
  private:
   class Iter;
 
@@ -35,8 +42,10 @@ class Block {
 
   const char* data_;
   size_t size_;
-  uint32_t restart_offset_;  // Offset in data_ of restart array
-  bool owned_;               // Block owns data_[]
+  uint32_t restart_offset_;     // Offset in data_ of restart array
+  const uint8_t* hash_index_;   // Hash index buckets, or nullptr if none
+  uint32_t num_buckets_;        // Number of hash index buckets
+  bool owned_;                  // Block owns data_[]
 };
 
 }  // namespace leveldb
@@ -25,6 +25,18 @@
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+//
+// If Options::data_block_hash_index is set, the trailer instead has the form:
+//     restarts: uint32[num_restarts]
+//     buckets: uint8[num_buckets]
+//     num_buckets: uint16
+//     num_restarts | kBlockHashIndexFlag: uint32
+// Each distinct user key hashes to a bucket holding the index of the
+// restart point whose interval contains the key's first entry, so a point
+// lookup can scan from there instead of binary searching the restarts.
+// A bucket is kBlockHashIndexEmpty if no key hashes to it and
+// kBlockHashIndexCollision if keys in different intervals do.  Blocks with
+// more restart points than fit in a bucket are written without the index.
 
 #include "table/block_builder.h"
 
@@ -33,10 +45,14 @@
 
 #include "leveldb/comparator.h"
 #include "leveldb/options.h"
+#include "table/format.h"
 #include "util/coding.h"
 
 namespace leveldb {
 
+// Keys per bucket of the hash index
+static const double kHashIndexUtilRatio = 0.75;
+
 BlockBuilder::BlockBuilder(const Options* options)
     : options_(options), restarts_(), counter_(0), finished_(false) {
   assert(options->block_restart_interval >= 1);
@@ -50,12 +66,18 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  hash_index_keys_.clear();
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
-  return (buffer_.size() +                       // Raw data buffer
-          restarts_.size() * sizeof(uint32_t) +  // Restart array
-          sizeof(uint32_t));                     // Restart array length
+  size_t estimate = (buffer_.size() +                       // Raw data buffer
+                     restarts_.size() * sizeof(uint32_t) +  // Restart array
+                     sizeof(uint32_t));  // Restart array length
+  if (options_->data_block_hash_index) {
+    estimate += hash_index_keys_.size() / kHashIndexUtilRatio +  // Buckets
+                sizeof(uint16_t);                                // Count
+  }
+  return estimate;
 }
 
 Slice BlockBuilder::Finish() {
@@ -63,7 +85,27 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  if (options_->data_block_hash_index &&
+      restarts_.size() < kBlockHashIndexCollision) {
+    size_t num_buckets = hash_index_keys_.size() / kHashIndexUtilRatio + 1;
+    if (num_buckets > 0xffff) num_buckets = 0xffff;
+    std::string buckets(num_buckets, static_cast<char>(kBlockHashIndexEmpty));
+    for (size_t i = 0; i < hash_index_keys_.size(); i++) {
+      const uint8_t restart = hash_index_keys_[i].second;
+      char* bucket = &buckets[hash_index_keys_[i].first % num_buckets];
+      if (static_cast<uint8_t>(*bucket) == kBlockHashIndexEmpty) {
+        *bucket = static_cast<char>(restart);
+      } else if (static_cast<uint8_t>(*bucket) != restart) {
+        *bucket = static_cast<char>(kBlockHashIndexCollision);
+      }
+    }
+    buffer_.append(buckets);
+    buffer_.push_back(static_cast<char>(num_buckets & 0xff));
+    buffer_.push_back(static_cast<char>(num_buckets >> 8));
+    PutFixed32(&buffer_, restarts_.size() | kBlockHashIndexFlag);
+  } else {
+    PutFixed32(&buffer_, restarts_.size());
+  }
   finished_ = true;
   return Slice(buffer_);
 }
@@ -88,6 +130,18 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  if (options_->data_block_hash_index) {
+    // Only the first entry of each user key goes in the hash index; later
+    // versions are found by scanning forward from it.
+    const size_t user_key_size = key.size() >= 8 ? key.size() - 8 : key.size();
+    if (buffer_.empty() || last_key_piece.size() != key.size() ||
+        Slice(last_key_piece.data(), user_key_size) !=
+            Slice(key.data(), user_key_size)) {
+      hash_index_keys_.emplace_back(BlockHashIndexHash(key),
+                                    restarts_.size() - 1);
+    }
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_TABLE_BLOCK_BUILDER_H_
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "leveldb/slice.h"
@@ -47,6 +48,10 @@ class BlockBuilder {
   int counter_;                     // Number of entries emitted since restart
   bool finished_;                   // Has Finish() been called?
   std::string last_key_;
+
+  // Hash and restart index of the first entry of each user key, if the
+  // block gets a hash index
+  std::vector<std::pair<uint32_t, uint32_t>> hash_index_keys_;
 };
 
 }  // namespace leveldb
@@ -5,6 +5,10 @@
 // A filter block is stored near the end of a Table file.  It contains
 // filters (e.g., bloom filters) for all data blocks in the table combined
 // into a single filter block.
+//
+// A full filter block is the alternative format: one filter built over
+// every key in the table, so a lookup probes a single filter without
+// consulting the index block or a per-range offset array.
 
 #ifndef STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
 #define STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
@@ -63,6 +67,41 @@ class FilterBlockReader {
   size_t base_lg_;      // Encoding parameter (see kFilterBaseLg in .cc file)
 };
 
+// A FullFilterBlockBuilder constructs a single filter over all of the
+// keys of a particular Table.  The generated string is exactly the output
+// of FilterPolicy::CreateFilter() and is stored as a special block in the
+// Table under the "fullfilter.<Name>" meta index key.
+//
+// The sequence of calls to FullFilterBlockBuilder must match the regexp:
+//      AddKey* Finish
+class FullFilterBlockBuilder {
+ public:
+  explicit FullFilterBlockBuilder(const FilterPolicy*);
+
+  FullFilterBlockBuilder(const FullFilterBlockBuilder&) = delete;
+  FullFilterBlockBuilder& operator=(const FullFilterBlockBuilder&) = delete;
+
+  void AddKey(const Slice& key);
+  Slice Finish();
+
+ private:
+  const FilterPolicy* policy_;
+  std::string keys_;           // Flattened key contents
+  std::vector<size_t> start_;  // Starting index in keys_ of each key
+  std::string result_;         // Filter data computed by Finish()
+};
+
+class FullFilterBlockReader {
+ public:
+  // REQUIRES: "contents" and *policy must stay live while *this is live.
+  FullFilterBlockReader(const FilterPolicy* policy, const Slice& contents);
+  bool KeyMayMatch(const Slice& key);
+
+ private:
+  const FilterPolicy* policy_;
+  Slice contents_;
+};
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_TABLE_FILTER_BLOCK_H_
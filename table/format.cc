@@ -4,11 +4,14 @@
 
 #include "table/format.h"
 
+#include <cstring>
+
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "table/block.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
@@ -61,8 +64,15 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
+uint32_t BlockHashIndexHash(const Slice& key) {
+  // Internal keys end in an 8-byte sequence number and type
+  const size_t n = key.size() >= 8 ? key.size() - 8 : key.size();
+  return Hash(key.data(), n, 0x6a09e667);
+}
+
 Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result) {
+                 const BlockHandle& handle, BlockContents* result,
+                 std::string* stored) {
   result->data = Slice();
   result->cachable = false;
   result->heap_allocated = false;
@@ -94,6 +104,10 @@ Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
     }
   }
 
+  if (stored != nullptr) {
+    stored->assign(data, n + 1);
+  }
+
   switch (data[n]) {
     case kNoCompression:
       if (data != buf) {
@@ -112,30 +126,70 @@ Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
 
       // Ok
       break;
+    case kSnappyCompression: {
+      s = UncompressBlock(Slice(data, n + 1), result);
+      delete[] buf;
+      return s;
+    }
+    default:
+      delete[] buf;
+      return Status::Corruption("bad block type");
+  }
+
+  return Status::OK();
+}
+
+Status ParseBlock(const char* data, size_t n, const ReadOptions& options,
+                  BlockContents* result) {
+  if (options.verify_checksums) {
+    const uint32_t crc = crc32c::Unmask(DecodeFixed32(data + n + 1));
+    const uint32_t actual = crc32c::Value(data, n + 1);
+    if (actual != crc) {
+      result->data = Slice();
+      result->cachable = false;
+      result->heap_allocated = false;
+      return Status::Corruption("block checksum mismatch");
+    }
+  }
+  return UncompressBlock(Slice(data, n + 1), result);
+}
+
+Status UncompressBlock(const Slice& stored, BlockContents* result) {
+  result->data = Slice();
+  result->cachable = false;
+  result->heap_allocated = false;
+  if (stored.empty()) {
+    return Status::Corruption("bad block type");
+  }
+  const char* data = stored.data();
+  const size_t n = stored.size() - 1;
+  switch (data[n]) {
+    case kNoCompression: {
+      char* ubuf = new char[n];
+      std::memcpy(ubuf, data, n);
+      result->data = Slice(ubuf, n);
+      result->heap_allocated = true;
+      result->cachable = true;
+      return Status::OK();
+    }
     case kSnappyCompression: {
       size_t ulength = 0;
       if (!port::Snappy_GetUncompressedLength(data, n, &ulength)) {
-        delete[] buf;
         return Status::Corruption("corrupted compressed block contents");
       }
       char* ubuf = new char[ulength];
       if (!port::Snappy_Uncompress(data, n, ubuf)) {
-        delete[] buf;
         delete[] ubuf;
         return Status::Corruption("corrupted compressed block contents");
       }
-      delete[] buf;
       result->data = Slice(ubuf, ulength);
       result->heap_allocated = true;
       result->cachable = true;
-      break;
+      return Status::OK();
     }
     default:
-      delete[] buf;
       return Status::Corruption("bad block type");
   }
-
-  return Status::OK();
 }
 
 }  // namespace leveldb
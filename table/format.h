@@ -78,6 +78,19 @@ static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
 // 1-byte type + 32-bit crc
 static const size_t kBlockTrailerSize = 5;
 
+// Set in the trailing restart count of a block that ends with a hash
+// index over its user keys.  See block_builder.cc for the layout.
+static const uint32_t kBlockHashIndexFlag = 1u << 31;
+
+// Bucket values of a block hash index that are not restart indexes.
+static const uint8_t kBlockHashIndexCollision = 254;
+static const uint8_t kBlockHashIndexEmpty = 255;
+
+// Returns the block hash index hash of internal key "key"; its bucket is
+// the hash modulo the number of buckets.  Only the user key is hashed, so
+// all versions of a key share a bucket.
+uint32_t BlockHashIndexHash(const Slice& key);
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
@@ -85,9 +98,22 @@ struct BlockContents {
 };
 
 // Read the block identified by "handle" from "file".  On failure
-// return non-OK.  On success fill *result and return OK.
+// return non-OK.  On success fill *result and return OK.  If "stored" is
+// non-null, the block's stored form (its possibly compressed contents
+// followed by the one-byte compression type) is also copied into *stored.
 Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result);
+                 const BlockHandle& handle, BlockContents* result,
+                 std::string* stored = nullptr);
+
+// Fill *result with the uncompressed contents of a block in the stored
+// form returned by ReadBlock.  The contents are always heap allocated.
+Status UncompressBlock(const Slice& stored, BlockContents* result);
+
+// Like ReadBlock(), but for a block of "n" bytes and its trailer that the
+// caller has already read into "data".  The contents are always heap
+// allocated.
+Status ParseBlock(const char* data, size_t n, const ReadOptions& options,
+                  BlockContents* result);
 
 // Implementation details follow.  Clients should ignore,
 
@@ -3,6 +3,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include <atomic>
+#include <vector>
 
 #include "leveldb/table.h"
 
@@ -11,6 +12,7 @@
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/persistent_cache.h"
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
@@ -25,26 +27,293 @@ size_t Table::GetTableCacheSize() {
   return table_cache_size.load(std::memory_order_relaxed);
 }
 
+namespace {
+
+// The filter of a table, in one of the two formats, and the data it reads.
+struct TableFilter {
+  TableFilter() : filter(nullptr), full_filter(nullptr), data(nullptr) {}
+  ~TableFilter() {
+    delete filter;
+    delete full_filter;
+    delete[] data;
+  }
+
+  FilterBlockReader* filter;
+  FullFilterBlockReader* full_filter;
+  const char* data;  // Owned filter contents, if heap allocated
+};
+
+}  // namespace
+
 struct Table::Rep {
   ~Rep() {
     delete filter;
-    delete[] filter_data;
     delete index_block;
     table_cache_size.fetch_sub(heap_size, std::memory_order_relaxed);
   }
 
+  // True if the index and filter blocks live in the block cache rather
+  // than in this Rep.
+  bool CacheMetaBlocks() const {
+    return options.cache_index_and_filter_blocks &&
+           options.block_cache != nullptr;
+  }
+
+  // Returns an iterator over the index block.
+  Iterator* NewIndexIterator();
+
+  // Reads the filter block into a new TableFilter; "*charge" is set to its
+  // size.
+  Status ReadFilterBlock(TableFilter** result, size_t* charge);
+
+  // Returns the table's filter, or nullptr if it has none.  The caller must
+  // pass the result and "*handle" to ReleaseFilter() when done.
+  TableFilter* GetFilter(Cache::Handle** handle);
+  void ReleaseFilter(TableFilter* f, Cache::Handle* handle);
+
+  // Adds "f" to the block cache at high priority and returns its handle,
+  // or nullptr if the cache refused it and the caller still owns "f".
+  Cache::Handle* InsertFilter(TableFilter* f, size_t charge);
+
+  // Reads the data block at "handle", from options.compressed_block_cache
+  // or options.persistent_cache if it is there, filling them on a miss.
+  Status ReadDataBlock(const ReadOptions& read_options,
+                       const BlockHandle& handle, BlockContents* contents);
+
+  // Asks the file to read ahead of the data block at "handle" for a scan.
+  // The file is split into windows of "readahead_size" bytes and only the
+  // block that crosses into a window requests the next one, so a scan
+  // costs one hint per window rather than one per block.
+  void Readahead(size_t readahead_size, const BlockHandle& handle) const {
+    const uint64_t start = handle.offset();
+    const uint64_t end = start + handle.size() + kBlockTrailerSize;
+    if (start / readahead_size != end / readahead_size) {
+      file->Prefetch(end, readahead_size);
+    }
+  }
+
+  // Returns the block cache key of the block at "offset".
+  Slice CacheKey(uint64_t offset, char (*buffer)[16]) const {
+    return EncodeCacheKey(cache_id, offset, buffer);
+  }
+
+  static Slice EncodeCacheKey(uint64_t id, uint64_t offset,
+                              char (*buffer)[16]) {
+    EncodeFixed64(*buffer, id);
+    EncodeFixed64(*buffer + 8, offset);
+    return Slice(*buffer, sizeof(*buffer));
+  }
+
   Options options;
   Status status;
   RandomAccessFile* file;
   uint64_t cache_id;
-  FilterBlockReader* filter;
-  const char* filter_data;
+  uint64_t compressed_cache_id;
+  uint64_t persistent_cache_id;
+  bool has_filter;
+  bool full_filter;            // Format of the filter, if has_filter
+  BlockHandle filter_handle;   // Location of the filter, if has_filter
+  TableFilter* filter;         // Null if !has_filter or CacheMetaBlocks()
   size_t heap_size;
+  size_t index_size;   // Of index_block, heap allocated or not
+  size_t filter_size;  // Of filter, heap allocated or not
+  std::atomic<size_t>* iterator_usage;  // See Table::SetIteratorUsage()
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
-  Block* index_block;
+  BlockHandle index_handle;
+  Block* index_block;  // Null if CacheMetaBlocks()
 };
 
+static void DeleteBlock(void* arg, void* ignored) {
+  delete reinterpret_cast<Block*>(arg);
+}
+
+static void DeleteCachedBlock(const Slice& key, void* value) {
+  Block* block = reinterpret_cast<Block*>(value);
+  delete block;
+}
+
+static void ReleaseIteratorUsage(void* arg, void* size) {
+  reinterpret_cast<std::atomic<size_t>*>(arg)->fetch_sub(
+      reinterpret_cast<uintptr_t>(size), std::memory_order_relaxed);
+}
+
+static void ReleaseBlock(void* arg, void* h) {
+  Cache* cache = reinterpret_cast<Cache*>(arg);
+  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
+  cache->Release(handle);
+}
+
+static void DeleteCachedFilter(const Slice& key, void* value) {
+  delete reinterpret_cast<TableFilter*>(value);
+}
+
+static void DeleteCompressedBlock(const Slice& key, void* value) {
+  delete reinterpret_cast<std::string*>(value);
+}
+
+Status Table::Rep::ReadDataBlock(const ReadOptions& read_options,
+                                 const BlockHandle& handle,
+                                 BlockContents* contents) {
+  Cache* compressed_cache = options.compressed_block_cache;
+  PersistentCache* persistent_cache =
+      options.block_cache != nullptr ? options.persistent_cache : nullptr;
+  if (compressed_cache == nullptr && persistent_cache == nullptr) {
+    return ReadBlock(file, read_options, handle, contents);
+  }
+
+  char compressed_key_buffer[16];
+  Slice compressed_key;
+  if (compressed_cache != nullptr) {
+    compressed_key = EncodeCacheKey(compressed_cache_id, handle.offset(),
+                                    &compressed_key_buffer);
+    Cache::Handle* cache_handle = compressed_cache->Lookup(compressed_key);
+    if (cache_handle != nullptr) {
+      Status s = UncompressBlock(*reinterpret_cast<std::string*>(
+                                     compressed_cache->Value(cache_handle)),
+                                 contents);
+      compressed_cache->Release(cache_handle);
+      return s;
+    }
+  }
+
+  char persistent_key_buffer[16];
+  Slice key = EncodeCacheKey(persistent_cache_id, handle.offset(),
+                             &persistent_key_buffer);
+  std::string* stored = new std::string;
+  Status s;
+  bool from_file = true;
+  if (persistent_cache != nullptr &&
+      persistent_cache->Lookup(key, stored).ok()) {
+    s = UncompressBlock(*stored, contents);
+    from_file = !s.ok();
+  }
+  if (from_file) {
+    s = ReadBlock(file, read_options, handle, contents, stored);
+    if (s.ok() && persistent_cache != nullptr && read_options.fill_cache) {
+      persistent_cache->Insert(key, *stored);
+    }
+  }
+
+  // Only compressed blocks are worth keeping in compressed form.
+  if (s.ok() && compressed_cache != nullptr && read_options.fill_cache &&
+      stored->back() != kNoCompression) {
+    Cache::Handle* cache_handle = compressed_cache->Insert(
+        compressed_key, stored, stored->size(), &DeleteCompressedBlock);
+    if (cache_handle != nullptr) {
+      compressed_cache->Release(cache_handle);
+    } else {
+      delete stored;
+    }
+  } else {
+    delete stored;
+  }
+  return s;
+}
+
+Iterator* Table::Rep::NewIndexIterator() {
+  if (index_block != nullptr) {
+    return index_block->NewIterator(options.comparator);
+  }
+
+  Cache* block_cache = options.block_cache;
+  char cache_key_buffer[16];
+  Slice key = CacheKey(index_handle.offset(), &cache_key_buffer);
+  Block* block;
+  Cache::Handle* cache_handle = block_cache->Lookup(key);
+  if (cache_handle != nullptr) {
+    block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
+  } else {
+    ReadOptions opt;
+    if (options.paranoid_checks) {
+      opt.verify_checksums = true;
+    }
+    BlockContents contents;
+    Status s = ReadBlock(file, opt, index_handle, &contents);
+    if (!s.ok()) {
+      return NewErrorIterator(s);
+    }
+    block = new Block(contents);
+    cache_handle =
+        block_cache->InsertWithPriority(key, block, block->size(),
+                                        &DeleteCachedBlock, Cache::kHighPriority);
+  }
+
+  Iterator* iter = block->NewIterator(options.comparator);
+  if (cache_handle == nullptr) {
+    iter->RegisterCleanup(&DeleteBlock, block, nullptr);
+  } else {
+    iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+  }
+  return iter;
+}
+
+Status Table::Rep::ReadFilterBlock(TableFilter** result, size_t* charge) {
+  // We might want to unify with ReadBlock() if we start
+  // requiring checksum verification in Table::Open.
+  ReadOptions opt;
+  if (options.paranoid_checks) {
+    opt.verify_checksums = true;
+  }
+  BlockContents block;
+  Status s = ReadBlock(file, opt, filter_handle, &block);
+  if (!s.ok()) {
+    return s;
+  }
+  TableFilter* f = new TableFilter;
+  if (block.heap_allocated) {
+    f->data = block.data.data();  // Will need to delete later
+  }
+  if (full_filter) {
+    f->full_filter = new FullFilterBlockReader(options.filter_policy, block.data);
+  } else {
+    f->filter = new FilterBlockReader(options.filter_policy, block.data);
+  }
+  *result = f;
+  *charge = block.data.size();
+  return s;
+}
+
+Cache::Handle* Table::Rep::InsertFilter(TableFilter* f, size_t charge) {
+  char cache_key_buffer[16];
+  return options.block_cache->InsertWithPriority(
+      CacheKey(filter_handle.offset(), &cache_key_buffer), f, charge,
+      &DeleteCachedFilter, Cache::kHighPriority);
+}
+
+TableFilter* Table::Rep::GetFilter(Cache::Handle** handle) {
+  *handle = nullptr;
+  if (!has_filter || !CacheMetaBlocks()) {
+    return filter;
+  }
+
+  Cache* block_cache = options.block_cache;
+  char cache_key_buffer[16];
+  Cache::Handle* h =
+      block_cache->Lookup(CacheKey(filter_handle.offset(), &cache_key_buffer));
+  if (h == nullptr) {
+    TableFilter* f;
+    size_t charge;
+    if (!ReadFilterBlock(&f, &charge).ok()) {
+      return nullptr;  // Do without the filter
+    }
+    h = InsertFilter(f, charge);
+    if (h == nullptr) {
+      return f;  // Not cached; deleted by ReleaseFilter()
+    }
+  }
+  *handle = h;
+  return reinterpret_cast<TableFilter*>(block_cache->Value(h));
+}
+
+void Table::Rep::ReleaseFilter(TableFilter* f, Cache::Handle* handle) {
+  if (handle != nullptr) {
+    options.block_cache->Release(handle);
+  } else if (f != filter) {
+    delete f;
+  }
+}
+
 Status Table::Open(const Options& options, RandomAccessFile* file,
                    uint64_t size, Table** table) {
   *table = nullptr;
@@ -78,16 +347,45 @@ Status Table::Open(const Options& options, RandomAccessFile* file,
     rep->options = options;
     rep->file = file;
     rep->metaindex_handle = footer.metaindex_handle();
+    rep->index_handle = footer.index_handle();
     rep->index_block = index_block;
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
-    rep->filter_data = nullptr;
+    rep->compressed_cache_id = (options.compressed_block_cache
+                                    ? options.compressed_block_cache->NewId()
+                                    : 0);
+    rep->persistent_cache_id =
+        (options.block_cache && options.persistent_cache
+             ? options.persistent_cache->NewId()
+             : 0);
+    rep->has_filter = false;
+    rep->full_filter = false;
     rep->filter = nullptr;
     rep->heap_size = 0;
+    rep->index_size = 0;
+    rep->filter_size = 0;
+    rep->iterator_usage = nullptr;
     *table = new Table(rep);
     (*table)->ReadMeta(footer);
 
-    if (index_block_contents.heap_allocated)
-      rep->heap_size += index_block_contents.data.size();
+    if (rep->CacheMetaBlocks()) {
+      // Hand the index block over to the block cache
+      char cache_key_buffer[16];
+      Cache::Handle* h = options.block_cache->InsertWithPriority(
+          rep->CacheKey(rep->index_handle.offset(), &cache_key_buffer),
+          index_block, index_block->size(), &DeleteCachedBlock,
+          Cache::kHighPriority);
+      if (h != nullptr) {
+        options.block_cache->Release(h);
+      } else {
+        delete index_block;
+      }
+      rep->index_block = nullptr;
+    } else {
+      rep->index_size = index_block_contents.data.size();
+      if (index_block_contents.heap_allocated) {
+        rep->heap_size += rep->index_size;
+      }
+    }
     table_cache_size.fetch_add(rep->heap_size, std::memory_order_relaxed);
   }
 
@@ -113,62 +411,71 @@ void Table::ReadMeta(const Footer& footer) {
   Block* meta = new Block(contents);
 
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
+  // A table carries at most one of the two filter formats; prefer the
+  // full filter since it is checked without touching the index block.
+  std::string key = "fullfilter.";
   key.append(rep_->options.filter_policy->Name());
   iter->Seek(key);
   if (iter->Valid() && iter->key() == Slice(key)) {
-    ReadFilter(iter->value());
+    ReadFilter(iter->value(), true);
+  } else {
+    key = "filter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value(), false);
+    }
   }
   delete iter;
   delete meta;
 }
 
-void Table::ReadFilter(const Slice& filter_handle_value) {
+void Table::ReadFilter(const Slice& filter_handle_value, bool full) {
   Slice v = filter_handle_value;
   BlockHandle filter_handle;
   if (!filter_handle.DecodeFrom(&v).ok()) {
     return;
   }
+  rep_->filter_handle = filter_handle;
+  rep_->full_filter = full;
 
-  // We might want to unify with ReadBlock() if we start
-  // requiring checksum verification in Table::Open.
-  ReadOptions opt;
-  if (rep_->options.paranoid_checks) {
-    opt.verify_checksums = true;
-  }
-  BlockContents block;
-  if (!ReadBlock(rep_->file, opt, filter_handle, &block).ok()) {
+  TableFilter* filter;
+  size_t charge;
+  if (!rep_->ReadFilterBlock(&filter, &charge).ok()) {
     return;
   }
-  if (block.heap_allocated) {
-    rep_->filter_data = block.data.data();  // Will need to delete later
-    rep_->heap_size += block.data.size();
+  rep_->has_filter = true;
+  if (rep_->CacheMetaBlocks()) {
+    // Hand the filter over to the block cache
+    Cache::Handle* h = rep_->InsertFilter(filter, charge);
+    if (h != nullptr) {
+      rep_->options.block_cache->Release(h);
+    } else {
+      delete filter;
+    }
+  } else {
+    rep_->filter = filter;
+    rep_->filter_size = charge;
+    if (filter->data != nullptr) {
+      rep_->heap_size += charge;
+    }
   }
-  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
 }
 
 Table::~Table() { delete rep_; }
 
-static void DeleteBlock(void* arg, void* ignored) {
-  delete reinterpret_cast<Block*>(arg);
-}
-
-static void DeleteCachedBlock(const Slice& key, void* value) {
-  Block* block = reinterpret_cast<Block*>(value);
-  delete block;
-}
-
-static void ReleaseBlock(void* arg, void* h) {
-  Cache* cache = reinterpret_cast<Cache*>(arg);
-  Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
-  cache->Release(handle);
-}
-
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
 Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
                              const Slice& index_value) {
   Table* table = reinterpret_cast<Table*>(arg);
+  return table->NewBlockIterator(options, index_value, nullptr);
+}
+
+Iterator* Table::NewBlockIterator(const ReadOptions& options,
+                                  const Slice& index_value,
+                                  const Slice* get_key) const {
+  const Table* table = this;
   Cache* block_cache = table->rep_->options.block_cache;
   Block* block = nullptr;
   Cache::Handle* cache_handle = nullptr;
@@ -180,17 +487,19 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
   // can add more features in the future.
 
   if (s.ok()) {
+    const bool readahead = get_key == nullptr && options.readahead_size > 0;
     BlockContents contents;
     if (block_cache != nullptr) {
       char cache_key_buffer[16];
-      EncodeFixed64(cache_key_buffer, table->rep_->cache_id);
-      EncodeFixed64(cache_key_buffer + 8, handle.offset());
-      Slice key(cache_key_buffer, sizeof(cache_key_buffer));
+      Slice key = table->rep_->CacheKey(handle.offset(), &cache_key_buffer);
       cache_handle = block_cache->Lookup(key);
       if (cache_handle != nullptr) {
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
       } else {
-        s = ReadBlock(table->rep_->file, options, handle, &contents);
+        if (readahead) {
+          table->rep_->Readahead(options.readahead_size, handle);
+        }
+        s = table->rep_->ReadDataBlock(options, handle, &contents);
         if (s.ok()) {
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {
@@ -200,7 +509,10 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
         }
       }
     } else {
-      s = ReadBlock(table->rep_->file, options, handle, &contents);
+      if (readahead) {
+        table->rep_->Readahead(options.readahead_size, handle);
+      }
+      s = table->rep_->ReadDataBlock(options, handle, &contents);
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -209,12 +521,25 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
 
   Iterator* iter;
   if (block != nullptr) {
-    iter = block->NewIterator(table->rep_->options.comparator);
+    if (get_key == nullptr) {
+      iter = block->NewIterator(table->rep_->options.comparator);
+    } else {
+      iter = block->NewIteratorForGet(table->rep_->options.comparator,
+                                      *get_key);
+    }
     if (cache_handle == nullptr) {
       iter->RegisterCleanup(&DeleteBlock, block, nullptr);
     } else {
       iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
     }
+    std::atomic<size_t>* iterator_usage = table->rep_->iterator_usage;
+    if (get_key == nullptr && iterator_usage != nullptr) {
+      // Point lookups release their block at once and are not counted.
+      const uintptr_t size = block->size();
+      iterator_usage->fetch_add(size, std::memory_order_relaxed);
+      iter->RegisterCleanup(&ReleaseIteratorUsage, iterator_usage,
+                            reinterpret_cast<void*>(size));
+    }
   } else {
     iter = NewErrorIterator(s);
   }
@@ -222,27 +547,35 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
 }
 
 Iterator* Table::NewIterator(const ReadOptions& options) const {
-  return NewTwoLevelIterator(
-      rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+  return NewTwoLevelIterator(rep_->NewIndexIterator(), &Table::BlockReader,
+                             const_cast<Table*>(this), options);
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
                           void (*handle_result)(void*, const Slice&,
                                                 const Slice&)) {
   Status s;
-  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  Cache::Handle* filter_handle;
+  TableFilter* table_filter = rep_->GetFilter(&filter_handle);
+  FullFilterBlockReader* full_filter =
+      table_filter != nullptr ? table_filter->full_filter : nullptr;
+  if (full_filter != nullptr && !full_filter->KeyMayMatch(k)) {
+    rep_->ReleaseFilter(table_filter, filter_handle);
+    return s;  // Not found
+  }
+
+  Iterator* iiter = rep_->NewIndexIterator();
   iiter->Seek(k);
   if (iiter->Valid()) {
     Slice handle_value = iiter->value();
-    FilterBlockReader* filter = rep_->filter;
+    FilterBlockReader* filter =
+        table_filter != nullptr ? table_filter->filter : nullptr;
     BlockHandle handle;
     if (filter != nullptr && handle.DecodeFrom(&handle_value).ok() &&
         !filter->KeyMayMatch(handle.offset(), k)) {
       // Not found
     } else {
-      Iterator* block_iter = BlockReader(this, options, iiter->value());
-      block_iter->Seek(k);
+      Iterator* block_iter = NewBlockIterator(options, iiter->value(), &k);
       if (block_iter->Valid()) {
         (*handle_result)(arg, block_iter->key(), block_iter->value());
       }
@@ -254,12 +587,79 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
     s = iiter->status();
   }
   delete iiter;
+  rep_->ReleaseFilter(table_filter, filter_handle);
   return s;
 }
 
+void Table::InternalMultiGet(const ReadOptions& options, int n,
+                             const Slice* keys, void* const* args,
+                             void (*handle_result)(void*, const Slice&,
+                                                   const Slice&),
+                             Status* statuses) {
+  for (int i = 0; i < n; i++) {
+    statuses[i] = Status::OK();
+  }
+  Cache::Handle* filter_handle;
+  TableFilter* table_filter = rep_->GetFilter(&filter_handle);
+  FullFilterBlockReader* full_filter =
+      table_filter != nullptr ? table_filter->full_filter : nullptr;
+  FilterBlockReader* filter =
+      table_filter != nullptr ? table_filter->filter : nullptr;
+  const Comparator* cmp = rep_->options.comparator;
+
+  // The keys are sorted, so the index iterator only moves forward, and the
+  // keys in one data block are next to each other.
+  Iterator* iiter = rep_->NewIndexIterator();
+  std::vector<int> block_keys;
+  int i = 0;
+  while (i < n) {
+    if (!iiter->Valid() || cmp->Compare(keys[i], iiter->key()) > 0) {
+      iiter->Seek(keys[i]);
+      if (!iiter->Valid()) {
+        break;  // Past the last block, or an error
+      }
+    }
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    const bool decoded = handle.DecodeFrom(&handle_value).ok();
+    block_keys.clear();
+    for (; i < n && cmp->Compare(keys[i], iiter->key()) <= 0; i++) {
+      if ((full_filter == nullptr || full_filter->KeyMayMatch(keys[i])) &&
+          (filter == nullptr || !decoded ||
+           filter->KeyMayMatch(handle.offset(), keys[i]))) {
+        block_keys.push_back(i);
+      }
+    }
+    if (block_keys.empty()) {
+      continue;
+    }
+
+    // A single key takes the point lookup path of InternalGet().
+    ReadOptions block_options = options;
+    block_options.readahead_size = 0;
+    Iterator* block_iter = NewBlockIterator(
+        block_options, iiter->value(),
+        block_keys.size() == 1 ? &keys[block_keys[0]] : nullptr);
+    for (int j : block_keys) {
+      if (block_keys.size() > 1) {
+        block_iter->Seek(keys[j]);
+      }
+      if (block_iter->Valid()) {
+        (*handle_result)(args[j], block_iter->key(), block_iter->value());
+      }
+      statuses[j] = block_iter->status();
+    }
+    delete block_iter;
+  }
+  for (; i < n; i++) {
+    statuses[i] = iiter->status();
+  }
+  delete iiter;
+  rep_->ReleaseFilter(table_filter, filter_handle);
+}
+
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
-  Iterator* index_iter =
-      rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* index_iter = rep_->NewIndexIterator();
   index_iter->Seek(key);
   uint64_t result;
   if (index_iter->Valid()) {
@@ -284,4 +684,95 @@ uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
   return result;
 }
 
+uint64_t Table::CacheId() const { return rep_->cache_id; }
+
+void Table::GetMemoryUsage(size_t* usage, size_t* filter_usage) const {
+  *usage = rep_->index_size + rep_->filter_size;
+  *filter_usage = rep_->filter_size;
+}
+
+void Table::SetIteratorUsage(std::atomic<size_t>* usage) {
+  rep_->iterator_usage = usage;
+}
+
+// PrefetchBlocks() reads blocks separated by at most kMaxPrefetchGap bytes
+// together, in reads of up to kMaxPrefetchRead bytes.
+static const uint64_t kMaxPrefetchGap = 32 << 10;
+static const uint64_t kMaxPrefetchRead = 1 << 20;
+
+Status Table::PrefetchBlocks(const std::vector<uint64_t>& offsets) const {
+  Cache* block_cache = rep_->options.block_cache;
+  if (block_cache == nullptr || offsets.empty()) {
+    return Status::OK();
+  }
+
+  // The index lists the data blocks in file order.
+  std::vector<BlockHandle> handles;
+  Iterator* index_iter = rep_->NewIndexIterator();
+  size_t next = 0;
+  for (index_iter->SeekToFirst(); index_iter->Valid() && next < offsets.size();
+       index_iter->Next()) {
+    BlockHandle handle;
+    Slice input = index_iter->value();
+    if (!handle.DecodeFrom(&input).ok()) {
+      break;
+    }
+    while (next < offsets.size() && offsets[next] < handle.offset()) {
+      next++;
+    }
+    if (next < offsets.size() && offsets[next] == handle.offset()) {
+      handles.push_back(handle);
+    }
+  }
+  Status s = index_iter->status();
+  delete index_iter;
+
+  ReadOptions opt;
+  if (rep_->options.paranoid_checks) {
+    opt.verify_checksums = true;
+  }
+  std::string scratch;
+  size_t i = 0;
+  while (s.ok() && i < handles.size()) {
+    const uint64_t start = handles[i].offset();
+    uint64_t end = start + handles[i].size() + kBlockTrailerSize;
+    size_t run_end = i + 1;
+    while (run_end < handles.size()) {
+      const BlockHandle& h = handles[run_end];
+      const uint64_t h_end = h.offset() + h.size() + kBlockTrailerSize;
+      if (h.offset() - end > kMaxPrefetchGap ||
+          h_end - start > kMaxPrefetchRead) {
+        break;
+      }
+      end = h_end;
+      run_end++;
+    }
+
+    scratch.resize(end - start);
+    Slice data;
+    s = rep_->file->Read(start, end - start, &data, &scratch[0]);
+    if (s.ok() && data.size() != end - start) {
+      s = Status::Corruption("truncated block read");
+    }
+    for (; s.ok() && i < run_end; i++) {
+      BlockContents contents;
+      s = ParseBlock(data.data() + (handles[i].offset() - start),
+                     handles[i].size(), opt, &contents);
+      if (s.ok()) {
+        Block* block = new Block(contents);
+        char cache_key_buffer[16];
+        Cache::Handle* cache_handle = block_cache->Insert(
+            rep_->CacheKey(handles[i].offset(), &cache_key_buffer), block,
+            block->size(), &DeleteCachedBlock);
+        if (cache_handle != nullptr) {
+          block_cache->Release(cache_handle);
+        } else {
+          delete block;
+        }
+      }
+    }
+  }
+  return s;
+}
+
 }  // namespace leveldb
@@ -28,11 +28,15 @@ struct TableBuilder::Rep {
         index_block(&index_block_options),
         num_entries(0),
         closed(false),
-        filter_block(opt.filter_policy == nullptr
+        filter_block(opt.filter_policy == nullptr || opt.full_filter
                          ? nullptr
                          : new FilterBlockBuilder(opt.filter_policy)),
+        full_filter_block(opt.filter_policy == nullptr || !opt.full_filter
+                              ? nullptr
+                              : new FullFilterBlockBuilder(opt.filter_policy)),
         pending_index_entry(false) {
     index_block_options.block_restart_interval = 1;
+    index_block_options.data_block_hash_index = false;
   }
 
   Options options;
@@ -46,6 +50,7 @@ struct TableBuilder::Rep {
   int64_t num_entries;
   bool closed;  // Either Finish() or Abandon() has been called.
   FilterBlockBuilder* filter_block;
+  FullFilterBlockBuilder* full_filter_block;
 
   // We do not emit the index entry for a block until we have seen the
   // first key for the next data block.  This allows us to use shorter
@@ -72,6 +77,7 @@ TableBuilder::TableBuilder(const Options& options, WritableFile* file)
 TableBuilder::~TableBuilder() {
   assert(rep_->closed);  // Catch errors where caller forgot to call Finish()
   delete rep_->filter_block;
+  delete rep_->full_filter_block;
   delete rep_;
 }
 
@@ -88,6 +94,7 @@ Status TableBuilder::ChangeOptions(const Options& options) {
   rep_->options = options;
   rep_->index_block_options = options;
   rep_->index_block_options.block_restart_interval = 1;
+  rep_->index_block_options.data_block_hash_index = false;
   return Status::OK();
 }
 
@@ -110,6 +117,8 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
 
   if (r->filter_block != nullptr) {
     r->filter_block->AddKey(key);
+  } else if (r->full_filter_block != nullptr) {
+    r->full_filter_block->AddKey(key);
   }
 
   r->last_key.assign(key.data(), key.size());
@@ -207,11 +216,17 @@ Status TableBuilder::Finish() {
   if (ok() && r->filter_block != nullptr) {
     WriteRawBlock(r->filter_block->Finish(), kNoCompression,
                   &filter_block_handle);
+  } else if (ok() && r->full_filter_block != nullptr) {
+    WriteRawBlock(r->full_filter_block->Finish(), kNoCompression,
+                  &filter_block_handle);
   }
 
   // Write metaindex block
   if (ok()) {
-    BlockBuilder meta_index_block(&r->options);
+    // Metaindex keys are not internal keys; never hash index them.
+    Options meta_index_options = r->options;
+    meta_index_options.data_block_hash_index = false;
+    BlockBuilder meta_index_block(&meta_index_options);
     if (r->filter_block != nullptr) {
       // Add mapping from "filter.Name" to location of filter data
       std::string key = "filter.";
@@ -219,6 +234,13 @@ Status TableBuilder::Finish() {
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
+    } else if (r->full_filter_block != nullptr) {
+      // Add mapping from "fullfilter.Name" to location of filter data
+      std::string key = "fullfilter.";
+      key.append(r->options.filter_policy->Name());
+      std::string handle_encoding;
+      filter_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add(key, handle_encoding);
     }
 
     // TODO(postrelease): Add stats and other meta blocks
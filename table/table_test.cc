@@ -11,9 +11,12 @@
 #include "db/dbformat.h"
 #include "db/memtable.h"
 #include "db/write_batch_internal.h"
+#include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
 #include "leveldb/iterator.h"
+#include "leveldb/persistent_cache.h"
 #include "leveldb/table_builder.h"
 #include "table/block.h"
 #include "table/block_builder.h"
@@ -638,6 +641,63 @@ TEST_F(Harness, ZeroRestartPointsInBlock) {
   delete iter;
 }
 
+// Point lookups through the data block hash index must agree with a
+// plain Seek, including for keys with several versions and absent keys.
+TEST_F(Harness, BlockHashIndex) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  for (int with_index = 0; with_index < 2; with_index++) {
+    Options options;
+    options.comparator = &cmp;
+    options.block_restart_interval = 4;
+    options.data_block_hash_index = (with_index != 0);
+    BlockBuilder builder(&options);
+    char buf[20];
+    for (int i = 0; i < 200; i += 2) {
+      std::snprintf(buf, sizeof(buf), "key%06d", i);
+      // Three versions of every key, newest first
+      for (int seq = 3; seq >= 1; seq--) {
+        std::string v = std::string(buf) + "@" + std::to_string(seq);
+        builder.Add(InternalKey(buf, seq, kTypeValue).Encode(), v);
+      }
+    }
+    Slice raw = builder.Finish();
+    const uint32_t trailer = DecodeFixed32(raw.data() + raw.size() - 4);
+    ASSERT_EQ(with_index != 0, (trailer & kBlockHashIndexFlag) != 0);
+
+    BlockContents contents;
+    contents.data = raw;
+    contents.cachable = false;
+    contents.heap_allocated = false;
+    Block block(contents);
+    for (int i = 0; i < 200; i++) {
+      std::snprintf(buf, sizeof(buf), "key%06d", i);
+      for (int seq = 1; seq <= 3; seq++) {
+        InternalKey target(buf, seq, kValueTypeForSeek);
+        Iterator* iter = block.NewIteratorForGet(&cmp, target.Encode());
+        ASSERT_TRUE(iter->status().ok());
+        ParsedInternalKey parsed;
+        bool found = iter->Valid() && ParseInternalKey(iter->key(), &parsed) &&
+                     parsed.user_key == Slice(buf);
+        if (i % 2 == 0) {
+          ASSERT_TRUE(found) << buf;
+          ASSERT_EQ(std::string(buf) + "@" + std::to_string(seq),
+                    iter->value().ToString());
+        } else {
+          ASSERT_TRUE(!found) << buf;
+        }
+        delete iter;
+      }
+    }
+
+    // Ordinary iteration sees the same entries either way
+    Iterator* iter = block.NewIterator(&cmp);
+    int n = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) n++;
+    ASSERT_EQ(300, n);
+    delete iter;
+  }
+}
+
 // Test the empty key
 TEST_F(Harness, SimpleEmptyKey) {
   for (int i = 0; i < kNumTestArgs; i++) {
@@ -784,12 +844,199 @@ TEST(TableTest, ApproximateOffsetOfPlain) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 610000, 612000));
 }
 
+TEST(TableTest, IndexAndFilterBlocksInCache) {
+  Options options;
+  options.block_size = 256;
+  options.compression = kNoCompression;
+  options.filter_policy = NewBloomFilterPolicy(10);
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  char buf[20];
+  for (int i = 0; i < 1000; i++) {
+    std::snprintf(buf, sizeof(buf), "k%06d", i);
+    builder.Add(buf, std::string(50, 'v'));
+  }
+  ASSERT_LEVELDB_OK(builder.Finish());
+
+  StringSource source(sink.contents());
+  Cache* cache = NewLRUCache(1 << 20, 0, false);
+  options.block_cache = cache;
+  options.cache_index_and_filter_blocks = true;
+  const size_t heap_before = Table::GetTableCacheSize();
+  Table* table;
+  ASSERT_LEVELDB_OK(
+      Table::Open(options, &source, sink.contents().size(), &table));
+
+  // The index and filter blocks are charged to the cache, not the table.
+  ASSERT_EQ(heap_before, Table::GetTableCacheSize());
+  const size_t meta_charge = cache->TotalCharge();
+  ASSERT_GT(meta_charge, 0);
+
+  // Even with no room left for data blocks, the metadata stays cached.
+  delete table;
+  delete cache;
+  cache = NewLRUCache(meta_charge, 0, true);
+  options.block_cache = cache;
+  ASSERT_LEVELDB_OK(
+      Table::Open(options, &source, sink.contents().size(), &table));
+  for (int pass = 0; pass < 2; pass++) {
+    Iterator* iter = table->NewIterator(ReadOptions());
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      count++;
+    }
+    ASSERT_LEVELDB_OK(iter->status());
+    ASSERT_EQ(1000, count);
+    delete iter;
+    ASSERT_GT(table->ApproximateOffsetOf("k000500"), 0);
+    if (pass == 0) {
+      ASSERT_EQ(meta_charge, cache->TotalCharge());
+    } else {
+      // Only the index block has been needed since
+      ASSERT_GT(cache->TotalCharge(), 0);
+      ASSERT_LT(cache->TotalCharge(), meta_charge);
+    }
+
+    // Once dropped they are read back on demand.
+    cache->Prune();
+    ASSERT_EQ(0, cache->TotalCharge());
+  }
+
+  delete table;
+  delete cache;
+  delete options.filter_policy;
+}
+
 static bool SnappyCompressionSupported() {
   std::string out;
   Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
   return port::Snappy_Compress(in.data(), in.size(), &out);
 }
 
+// A StringSource that counts the reads made of it.
+class CountingStringSource : public StringSource {
+ public:
+  CountingStringSource(const Slice& contents)
+      : StringSource(contents), reads_(0) {}
+
+  Status Read(uint64_t offset, size_t n, Slice* result,
+              char* scratch) const override {
+    reads_++;
+    return StringSource::Read(offset, n, result, scratch);
+  }
+
+  int reads() const { return reads_; }
+
+ private:
+  mutable int reads_;
+};
+
+TEST(TableTest, CompressedBlockCache) {
+  if (!SnappyCompressionSupported()) {
+    std::fprintf(stderr, "skipping compression tests\n");
+    return;
+  }
+
+  Options options;
+  options.block_size = 1024;
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  char buf[20];
+  for (int i = 0; i < 1000; i++) {
+    std::snprintf(buf, sizeof(buf), "k%06d", i);
+    builder.Add(buf, std::string(100, 'a' + i % 26));
+  }
+  ASSERT_LEVELDB_OK(builder.Finish());
+
+  CountingStringSource source(sink.contents());
+  options.block_cache = NewLRUCache(1 << 20);
+  options.compressed_block_cache = NewLRUCache(1 << 20);
+  Table* table;
+  ASSERT_LEVELDB_OK(
+      Table::Open(options, &source, sink.contents().size(), &table));
+
+  for (int pass = 0; pass < 2; pass++) {
+    const int reads_before = source.reads();
+    Iterator* iter = table->NewIterator(ReadOptions());
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ASSERT_EQ(std::string(100, 'a' + count % 26), iter->value().ToString());
+      count++;
+    }
+    ASSERT_LEVELDB_OK(iter->status());
+    ASSERT_EQ(1000, count);
+    delete iter;
+    if (pass == 0) {
+      ASSERT_GT(source.reads(), reads_before);
+      // Compressed blocks take far less room than the uncompressed ones.
+      ASSERT_GT(options.compressed_block_cache->TotalCharge(), 0);
+      ASSERT_LT(options.compressed_block_cache->TotalCharge() * 4,
+                options.block_cache->TotalCharge());
+    } else {
+      // Blocks dropped from the block cache come from the compressed cache.
+      ASSERT_EQ(reads_before, source.reads());
+    }
+    options.block_cache->Prune();
+  }
+
+  delete table;
+  delete options.block_cache;
+  delete options.compressed_block_cache;
+}
+
+TEST(TableTest, PersistentCache) {
+  Options options;
+  options.block_size = 1024;
+  options.compression = kNoCompression;
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  char buf[20];
+  for (int i = 0; i < 1000; i++) {
+    std::snprintf(buf, sizeof(buf), "k%06d", i);
+    builder.Add(buf, std::string(100, 'a' + i % 26));
+  }
+  ASSERT_LEVELDB_OK(builder.Finish());
+
+  std::string dir;
+  ASSERT_LEVELDB_OK(Env::Default()->GetTestDirectory(&dir));
+  PersistentCache* persistent_cache;
+  ASSERT_LEVELDB_OK(NewPersistentCache(
+      Env::Default(), dir + "/table_test_pcache", 1 << 20, &persistent_cache));
+
+  CountingStringSource source(sink.contents());
+  options.block_cache = NewLRUCache(1 << 20);
+  options.persistent_cache = persistent_cache;
+  Table* table;
+  ASSERT_LEVELDB_OK(
+      Table::Open(options, &source, sink.contents().size(), &table));
+
+  for (int pass = 0; pass < 2; pass++) {
+    const int reads_before = source.reads();
+    Iterator* iter = table->NewIterator(ReadOptions());
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ASSERT_EQ(std::string(100, 'a' + count % 26), iter->value().ToString());
+      count++;
+    }
+    ASSERT_LEVELDB_OK(iter->status());
+    ASSERT_EQ(1000, count);
+    delete iter;
+    if (pass == 0) {
+      ASSERT_GT(source.reads(), reads_before);
+      ASSERT_GT(persistent_cache->TotalSize(),
+                options.block_cache->TotalCharge());
+    } else {
+      // Blocks dropped from memory come from the persistent cache.
+      ASSERT_EQ(reads_before, source.reads());
+    }
+    options.block_cache->Prune();
+  }
+
+  delete table;
+  delete options.block_cache;
+  delete persistent_cache;
+}
+
 TEST(TableTest, ApproximateOffsetOfCompressed) {
   if (!SnappyCompressionSupported()) {
     std::fprintf(stderr, "skipping compression tests\n");
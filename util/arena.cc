@@ -9,7 +9,10 @@ namespace leveldb {
 static const int kBlockSize = 4096;
 
 Arena::Arena()
-    : alloc_ptr_(nullptr), alloc_bytes_remaining_(0), memory_usage_(0) {}
+    : alloc_ptr_(nullptr),
+      alloc_bytes_remaining_(0),
+      memory_usage_(0),
+      unused_memory_(0) {}
 
 Arena::~Arena() {
   for (size_t i = 0; i < blocks_.size(); i++) {
@@ -26,6 +29,7 @@ char* Arena::AllocateFallback(size_t bytes) {
   }
 
   // We waste the remaining space in the current block.
+  unused_memory_.fetch_add(alloc_bytes_remaining_, std::memory_order_relaxed);
   alloc_ptr_ = AllocateNewBlock(kBlockSize);
   alloc_bytes_remaining_ = kBlockSize;
 
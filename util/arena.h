@@ -34,6 +34,13 @@ class Arena {
     return memory_usage_.load(std::memory_order_relaxed);
   }
 
+  // Returns the part of MemoryUsage() left unused at the ends of blocks
+  // the arena has moved on from.  The unused end of the current block, at
+  // most one block, is not included.
+  size_t UnusedMemory() const {
+    return unused_memory_.load(std::memory_order_relaxed);
+  }
+
  private:
   char* AllocateFallback(size_t bytes);
   char* AllocateNewBlock(size_t block_bytes);
@@ -50,6 +57,9 @@ class Arena {
   // TODO(costan): This member is accessed via atomics, but the others are
   //               accessed without any locking. Is this OK?
   std::atomic<size_t> memory_usage_;
+
+  // Bytes wasted at the ends of blocks, updated only when a block is left.
+  std::atomic<size_t> unused_memory_;
 };
 
 inline char* Arena::Allocate(size_t bytes) {
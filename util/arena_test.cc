@@ -11,6 +11,18 @@ namespace leveldb {
 
 TEST(ArenaTest, Empty) { Arena arena; }
 
+TEST(ArenaTest, UnusedMemory) {
+  Arena arena;
+  for (int i = 0; i < 4; i++) {
+    arena.Allocate(1000);
+  }
+  ASSERT_EQ(0, arena.UnusedMemory());
+  arena.Allocate(1000);  // Does not fit in the rest of the first block
+  ASSERT_EQ(4096 - 4000, arena.UnusedMemory());
+  arena.Allocate(2000);  // Large allocations get blocks of their own
+  ASSERT_EQ(4096 - 4000, arena.UnusedMemory());
+}
+
 TEST(ArenaTest, Simple) {
   std::vector<std::pair<size_t, char*>> allocated;
   Arena arena;
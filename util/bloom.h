@@ -0,0 +1,37 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// The probe of the blocked bloom filter, exposed so that the vectorized
+// version can be tested against the portable one.
+
+#ifndef STORAGE_LEVELDB_UTIL_BLOOM_H_
+#define STORAGE_LEVELDB_UTIL_BLOOM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(_M_X64) || defined(__x86_64__)) && \
+    (defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_BLOOM_AVX2 1
+#endif
+
+namespace leveldb {
+namespace bloom {
+
+// Return true if the first "k" probes of hash "h" all find their bit set
+// in the 64-byte "line".  "k" must be at most 16.
+bool BlockedBloomMayMatchPortable(const char* line, uint32_t h, size_t k);
+
+#if defined(LEVELDB_BLOOM_AVX2)
+// Same as BlockedBloomMayMatchPortable().  Only call it if CanUseAvx2().
+bool BlockedBloomMayMatchAvx2(const char* line, uint32_t h, size_t k);
+
+// Return true if the CPU supports AVX2.
+bool CanUseAvx2();
+#endif  // defined(LEVELDB_BLOOM_AVX2)
+
+}  // namespace bloom
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_BLOOM_H_
@@ -4,8 +4,10 @@
 
 #include "gtest/gtest.h"
 #include "leveldb/filter_policy.h"
+#include "util/bloom.h"
 #include "util/coding.h"
 #include "util/logging.h"
+#include "util/random.h"
 #include "util/testutil.h"
 
 namespace leveldb {
@@ -20,6 +22,7 @@ static Slice Key(int i, char* buffer) {
 class BloomTest : public testing::Test {
  public:
   BloomTest() : policy_(NewBloomFilterPolicy(10)) {}
+  explicit BloomTest(const FilterPolicy* policy) : policy_(policy) {}
 
   ~BloomTest() { delete policy_; }
 
@@ -149,6 +152,101 @@ TEST_F(BloomTest, VaryingLengths) {
   ASSERT_LE(mediocre_filters, good_filters / 5);
 }
 
+// Blocked bloom filter
+
+class BlockedBloomTest : public BloomTest {
+ public:
+  BlockedBloomTest() : BloomTest(NewBlockedBloomFilterPolicy(10)) {}
+};
+
+TEST_F(BlockedBloomTest, EmptyFilter) {
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(BlockedBloomTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(BlockedBloomTest, VaryingLengths) {
+  char buffer[sizeof(int)];
+
+  // Count number of filters that significantly exceed the false positive rate
+  int mediocre_filters = 0;
+  int good_filters = 0;
+
+  for (int length = 1; length <= 10000; length = NextLength(length)) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    // Rounded up to whole 64-byte lines, plus the probe count byte
+    ASSERT_LE(FilterSize(), static_cast<size_t>((length * 10 / 8) + 64 + 1))
+        << length;
+    ASSERT_EQ(0, (FilterSize() - 1) % 64) << length;
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+    }
+
+    // Check false positive rate
+    double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      std::fprintf(stderr,
+                   "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+                   rate * 100.0, length, static_cast<int>(FilterSize()));
+    }
+    ASSERT_LE(rate, 0.025);  // Must not be over 2.5%
+    if (rate > 0.0175)
+      mediocre_filters++;  // Allowed, but not too often
+    else
+      good_filters++;
+  }
+  if (kVerbose >= 1) {
+    std::fprintf(stderr, "Filters: %d good, %d mediocre\n", good_filters,
+                 mediocre_filters);
+  }
+  ASSERT_LE(mediocre_filters, good_filters / 5);
+}
+
+#if defined(LEVELDB_BLOOM_AVX2)
+TEST(BlockedBloomProbeTest, Avx2MatchesPortable) {
+  if (!bloom::CanUseAvx2()) {
+    std::fprintf(stderr, "skipping test because the CPU lacks AVX2\n");
+    return;
+  }
+  Random rnd(301);
+  char line[64];
+  for (int iter = 0; iter < 2000; iter++) {
+    // From sparse to dense lines, so that both answers are common.
+    const int density = 1 + iter % 8;
+    for (char& c : line) {
+      c = 0;
+      for (int bit = 0; bit < 8; bit++) {
+        if (rnd.Uniform(8) < density) c |= 1 << bit;
+      }
+    }
+    for (int i = 0; i < 100; i++) {
+      const uint32_t h = rnd.Next() ^ (rnd.Next() << 16);
+      for (size_t k = 1; k <= 16; k++) {
+        ASSERT_EQ(bloom::BlockedBloomMayMatchPortable(line, h, k),
+                  bloom::BlockedBloomMayMatchAvx2(line, h, k))
+            << "iter " << iter << "; h " << h << "; k " << k;
+      }
+    }
+  }
+}
+#endif  // defined(LEVELDB_BLOOM_AVX2)
+
 // Different bits-per-byte
 
 }  // namespace leveldb
@@ -7,6 +7,7 @@
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <thread>
 
 #include "port/port.h"
 #include "port/thread_annotations.h"
@@ -19,6 +20,10 @@ Cache::~Cache() {}
 
 namespace {
 
+// Share of an LRU cache shard's capacity that low priority entries which
+// have been looked up at least once may hold; see LRUCache.
+static const double kHotPoolRatio = 0.5;
+
 // LRU cache implementation
 //
 // Cache entries have an "in_cache" boolean indicating whether the cache has a
@@ -26,14 +31,24 @@ namespace {
 // entry being passed to its "deleter" are via Erase(), via Insert() when
 // an element with a duplicate key is inserted, or on destruction of the cache.
 //
-// The cache keeps two linked lists of items in the cache.  All items in the
-// cache are in one list or the other, and never both.  Items still referenced
-// by clients but erased from the cache are in neither list.  The lists are:
+// The cache keeps four linked lists of items in the cache.  All items in the
+// cache are in exactly one list.  Items still referenced by clients but
+// erased from the cache are in no list.  The lists are:
 // - in-use:  contains the items currently referenced by clients, in no
 //   particular order.  (This list is used for invariant checking.  If we
 //   removed the check, elements that would otherwise be on this list could be
 //   left as disconnected singleton lists.)
-// - LRU:  contains the items not currently referenced by clients, in LRU order
+// - LRU:  contains the low priority items not currently referenced by
+//   clients that have not been looked up since they were inserted, in LRU
+//   order.  Eviction starts here.
+// - hot LRU:  likewise for low priority items that were looked up again
+//   after being inserted.  Its size is capped at kHotPoolRatio of the
+//   capacity; its oldest items overflow into the newest end of the LRU list.
+//   So an item read only once, as by a scan, is evicted before anything in
+//   the hot list (midpoint insertion).
+// - high-priority LRU:  contains the unreferenced high priority items.
+//   These are only evicted to make room for other high priority items, and
+//   only once both other lists are empty.
 // Elements are moved between these lists by the Ref() and Unref() methods,
 // when they detect an element in the cache acquiring or losing its only
 // external reference.
@@ -49,6 +64,9 @@ struct LRUHandle {
   size_t charge;  // TODO(opt): Only allow uint32_t?
   size_t key_length;
   bool in_cache;     // Whether entry is in the cache.
+  bool high_priority;
+  bool hit;          // Whether looked up since it was last moved to lru_.
+  bool in_hot_pool;  // Whether counted in hot_usage_.
   uint32_t refs;     // References, including cache reference, if present.
   uint32_t hash;     // Hash of key(); used for fast sharding and comparisons
   char key_data[1];  // Beginning of key
@@ -155,11 +173,13 @@ class LRUCache {
 
   // Separate from constructor so caller can easily make an array of LRUCache
   void SetCapacity(size_t capacity) { capacity_ = capacity; }
+  void SetStrictCapacityLimit(bool strict) { strict_capacity_limit_ = strict; }
 
   // Like Cache methods, but with an extra "hash" parameter.
   Cache::Handle* Insert(const Slice& key, uint32_t hash, void* value,
                         size_t charge,
-                        void (*deleter)(const Slice& key, void* value));
+                        void (*deleter)(const Slice& key, void* value),
+                        Cache::Priority priority);
   Cache::Handle* Lookup(const Slice& key, uint32_t hash);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
@@ -168,6 +188,8 @@ class LRUCache {
     MutexLock l(&mutex_);
     return usage_;
   }
+  void GetStats(Cache::ShardStats* stats) const;
+  void ApplyToAllEntries(void (*func)(void*, const Slice&, void*), void* arg);
 
  private:
   void LRU_Remove(LRUHandle* e);
@@ -176,18 +198,36 @@ class LRUCache {
   void Unref(LRUHandle* e);
   bool FinishErase(LRUHandle* e) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Evicts the least recently used unreferenced entry that an entry of the
+  // given priority may displace.  Returns false if there is none.
+  bool EvictOne(bool high_priority) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Moves the oldest entries of hot_lru_ to lru_ until the hot pool is
+  // within its share of the capacity.
+  void MaintainHotPool() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Initialized before use.
   size_t capacity_;
+  bool strict_capacity_limit_;
 
   // mutex_ protects the following state.
   mutable port::Mutex mutex_;
   size_t usage_ GUARDED_BY(mutex_);
+  size_t hot_usage_ GUARDED_BY(mutex_);  // Charge of entries in_hot_pool
+  uint64_t hits_ GUARDED_BY(mutex_);
+  uint64_t misses_ GUARDED_BY(mutex_);
 
   // Dummy head of LRU list.
   // lru.prev is newest entry, lru.next is oldest entry.
   // Entries have refs==1 and in_cache==true.
   LRUHandle lru_ GUARDED_BY(mutex_);
 
+  // Dummy head of hot LRU list; same invariants as lru_.
+  LRUHandle hot_lru_ GUARDED_BY(mutex_);
+
+  // Dummy head of high-priority LRU list; same invariants as lru_.
+  LRUHandle high_pri_lru_ GUARDED_BY(mutex_);
+
   // Dummy head of in-use list.
   // Entries are in use by clients, and have refs >= 2 and in_cache==true.
   LRUHandle in_use_ GUARDED_BY(mutex_);
@@ -195,23 +235,36 @@ class LRUCache {
   HandleTable table_ GUARDED_BY(mutex_);
 };
 
-LRUCache::LRUCache() : capacity_(0), usage_(0) {
+LRUCache::LRUCache()
+    : capacity_(0),
+      strict_capacity_limit_(false),
+      usage_(0),
+      hot_usage_(0),
+      hits_(0),
+      misses_(0) {
   // Make empty circular linked lists.
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  hot_lru_.next = &hot_lru_;
+  hot_lru_.prev = &hot_lru_;
+  high_pri_lru_.next = &high_pri_lru_;
+  high_pri_lru_.prev = &high_pri_lru_;
   in_use_.next = &in_use_;
   in_use_.prev = &in_use_;
 }
 
 LRUCache::~LRUCache() {
   assert(in_use_.next == &in_use_);  // Error if caller has an unreleased handle
-  for (LRUHandle* e = lru_.next; e != &lru_;) {
-    LRUHandle* next = e->next;
-    assert(e->in_cache);
-    e->in_cache = false;
-    assert(e->refs == 1);  // Invariant of lru_ list.
-    Unref(e);
-    e = next;
+  LRUHandle* lists[] = {&lru_, &hot_lru_, &high_pri_lru_};
+  for (LRUHandle* list : lists) {
+    for (LRUHandle* e = list->next; e != list;) {
+      LRUHandle* next = e->next;
+      assert(e->in_cache);
+      e->in_cache = false;
+      assert(e->refs == 1);  // Invariant of lru_ lists.
+      Unref(e);
+      e = next;
+    }
   }
 }
 
@@ -231,8 +284,32 @@ void LRUCache::Unref(LRUHandle* e) {
     (*e->deleter)(e->key(), e->value);
     free(e);
   } else if (e->in_cache && e->refs == 1) {
-    // No longer in use; move to lru_ list.
+    // No longer in use; move to its lru_ list.
     LRU_Remove(e);
+    if (e->high_priority) {
+      LRU_Append(&high_pri_lru_, e);
+    } else if (e->in_hot_pool || e->hit) {
+      // Used again since it was inserted; protect it from scans.
+      if (!e->in_hot_pool) {
+        e->in_hot_pool = true;
+        hot_usage_ += e->charge;
+      }
+      LRU_Append(&hot_lru_, e);
+      MaintainHotPool();
+    } else {
+      LRU_Append(&lru_, e);
+    }
+  }
+}
+
+void LRUCache::MaintainHotPool() {
+  const size_t hot_capacity = capacity_ * kHotPoolRatio;
+  while (hot_usage_ > hot_capacity && hot_lru_.next != &hot_lru_) {
+    LRUHandle* e = hot_lru_.next;
+    LRU_Remove(e);
+    e->in_hot_pool = false;
+    e->hit = false;
+    hot_usage_ -= e->charge;
     LRU_Append(&lru_, e);
   }
 }
@@ -255,6 +332,10 @@ Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash) {
   LRUHandle* e = table_.Lookup(key, hash);
   if (e != nullptr) {
     Ref(e);
+    e->hit = true;
+    hits_++;
+  } else {
+    misses_++;
   }
   return reinterpret_cast<Cache::Handle*>(e);
 }
@@ -266,9 +347,21 @@ void LRUCache::Release(Cache::Handle* handle) {
 
 Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
                                 size_t charge,
-                                void (*deleter)(const Slice& key,
-                                                void* value)) {
+                                void (*deleter)(const Slice& key, void* value),
+                                Cache::Priority priority) {
   MutexLock l(&mutex_);
+  const bool high_priority = (priority == Cache::kHighPriority);
+
+  if (strict_capacity_limit_ && capacity_ > 0) {
+    // Make room before adding, and refuse the entry if what is left is
+    // pinned by clients or has higher priority.
+    while (usage_ + charge > capacity_ && EvictOne(high_priority)) {
+      // Keep evicting
+    }
+    if (usage_ + charge > capacity_) {
+      return nullptr;
+    }
+  }
 
   LRUHandle* e =
       reinterpret_cast<LRUHandle*>(malloc(sizeof(LRUHandle) - 1 + key.size()));
@@ -278,6 +371,9 @@ Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
   e->key_length = key.size();
   e->hash = hash;
   e->in_cache = false;
+  e->high_priority = high_priority;
+  e->hit = false;
+  e->in_hot_pool = false;
   e->refs = 1;  // for the returned handle.
   std::memcpy(e->key_data, key.data(), key.size());
 
@@ -291,18 +387,32 @@ Cache::Handle* LRUCache::Insert(const Slice& key, uint32_t hash, void* value,
     // next is read by key() in an assert, so it must be initialized
     e->next = nullptr;
   }
-  while (usage_ > capacity_ && lru_.next != &lru_) {
-    LRUHandle* old = lru_.next;
-    assert(old->refs == 1);
-    bool erased = FinishErase(table_.Remove(old->key(), old->hash));
-    if (!erased) {  // to avoid unused variable when compiled NDEBUG
-      assert(erased);
-    }
+  while (usage_ > capacity_ && EvictOne(high_priority)) {
+    // Keep evicting
   }
 
   return reinterpret_cast<Cache::Handle*>(e);
 }
 
+bool LRUCache::EvictOne(bool high_priority) {
+  LRUHandle* old;
+  if (lru_.next != &lru_) {
+    old = lru_.next;
+  } else if (hot_lru_.next != &hot_lru_) {
+    old = hot_lru_.next;
+  } else if (high_priority && high_pri_lru_.next != &high_pri_lru_) {
+    old = high_pri_lru_.next;
+  } else {
+    return false;
+  }
+  assert(old->refs == 1);
+  bool erased = FinishErase(table_.Remove(old->key(), old->hash));
+  if (!erased) {  // to avoid unused variable when compiled NDEBUG
+    assert(erased);
+  }
+  return true;
+}
+
 // If e != nullptr, finish removing *e from the cache; it has already been
 // removed from the hash table.  Return whether e != nullptr.
 bool LRUCache::FinishErase(LRUHandle* e) {
@@ -311,6 +421,10 @@ bool LRUCache::FinishErase(LRUHandle* e) {
     LRU_Remove(e);
     e->in_cache = false;
     usage_ -= e->charge;
+    if (e->in_hot_pool) {
+      e->in_hot_pool = false;
+      hot_usage_ -= e->charge;
+    }
     Unref(e);
   }
   return e != nullptr;
@@ -323,22 +437,57 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
 
 void LRUCache::Prune() {
   MutexLock l(&mutex_);
-  while (lru_.next != &lru_) {
-    LRUHandle* e = lru_.next;
-    assert(e->refs == 1);
-    bool erased = FinishErase(table_.Remove(e->key(), e->hash));
-    if (!erased) {  // to avoid unused variable when compiled NDEBUG
-      assert(erased);
+  while (EvictOne(true)) {
+    // Keep evicting
+  }
+}
+
+void LRUCache::GetStats(Cache::ShardStats* stats) const {
+  MutexLock l(&mutex_);
+  stats->capacity = capacity_;
+  stats->usage = usage_;
+  stats->pinned_usage = 0;
+  for (const LRUHandle* e = in_use_.next; e != &in_use_; e = e->next) {
+    stats->pinned_usage += e->charge;
+  }
+  stats->hits = hits_;
+  stats->misses = misses_;
+}
+
+void LRUCache::ApplyToAllEntries(void (*func)(void*, const Slice&, void*),
+                                 void* arg) {
+  MutexLock l(&mutex_);
+  const LRUHandle* lists[] = {&in_use_, &high_pri_lru_, &hot_lru_, &lru_};
+  for (const LRUHandle* list : lists) {
+    for (LRUHandle* e = list->next; e != list; e = e->next) {
+      (*func)(arg, e->key(), e->value);
     }
   }
 }
 
 static const int kNumShardBits = 4;
-static const int kNumShards = 1 << kNumShardBits;
+
+// Limits on the number of shards NewLRUCache() picks by itself.
+static const int kMaxDefaultShardBits = 6;
+static const size_t kMinDefaultShardCapacity = 512 * 1024;
+
+// Enough shards for each core to have its own, but none smaller than
+// kMinDefaultShardCapacity.
+static int DefaultShardBits(size_t capacity) {
+  const unsigned cores = std::thread::hardware_concurrency();
+  int bits = 0;
+  while (bits < kMaxDefaultShardBits && (1u << bits) < cores &&
+         (capacity >> (bits + 1)) >= kMinDefaultShardCapacity) {
+    bits++;
+  }
+  return bits;
+}
 
 class ShardedLRUCache : public Cache {
  private:
-  LRUCache shard_[kNumShards];
+  const int num_shard_bits_;
+  const int num_shards_;
+  LRUCache* shard_;
   port::Mutex id_mutex_;
   uint64_t last_id_;
 
@@ -346,20 +495,34 @@ class ShardedLRUCache : public Cache {
     return Hash(s.data(), s.size(), 0);
   }
 
-  static uint32_t Shard(uint32_t hash) { return hash >> (32 - kNumShardBits); }
+  uint32_t Shard(uint32_t hash) const {
+    return num_shard_bits_ > 0 ? hash >> (32 - num_shard_bits_) : 0;
+  }
 
  public:
-  explicit ShardedLRUCache(size_t capacity) : last_id_(0) {
-    const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
-    for (int s = 0; s < kNumShards; s++) {
+  ShardedLRUCache(size_t capacity, int num_shard_bits,
+                  bool strict_capacity_limit)
+      : num_shard_bits_(num_shard_bits),
+        num_shards_(1 << num_shard_bits),
+        shard_(new LRUCache[num_shards_]),
+        last_id_(0) {
+    const size_t per_shard = (capacity + (num_shards_ - 1)) / num_shards_;
+    for (int s = 0; s < num_shards_; s++) {
       shard_[s].SetCapacity(per_shard);
+      shard_[s].SetStrictCapacityLimit(strict_capacity_limit);
     }
   }
-  ~ShardedLRUCache() override {}
+  ~ShardedLRUCache() override { delete[] shard_; }
   Handle* Insert(const Slice& key, void* value, size_t charge,
                  void (*deleter)(const Slice& key, void* value)) override {
+    return InsertWithPriority(key, value, charge, deleter, kLowPriority);
+  }
+  Handle* InsertWithPriority(const Slice& key, void* value, size_t charge,
+                             void (*deleter)(const Slice& key, void* value),
+                             Priority priority) override {
     const uint32_t hash = HashSlice(key);
-    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter,
+                                      priority);
   }
   Handle* Lookup(const Slice& key) override {
     const uint32_t hash = HashSlice(key);
@@ -381,21 +544,45 @@ class ShardedLRUCache : public Cache {
     return ++(last_id_);
   }
   void Prune() override {
-    for (int s = 0; s < kNumShards; s++) {
+    for (int s = 0; s < num_shards_; s++) {
       shard_[s].Prune();
     }
   }
   size_t TotalCharge() const override {
     size_t total = 0;
-    for (int s = 0; s < kNumShards; s++) {
+    for (int s = 0; s < num_shards_; s++) {
       total += shard_[s].TotalCharge();
     }
     return total;
   }
+  int NumShards() const override { return num_shards_; }
+  void GetShardStats(int shard, ShardStats* stats) const override {
+    assert(shard >= 0 && shard < num_shards_);
+    shard_[shard].GetStats(stats);
+  }
+  void ApplyToAllEntries(void (*func)(void* arg, const Slice& key,
+                                      void* value),
+                         void* arg) override {
+    for (int s = 0; s < num_shards_; s++) {
+      shard_[s].ApplyToAllEntries(func, arg);
+    }
+  }
 };
 
 }  // end anonymous namespace
 
-Cache* NewLRUCache(size_t capacity) { return new ShardedLRUCache(capacity); }
+Cache* NewLRUCache(size_t capacity) {
+  return new ShardedLRUCache(capacity, kNumShardBits, false);
+}
+
+Cache* NewLRUCache(size_t capacity, int num_shard_bits,
+                   bool strict_capacity_limit) {
+  if (num_shard_bits < 0) {
+    num_shard_bits = DefaultShardBits(capacity);
+  } else if (num_shard_bits > 20) {
+    num_shard_bits = 20;
+  }
+  return new ShardedLRUCache(capacity, num_shard_bits, strict_capacity_limit);
+}
 
 }  // namespace leveldb
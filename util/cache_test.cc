@@ -4,10 +4,14 @@
 
 #include "leveldb/cache.h"
 
+#include <atomic>
+#include <map>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
 #include "util/coding.h"
+#include "util/random.h"
 
 namespace leveldb {
 
@@ -36,7 +40,9 @@ class CacheTest : public testing::Test {
   std::vector<int> deleted_values_;
   Cache* cache_;
 
-  CacheTest() : cache_(NewLRUCache(kCacheSize)) { current_ = this; }
+  CacheTest() : CacheTest(NewLRUCache(kCacheSize)) {}
+
+  explicit CacheTest(Cache* cache) : cache_(cache) { current_ = this; }
 
   ~CacheTest() { delete cache_; }
 
@@ -60,6 +66,19 @@ class CacheTest : public testing::Test {
   }
 
   void Erase(int key) { cache_->Erase(EncodeKey(key)); }
+
+  // Returns the key -> value pairs visited by ApplyToAllEntries().
+  std::map<int, int> AllEntries() {
+    std::map<int, int> entries;
+    cache_->ApplyToAllEntries(&CacheTest::AddEntry, &entries);
+    return entries;
+  }
+
+  static void AddEntry(void* arg, const Slice& key, void* value) {
+    (*reinterpret_cast<std::map<int, int>*>(arg))[DecodeKey(key)] =
+        DecodeValue(value);
+  }
+
   static CacheTest* current_;
 };
 CacheTest* CacheTest::current_;
@@ -150,6 +169,47 @@ TEST_F(CacheTest, EvictionPolicy) {
   cache_->Release(h);
 }
 
+TEST_F(CacheTest, ScanResistance) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0, false);
+
+  // A working set read more than once ...
+  for (int i = 0; i < 20; i++) {
+    Insert(i, 100 + i, 10);
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+
+  // ... survives a scan over many times the capacity ...
+  for (int i = 0; i < 10 * kCacheSize; i++) {
+    Insert(1000 + i, 2000 + i, 10);
+  }
+  for (int i = 0; i < 20; i++) {
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+  ASSERT_EQ(-1, Lookup(1000));
+
+  // ... and the most recent part of the scan is still cached.
+  ASSERT_EQ(2000 + 10 * kCacheSize - 1, Lookup(1000 + 10 * kCacheSize - 1));
+  ASSERT_LE(cache_->TotalCharge(), static_cast<size_t>(kCacheSize));
+}
+
+TEST_F(CacheTest, HotPoolOverflow) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0, false);
+
+  // Entries read twice beyond the hot pool's share are demoted, oldest
+  // first, and then evicted like any other.
+  for (int i = 0; i < 100; i++) {
+    Insert(i, 100 + i, 10);
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+  for (int i = 0; i < 10 * kCacheSize; i++) {
+    Insert(1000 + i, 2000 + i, 10);
+  }
+  ASSERT_EQ(-1, Lookup(0));
+  ASSERT_EQ(199, Lookup(99));
+}
+
 TEST_F(CacheTest, UseExceedsCacheSize) {
   // Overfill the cache, keeping handles on all inserted entries.
   std::vector<Cache::Handle*> h;
@@ -213,6 +273,19 @@ TEST_F(CacheTest, Prune) {
   ASSERT_EQ(-1, Lookup(2));
 }
 
+TEST_F(CacheTest, ApplyToAllEntries) {
+  Insert(1, 100);
+  Insert(2, 200);
+  Insert(3, 300);
+  Erase(2);
+  Cache::Handle* handle = InsertAndReturnHandle(4, 400);
+  ASSERT_EQ(100, Lookup(1));  // Moves 1 to the hot pool
+
+  std::map<int, int> expected = {{1, 100}, {3, 300}, {4, 400}};
+  ASSERT_EQ(expected, AllEntries());
+  cache_->Release(handle);
+}
+
 TEST_F(CacheTest, ZeroSizeCache) {
   delete cache_;
   cache_ = NewLRUCache(0);
@@ -221,6 +294,342 @@ TEST_F(CacheTest, ZeroSizeCache) {
   ASSERT_EQ(-1, Lookup(1));
 }
 
+TEST_F(CacheTest, StrictCapacityLimit) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0, true);
+
+  // Pin the whole capacity.
+  std::vector<Cache::Handle*> h;
+  for (int i = 0; i < kCacheSize / 10; i++) {
+    h.push_back(InsertAndReturnHandle(i, 1000 + i, 10));
+    ASSERT_TRUE(h.back() != nullptr);
+  }
+  ASSERT_EQ(static_cast<size_t>(kCacheSize), cache_->TotalCharge());
+
+  // Nothing can be evicted, so the insert is refused.
+  ASSERT_TRUE(InsertAndReturnHandle(5000, 6000, 1) == nullptr);
+  ASSERT_EQ(-1, Lookup(5000));
+  ASSERT_EQ(0, deleted_keys_.size());
+  ASSERT_EQ(static_cast<size_t>(kCacheSize), cache_->TotalCharge());
+
+  // Once an entry is unpinned it gives way to the new one.
+  cache_->Release(h[0]);
+  Insert(5000, 6000, 1);
+  ASSERT_EQ(6000, Lookup(5000));
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(0, deleted_keys_[0]);
+  ASSERT_LE(cache_->TotalCharge(), static_cast<size_t>(kCacheSize));
+
+  for (int i = 1; i < h.size(); i++) {
+    cache_->Release(h[i]);
+  }
+}
+
+TEST_F(CacheTest, ShardStats) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 2, false);
+  ASSERT_EQ(4, cache_->NumShards());
+
+  Insert(1, 101, 5);
+  Insert(2, 102, 7);
+  Cache::Handle* h = cache_->Lookup(EncodeKey(1));
+  ASSERT_EQ(-1, Lookup(3));
+  ASSERT_EQ(-1, Lookup(4));
+
+  Cache::ShardStats total;
+  for (int s = 0; s < cache_->NumShards(); s++) {
+    Cache::ShardStats stats;
+    cache_->GetShardStats(s, &stats);
+    ASSERT_EQ(kCacheSize / 4, stats.capacity);
+    total.usage += stats.usage;
+    total.pinned_usage += stats.pinned_usage;
+    total.hits += stats.hits;
+    total.misses += stats.misses;
+  }
+  ASSERT_EQ(12, total.usage);
+  ASSERT_EQ(5, total.pinned_usage);
+  ASSERT_EQ(1, total.hits);
+  ASSERT_EQ(2, total.misses);
+  cache_->Release(h);
+}
+
+TEST_F(CacheTest, DefaultShardCount) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, -1, false);
+  ASSERT_EQ(1, cache_->NumShards());  // Too small to split
+
+  delete cache_;
+  cache_ = NewLRUCache(size_t{1} << 30, -1, false);
+  const int shards = cache_->NumShards();
+  ASSERT_GE(shards, 1);
+  ASSERT_LE(shards, 64);
+  ASSERT_EQ(0, shards & (shards - 1));
+
+  Insert(1, 101);
+  ASSERT_EQ(101, Lookup(1));
+}
+
+TEST_F(CacheTest, HighPriorityEntries) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0, false);
+
+  for (int i = 0; i < 10; i++) {
+    cache_->Release(cache_->InsertWithPriority(EncodeKey(i), EncodeValue(i),
+                                              50, &CacheTest::Deleter,
+                                              Cache::kHighPriority));
+  }
+
+  // Low priority entries only displace each other.
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(1000 + i, 2000 + i, 10);
+    ASSERT_EQ(2000 + i, Lookup(1000 + i));
+  }
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(i, Lookup(i));
+  }
+  ASSERT_LE(cache_->TotalCharge(), static_cast<size_t>(kCacheSize));
+
+  // High priority entries displace low priority ones first.
+  cache_->Release(cache_->InsertWithPriority(EncodeKey(20), EncodeValue(20),
+                                            kCacheSize / 2,
+                                            &CacheTest::Deleter,
+                                            Cache::kHighPriority));
+  ASSERT_EQ(20, Lookup(20));
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(i, Lookup(i));
+  }
+  for (int i = 2 * kCacheSize - 50; i < 2 * kCacheSize; i++) {
+    ASSERT_EQ(-1, Lookup(1000 + i));
+  }
+
+  // And each other, least recently used first, only when nothing else
+  // is left.
+  cache_->Release(cache_->InsertWithPriority(EncodeKey(21), EncodeValue(21),
+                                            kCacheSize / 4,
+                                            &CacheTest::Deleter,
+                                            Cache::kHighPriority));
+  ASSERT_EQ(21, Lookup(21));
+  ASSERT_EQ(-1, Lookup(20));
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(i, Lookup(i));
+  }
+}
+
+class ClockCacheTest : public CacheTest {
+ public:
+  ClockCacheTest() : CacheTest(NewClockCache(kCacheSize, 1)) {}
+};
+
+TEST_F(ClockCacheTest, HitAndMiss) {
+  ASSERT_EQ(-1, Lookup(100));
+
+  Insert(100, 101);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+
+  Insert(200, 201);
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(201, Lookup(200));
+
+  Insert(100, 102);
+  ASSERT_EQ(102, Lookup(100));
+  ASSERT_EQ(201, Lookup(200));
+
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(100, deleted_keys_[0]);
+  ASSERT_EQ(101, deleted_values_[0]);
+}
+
+TEST_F(ClockCacheTest, Erase) {
+  Erase(200);
+  ASSERT_EQ(0, deleted_keys_.size());
+
+  Insert(100, 101);
+  Insert(200, 201);
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(201, Lookup(200));
+  ASSERT_EQ(1, deleted_keys_.size());
+
+  Erase(100);
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(1, cache_->TotalCharge());
+}
+
+TEST_F(ClockCacheTest, EntriesArePinned) {
+  Insert(100, 101);
+  Cache::Handle* h1 = cache_->Lookup(EncodeKey(100));
+  ASSERT_EQ(101, DecodeValue(cache_->Value(h1)));
+
+  Insert(100, 102);
+  Cache::Handle* h2 = cache_->Lookup(EncodeKey(100));
+  ASSERT_EQ(102, DecodeValue(cache_->Value(h2)));
+  ASSERT_EQ(0, deleted_keys_.size());
+
+  cache_->Release(h1);
+  ASSERT_EQ(1, deleted_keys_.size());
+  ASSERT_EQ(101, deleted_values_[0]);
+
+  Erase(100);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(1, deleted_keys_.size());
+
+  cache_->Release(h2);
+  ASSERT_EQ(2, deleted_keys_.size());
+  ASSERT_EQ(102, deleted_values_[1]);
+}
+
+TEST_F(ClockCacheTest, EvictionPolicy) {
+  Insert(100, 101);
+  Insert(200, 201);
+  Insert(300, 301);
+  Cache::Handle* h = cache_->Lookup(EncodeKey(300));
+
+  // Frequently used entry must be kept around,
+  // as must things that are still in use.
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    Insert(1000 + i, 2000 + i);
+    ASSERT_EQ(2000 + i, Lookup(1000 + i));
+    ASSERT_EQ(101, Lookup(100));
+  }
+  ASSERT_EQ(101, Lookup(100));
+  ASSERT_EQ(-1, Lookup(200));
+  ASSERT_EQ(301, Lookup(300));
+  cache_->Release(h);
+}
+
+TEST_F(ClockCacheTest, UseExceedsCacheSize) {
+  // Overfill the cache, keeping handles on all inserted entries.
+  std::vector<Cache::Handle*> h;
+  for (int i = 0; i < kCacheSize + 100; i++) {
+    h.push_back(InsertAndReturnHandle(1000 + i, 2000 + i));
+  }
+
+  // Check that all the entries can be found in the cache.
+  for (int i = 0; i < h.size(); i++) {
+    ASSERT_EQ(2000 + i, Lookup(1000 + i));
+  }
+
+  for (int i = 0; i < h.size(); i++) {
+    cache_->Release(h[i]);
+  }
+}
+
+TEST_F(ClockCacheTest, HeavyEntries) {
+  const int kLight = 1;
+  const int kHeavy = 10;
+  int added = 0;
+  int index = 0;
+  while (added < 2 * kCacheSize) {
+    const int weight = (index & 1) ? kLight : kHeavy;
+    Insert(index, 1000 + index, weight);
+    added += weight;
+    index++;
+  }
+
+  int cached_weight = 0;
+  for (int i = 0; i < index; i++) {
+    const int weight = (i & 1 ? kLight : kHeavy);
+    int r = Lookup(i);
+    if (r >= 0) {
+      cached_weight += weight;
+      ASSERT_EQ(1000 + i, r);
+    }
+  }
+  ASSERT_LE(cached_weight, kCacheSize + kCacheSize / 10);
+  ASSERT_EQ(cached_weight, cache_->TotalCharge());
+}
+
+TEST_F(ClockCacheTest, SmallEntriesBoundedBySlots) {
+  // Entries far smaller than estimated are evicted once the tables fill,
+  // even though their total charge is below capacity.
+  delete cache_;
+  cache_ = NewClockCache(kCacheSize, 100);
+  for (int i = 0; i < kCacheSize; i++) {
+    Insert(i, 1000 + i);
+  }
+  ASSERT_LT(cache_->TotalCharge(), kCacheSize / 2);
+  ASSERT_EQ(1000 + kCacheSize - 1, Lookup(kCacheSize - 1));
+}
+
+TEST_F(ClockCacheTest, Prune) {
+  Insert(1, 100);
+  Insert(2, 200);
+
+  Cache::Handle* handle = cache_->Lookup(EncodeKey(1));
+  ASSERT_TRUE(handle);
+  cache_->Prune();
+  cache_->Release(handle);
+
+  ASSERT_EQ(100, Lookup(1));
+  ASSERT_EQ(-1, Lookup(2));
+}
+
+TEST_F(ClockCacheTest, ApplyToAllEntries) {
+  Insert(1, 100);
+  Insert(2, 200);
+  Insert(3, 300);
+  Erase(2);
+  Cache::Handle* handle = InsertAndReturnHandle(4, 400);
+
+  std::map<int, int> expected = {{1, 100}, {3, 300}, {4, 400}};
+  ASSERT_EQ(expected, AllEntries());
+  cache_->Release(handle);
+}
+
+TEST_F(ClockCacheTest, ZeroSizeCache) {
+  delete cache_;
+  cache_ = NewClockCache(0, 1);
+
+  Insert(1, 100);
+  ASSERT_EQ(-1, Lookup(1));
+  ASSERT_EQ(1, deleted_keys_.size());
+}
+
+static std::atomic<int> concurrent_deletes{0};
+
+static void CountingDeleter(const Slice& key, void* v) {
+  ASSERT_EQ(DecodeKey(key), DecodeValue(v));
+  concurrent_deletes.fetch_add(1);
+}
+
+TEST_F(ClockCacheTest, ConcurrentLookupsAndInserts) {
+  // Values equal keys, so every hit can be checked; the cache is small
+  // enough that entries are continually evicted and erased under readers.
+  const int kThreads = 8;
+  const int kKeys = 2000;
+  const int kOps = 100000;
+  Cache* cache = NewClockCache(512, 1);
+  std::atomic<int> inserts{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([cache, t, &inserts]() {
+      Random rnd(301 + t);
+      for (int i = 0; i < kOps; i++) {
+        const int k = rnd.Uniform(kKeys);
+        const std::string key = EncodeKey(k);
+        Cache::Handle* h = cache->Lookup(key);
+        if (h != nullptr) {
+          ASSERT_EQ(k, DecodeValue(cache->Value(h)));
+          cache->Release(h);
+        } else if (rnd.OneIn(8)) {
+          cache->Erase(key);
+        } else {
+          cache->Release(
+              cache->Insert(key, EncodeValue(k), 1, &CountingDeleter));
+          inserts.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_LE(cache->TotalCharge(), 512);
+  delete cache;
+  ASSERT_EQ(inserts.load(), concurrent_deletes.load());
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
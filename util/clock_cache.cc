@@ -0,0 +1,472 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// CLOCK cache implementation
+//
+// Each shard keeps its entries in a fixed open-addressed hash table whose
+// slots are never freed while the cache lives, so any thread may touch the
+// metadata of any slot at any time.  A slot's metadata is a single atomic
+// word holding its state, a CLOCK countdown and a reference count:
+//
+//   state   : 2 bits  kEmpty, kConstruction, kVisible or kInvisible
+//   clock   : 2 bits  decremented by the sweeping hand, reset on a hit
+//   refs    : 30 bits handles held by clients
+//
+// Lookup() takes no lock.  It optimistically adds a reference to each
+// visible slot on the key's probe sequence and keeps it only if the slot is
+// still visible and holds the key; a hit writes nothing else except to
+// refresh the CLOCK countdown.  Insert(), Erase() and eviction take the
+// shard mutex, which serializes all changes to which slots are visible.
+// Whoever drops the last reference of an erased (kInvisible) entry frees
+// it, without the mutex.
+//
+// Every state change is made by atomic add or by compare-and-swap on the
+// whole word, so references that a racing Lookup() adds and then drops
+// again are never lost.  A slot moves to kConstruction while it is being
+// filled or freed; nobody reads its key or value in that state.
+//
+// Each slot also counts the entries whose probe sequence passes over it
+// ("displacements"), so a miss stops at the first slot with no entry and
+// no displacements instead of scanning the whole table.
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "leveldb/cache.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+namespace {
+
+static const uint64_t kOneRef = 1;
+static const uint64_t kRefsMask = (uint64_t{1} << 30) - 1;
+
+static const int kClockShift = 30;
+static const uint64_t kOneClock = uint64_t{1} << kClockShift;
+static const uint64_t kClockMask = uint64_t{3} << kClockShift;
+
+static const int kStateShift = 62;
+static const uint64_t kOneState = uint64_t{1} << kStateShift;
+static const uint64_t kStateMask = uint64_t{3} << kStateShift;
+enum SlotState : uint64_t {
+  kEmpty = 0,
+  kConstruction = 1,
+  kVisible = 2,
+  kInvisible = 3,
+};
+
+static inline uint64_t StateOf(uint64_t meta) { return meta >> kStateShift; }
+static inline uint64_t RefsOf(uint64_t meta) { return meta & kRefsMask; }
+
+// Fraction of a shard's slots expected to be in use at capacity, and the
+// fraction beyond which Insert() evicts even if below capacity.
+static const double kLoadFactor = 0.7;
+static const double kMaxLoadFactor = 0.9;
+
+struct ClockHandle {
+  std::atomic<uint64_t> meta;
+  std::atomic<uint32_t> displacements;
+  uint32_t hash;
+  bool detached;  // Not in any table; see ClockCacheShard::Insert
+  void* value;
+  void (*deleter)(const Slice&, void* value);
+  size_t charge;
+  size_t key_length;
+  char* key_data;
+
+  ClockHandle() : meta(0), displacements(0), detached(false) {}
+
+  Slice key() const { return Slice(key_data, key_length); }
+};
+
+// Calls the deleter of "h" and releases its key.
+static void FreeContents(ClockHandle* h) {
+  (*h->deleter)(h->key(), h->value);
+  delete[] h->key_data;
+}
+
+// A single shard of sharded cache.
+class ClockCacheShard {
+ public:
+  ClockCacheShard();
+  ~ClockCacheShard();
+
+  // Separate from constructor so caller can easily make an array of shards
+  void Init(size_t capacity, size_t estimated_entries);
+
+  // Like Cache methods, but with an extra "hash" parameter.
+  Cache::Handle* Insert(const Slice& key, uint32_t hash, void* value,
+                        size_t charge,
+                        void (*deleter)(const Slice& key, void* value));
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash);
+  void Release(Cache::Handle* handle);
+  void Erase(const Slice& key, uint32_t hash);
+  void Prune();
+  size_t TotalCharge() const {
+    return usage_.load(std::memory_order_relaxed);
+  }
+  void ApplyToAllEntries(void (*func)(void*, const Slice&, void*), void* arg);
+
+ private:
+  // Index of the i-th slot on the probe sequence of "hash".  The step is
+  // odd and the table size a power of two, so the sequence covers every
+  // slot once.
+  size_t ProbeSlot(uint32_t hash, size_t i) const {
+    const uint32_t step = ((hash >> 11) | (hash << 21)) | 1;
+    return (hash + i * step) & mask_;
+  }
+
+  // Returns the visible entry for key, or nullptr.
+  ClockHandle* FindLocked(const Slice& key, uint32_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Removes a visible entry from the cache; it is freed once unreferenced.
+  void EraseLocked(ClockHandle* h) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Sweeps the clock hand until "charge" more fits, or until every
+  // unreferenced entry has had its chance.
+  void EvictLocked(size_t charge) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void Unref(ClockHandle* h);
+
+  // Frees "h" if it is unreferenced and in "state".  Returns true if this
+  // call freed it.
+  bool TryFree(ClockHandle* h, uint64_t state);
+
+  // Initialized before use.
+  size_t capacity_;
+  size_t mask_;
+  size_t max_occupancy_;
+  ClockHandle* slots_;
+
+  std::atomic<size_t> usage_;      // Charge of visible entries
+  std::atomic<size_t> occupancy_;  // Slots not kEmpty
+
+  port::Mutex mutex_;
+  size_t clock_hand_ GUARDED_BY(mutex_);
+};
+
+ClockCacheShard::ClockCacheShard()
+    : capacity_(0),
+      mask_(0),
+      max_occupancy_(0),
+      slots_(nullptr),
+      usage_(0),
+      occupancy_(0),
+      clock_hand_(0) {}
+
+ClockCacheShard::~ClockCacheShard() {
+  for (size_t i = 0; slots_ != nullptr && i <= mask_; i++) {
+    ClockHandle* h = &slots_[i];
+    // Error if caller has an unreleased handle
+    assert(RefsOf(h->meta.load(std::memory_order_relaxed)) == 0);
+    TryFree(h, kVisible);
+  }
+  delete[] slots_;
+}
+
+void ClockCacheShard::Init(size_t capacity, size_t estimated_entries) {
+  capacity_ = capacity;
+  size_t length = 4;
+  while (length * kLoadFactor < estimated_entries) {
+    length *= 2;
+  }
+  mask_ = length - 1;
+  max_occupancy_ = static_cast<size_t>(length * kMaxLoadFactor);
+  slots_ = new ClockHandle[length];
+}
+
+Cache::Handle* ClockCacheShard::Lookup(const Slice& key, uint32_t hash) {
+  for (size_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &slots_[ProbeSlot(hash, i)];
+    if (StateOf(h->meta.load(std::memory_order_relaxed)) == kVisible) {
+      const uint64_t meta = h->meta.fetch_add(kOneRef, std::memory_order_acquire);
+      if (StateOf(meta) == kVisible && h->hash == hash && h->key() == key) {
+        if ((meta & kClockMask) != kClockMask) {
+          h->meta.fetch_or(kClockMask, std::memory_order_relaxed);
+        }
+        return reinterpret_cast<Cache::Handle*>(h);
+      }
+      Unref(h);
+    }
+    if (h->displacements.load(std::memory_order_acquire) == 0) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+void ClockCacheShard::Release(Cache::Handle* handle) {
+  Unref(reinterpret_cast<ClockHandle*>(handle));
+}
+
+void ClockCacheShard::Unref(ClockHandle* h) {
+  const uint64_t meta = h->meta.fetch_sub(kOneRef, std::memory_order_acq_rel);
+  assert(RefsOf(meta) > 0);
+  if (RefsOf(meta) == 1 && StateOf(meta) == kInvisible) {
+    TryFree(h, kInvisible);
+  }
+}
+
+bool ClockCacheShard::TryFree(ClockHandle* h, uint64_t state) {
+  uint64_t meta = h->meta.load(std::memory_order_relaxed);
+  for (;;) {
+    if (StateOf(meta) != state || RefsOf(meta) != 0) {
+      return false;
+    }
+    // Clear the clock; keep any references racing lookups are about to drop
+    const uint64_t desired =
+        (meta & kRefsMask) | (uint64_t{kConstruction} << kStateShift);
+    if (h->meta.compare_exchange_weak(meta, desired,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  if (state == kVisible) {
+    usage_.fetch_sub(h->charge, std::memory_order_relaxed);
+  }
+  FreeContents(h);
+
+  // Undo the displacements Insert() added along the probe sequence
+  const size_t index = h - slots_;
+  for (size_t i = 0;; i++) {
+    const size_t slot = ProbeSlot(h->hash, i);
+    if (slot == index) break;
+    slots_[slot].displacements.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  occupancy_.fetch_sub(1, std::memory_order_relaxed);
+  h->meta.fetch_sub(kOneState, std::memory_order_release);  // to kEmpty
+  return true;
+}
+
+ClockHandle* ClockCacheShard::FindLocked(const Slice& key, uint32_t hash) {
+  // Only holders of mutex_ make entries visible or invisible, so the fields
+  // of a visible entry are stable here without taking a reference.
+  for (size_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &slots_[ProbeSlot(hash, i)];
+    if (StateOf(h->meta.load(std::memory_order_acquire)) == kVisible &&
+        h->hash == hash && h->key() == key) {
+      return h;
+    }
+    if (h->displacements.load(std::memory_order_relaxed) == 0) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+void ClockCacheShard::EraseLocked(ClockHandle* h) {
+  usage_.fetch_sub(h->charge, std::memory_order_relaxed);
+  const uint64_t meta = h->meta.fetch_add(kOneState, std::memory_order_acq_rel);
+  assert(StateOf(meta) == kVisible);
+  if (RefsOf(meta) == 0) {
+    TryFree(h, kInvisible);
+  }
+}
+
+void ClockCacheShard::EvictLocked(size_t charge) {
+  // Each unreferenced entry is passed over at most once per clock value
+  const size_t max_steps = (mask_ + 1) * 4;
+  for (size_t step = 0; step < max_steps; step++) {
+    if (usage_.load(std::memory_order_relaxed) + charge <= capacity_ &&
+        occupancy_.load(std::memory_order_relaxed) < max_occupancy_) {
+      break;
+    }
+    ClockHandle* h = &slots_[clock_hand_++ & mask_];
+    uint64_t meta = h->meta.load(std::memory_order_relaxed);
+    if (StateOf(meta) != kVisible || RefsOf(meta) != 0) {
+      continue;
+    }
+    if ((meta & kClockMask) != 0) {
+      // Losing this race to a lookup only leaves the entry hotter
+      h->meta.compare_exchange_strong(meta, meta - kOneClock,
+                                      std::memory_order_relaxed);
+      continue;
+    }
+    TryFree(h, kVisible);
+  }
+}
+
+Cache::Handle* ClockCacheShard::Insert(const Slice& key, uint32_t hash,
+                                       void* value, size_t charge,
+                                       void (*deleter)(const Slice& key,
+                                                       void* value)) {
+  char* key_data = new char[key.size()];
+  std::memcpy(key_data, key.data(), key.size());
+
+  MutexLock l(&mutex_);
+  ClockHandle* e = nullptr;
+  if (capacity_ > 0) {
+    EvictLocked(charge);
+    for (size_t i = 0; i <= mask_; i++) {
+      ClockHandle* h = &slots_[ProbeSlot(hash, i)];
+      uint64_t meta = h->meta.load(std::memory_order_relaxed);
+      while (StateOf(meta) == kEmpty) {
+        if (h->meta.compare_exchange_weak(meta, meta + kOneState,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+          e = h;
+          break;
+        }
+      }
+      if (e != nullptr) {
+        break;
+      }
+      h->displacements.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (e == nullptr) {
+      // Every slot is pinned or being freed; undo the displacements
+      for (size_t i = 0; i <= mask_; i++) {
+        slots_[ProbeSlot(hash, i)].displacements.fetch_sub(
+            1, std::memory_order_relaxed);
+      }
+    }
+  }
+  if (e == nullptr) {
+    // Don't cache; the handle is freed on Release()
+    e = new ClockHandle;
+    e->detached = true;
+  }
+
+  e->hash = hash;
+  e->value = value;
+  e->deleter = deleter;
+  e->charge = charge;
+  e->key_length = key.size();
+  e->key_data = key_data;
+
+  if (e->detached) {
+    e->meta.store(kOneRef, std::memory_order_relaxed);
+    return reinterpret_cast<Cache::Handle*>(e);
+  }
+
+  ClockHandle* old = FindLocked(key, hash);
+  occupancy_.fetch_add(1, std::memory_order_relaxed);
+  usage_.fetch_add(charge, std::memory_order_relaxed);
+  // kConstruction -> kVisible, with the returned handle's reference and one
+  // clock tick so a new entry survives the next sweep only if it is used.
+  e->meta.fetch_add(kOneState + kOneClock + kOneRef, std::memory_order_release);
+  if (old != nullptr) {
+    EraseLocked(old);
+  }
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+void ClockCacheShard::Erase(const Slice& key, uint32_t hash) {
+  MutexLock l(&mutex_);
+  ClockHandle* h = FindLocked(key, hash);
+  if (h != nullptr) {
+    EraseLocked(h);
+  }
+}
+
+void ClockCacheShard::Prune() {
+  MutexLock l(&mutex_);
+  for (size_t i = 0; i <= mask_; i++) {
+    TryFree(&slots_[i], kVisible);
+  }
+}
+
+void ClockCacheShard::ApplyToAllEntries(
+    void (*func)(void*, const Slice&, void*), void* arg) {
+  // Visible entries only stop being visible under the mutex.
+  MutexLock l(&mutex_);
+  for (size_t i = 0; i <= mask_; i++) {
+    ClockHandle* h = &slots_[i];
+    if (StateOf(h->meta.load(std::memory_order_acquire)) == kVisible) {
+      (*func)(arg, h->key(), h->value);
+    }
+  }
+}
+
+static const int kNumShardBits = 4;
+static const int kNumShards = 1 << kNumShardBits;
+
+class ShardedClockCache : public Cache {
+ private:
+  ClockCacheShard shard_[kNumShards];
+  std::atomic<uint64_t> last_id_;
+
+  static inline uint32_t HashSlice(const Slice& s) {
+    return Hash(s.data(), s.size(), 0);
+  }
+
+  static uint32_t Shard(uint32_t hash) { return hash >> (32 - kNumShardBits); }
+
+ public:
+  ShardedClockCache(size_t capacity, size_t estimated_entry_charge)
+      : last_id_(0) {
+    const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
+    if (estimated_entry_charge == 0) estimated_entry_charge = 1;
+    const size_t entries_per_shard = per_shard / estimated_entry_charge + 1;
+    for (int s = 0; s < kNumShards; s++) {
+      shard_[s].Init(per_shard, capacity > 0 ? entries_per_shard : 0);
+    }
+  }
+  ~ShardedClockCache() override {}
+  Handle* Insert(const Slice& key, void* value, size_t charge,
+                 void (*deleter)(const Slice& key, void* value)) override {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Insert(key, hash, value, charge, deleter);
+  }
+  Handle* Lookup(const Slice& key) override {
+    const uint32_t hash = HashSlice(key);
+    return shard_[Shard(hash)].Lookup(key, hash);
+  }
+  void Release(Handle* handle) override {
+    ClockHandle* h = reinterpret_cast<ClockHandle*>(handle);
+    if (h->detached) {
+      FreeContents(h);
+      delete h;
+    } else {
+      shard_[Shard(h->hash)].Release(handle);
+    }
+  }
+  void Erase(const Slice& key) override {
+    const uint32_t hash = HashSlice(key);
+    shard_[Shard(hash)].Erase(key, hash);
+  }
+  void* Value(Handle* handle) override {
+    return reinterpret_cast<ClockHandle*>(handle)->value;
+  }
+  uint64_t NewId() override {
+    return last_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  void Prune() override {
+    for (int s = 0; s < kNumShards; s++) {
+      shard_[s].Prune();
+    }
+  }
+  size_t TotalCharge() const override {
+    size_t total = 0;
+    for (int s = 0; s < kNumShards; s++) {
+      total += shard_[s].TotalCharge();
+    }
+    return total;
+  }
+  void ApplyToAllEntries(void (*func)(void* arg, const Slice& key,
+                                      void* value),
+                         void* arg) override {
+    for (int s = 0; s < kNumShards; s++) {
+      shard_[s].ApplyToAllEntries(func, arg);
+    }
+  }
+};
+
+}  // end anonymous namespace
+
+Cache* NewClockCache(size_t capacity, size_t estimated_entry_charge) {
+  return new ShardedClockCache(capacity, estimated_entry_charge);
+}
+
+}  // namespace leveldb
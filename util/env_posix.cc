@@ -12,6 +12,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cerrno>
 #include <cstddef>
@@ -195,6 +196,16 @@ class PosixRandomAccessFile final : public RandomAccessFile {
     return status;
   }
 
+  void Prefetch(uint64_t offset, size_t n) const override {
+#if defined(POSIX_FADV_WILLNEED)
+    // Files opened on every read are not worth an extra open() for a hint.
+    if (has_permanent_fd_) {
+      ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(n),
+                      POSIX_FADV_WILLNEED);
+    }
+#endif  // defined(POSIX_FADV_WILLNEED)
+  }
+
  private:
   const bool has_permanent_fd_;  // If false, the file is opened on every read.
   const int fd_;                 // -1 if has_permanent_fd_ is false.
@@ -239,6 +250,19 @@ class PosixMmapReadableFile final : public RandomAccessFile {
     return Status::OK();
   }
 
+  void Prefetch(uint64_t offset, size_t n) const override {
+#if defined(MADV_WILLNEED)
+    if (offset >= length_) {
+      return;
+    }
+    n = std::min<uint64_t>(n, length_ - offset);
+    // madvise() requires a page-aligned start.
+    static const uint64_t kPageSize = ::sysconf(_SC_PAGESIZE);
+    const uint64_t start = offset - offset % kPageSize;
+    ::madvise(mmap_base_ + start, offset + n - start, MADV_WILLNEED);
+#endif  // defined(MADV_WILLNEED)
+  }
+
  private:
   char* const mmap_base_;
   const size_t length_;
@@ -625,6 +649,13 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  Status LinkFile(const std::string& from, const std::string& to) override {
+    if (::link(from.c_str(), to.c_str()) != 0) {
+      return PosixError(from, errno);
+    }
+    return Status::OK();
+  }
+
   Status LockFile(const std::string& filename, FileLock** lock) override {
     *lock = nullptr;
 
@@ -232,6 +232,26 @@ TEST_F(EnvTest, ReopenAppendableFile) {
   env_->RemoveFile(test_file_name);
 }
 
+TEST_F(EnvTest, LinkFile) {
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file_name = test_dir + "/link_file_src.txt";
+  std::string link_file_name = test_dir + "/link_file_dst.txt";
+  env_->RemoveFile(test_file_name);
+  env_->RemoveFile(link_file_name);
+
+  ASSERT_LEVELDB_OK(WriteStringToFile(env_, "hello", test_file_name));
+  ASSERT_LEVELDB_OK(env_->LinkFile(test_file_name, link_file_name));
+  ASSERT_TRUE(!env_->LinkFile(test_file_name, link_file_name).ok());
+
+  // The link outlives the original name.
+  ASSERT_LEVELDB_OK(env_->RemoveFile(test_file_name));
+  std::string data;
+  ASSERT_LEVELDB_OK(ReadFileToString(env_, link_file_name, &data));
+  ASSERT_EQ(std::string("hello"), data);
+  env_->RemoveFile(link_file_name);
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -591,6 +591,15 @@ class WindowsEnv : public Env {
     }
   }
 
+  Status LinkFile(const std::string& from, const std::string& to) override {
+    WCHAR wbuf1[MAX_PATH], wbuf2[MAX_PATH];
+    if (!::CreateHardLinkW(Utf8_Wchar(to, wbuf1), Utf8_Wchar(from, wbuf2),
+                           /*lpSecurityAttributes=*/nullptr)) {
+      return WindowsError(from, ::GetLastError());
+    }
+    return Status::OK();
+  }
+
   Status LockFile(const std::string& filename, FileLock** lock) override {
     *lock = nullptr;
     Status result;
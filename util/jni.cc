@@ -12,9 +12,17 @@
 #define _fseeki64 fseek
 #endif
 
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
 #include <sstream>
+#include <vector>
 #include <jni.h>
+#include "leveldb/backup_engine.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/options.h"
@@ -22,6 +30,8 @@
 #include "leveldb/write_batch.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/iterator.h"
+#include "leveldb/persistent_cache.h"
+#include "leveldb/write_buffer_manager.h"
 #include "port/port.h"
 #include "db/db_impl.h"
 #include "db/filename.h"
@@ -29,6 +39,7 @@
 #include "db/write_batch_internal.h"
 #include "table/format.h"
 #include "util/coding.h"
+#include "util/mutexlock.h"
 
 #define DEF_JAVA(F) Java_jane_core_StorageLevelDB_ ## F
 
@@ -48,7 +59,10 @@ static const size_t FILE_BUF_SIZE       = 1 << 16;
 static const ReadOptions    g_ro_cached;    // safe for global shared instance
 static ReadOptions          g_ro_nocached;  // safe for global shared instance
 static WriteOptions         g_wo_sync;      // safe for global shared instance
-static const FilterPolicy*  g_fp = 0;       // safe for global shared instance
+static WriteBufferManager*  g_wbm = 0;      // safe for global shared instance, never deleted
+
+static void StopAsyncWriter(DB* db);
+static void StopCompactionJobs(DB* db);
 
 template<int N>
 class TempBuffer
@@ -83,93 +97,346 @@ extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved)
     return JNI_VERSION_1_1;
 }
 
+// public static native void leveldb_write_buffer_limit(long size); // total memtable size of all DBs opened after this call, 0 for no limit
+extern "C" JNIEXPORT void JNICALL DEF_JAVA(leveldb_1write_1buffer_1limit)
+    (JNIEnv* jenv, jclass jcls, jlong size)
+{
+    if(size < 0) size = 0;
+    if(g_wbm) g_wbm->SetBufferSize((size_t)size);
+    else g_wbm = new WriteBufferManager((size_t)size);
+}
+
+static port::Mutex g_open_mutex;
+static std::map<DB*, std::vector<Cache*> > g_owned_caches; // private caches deleted by leveldb_close, guarded by g_open_mutex
+static std::map<DB*, PersistentCache*> g_owned_pcaches;    // private persistent caches deleted by leveldb_close, guarded by g_open_mutex
+static const FilterPolicy* g_fps[3][65];                   // filter policies by FILTER_* type and bits per key, never deleted, guarded by g_open_mutex
+
+static const int FILTER_BLOOM         = 0;
+static const int FILTER_BLOCKED_BLOOM = 1;
+static const int FILTER_RIBBON        = 2;
+
+static const FilterPolicy* GetFilterPolicy(int bits, int type = FILTER_BLOOM)
+{
+    if(bits <= 0) return 0;
+    if(bits > 64) bits = 64;
+    MutexLock l(&g_open_mutex);
+    const FilterPolicy*& fp = g_fps[type][bits];
+    if(!fp)
+    {
+        if(type == FILTER_BLOCKED_BLOOM) fp = NewBlockedBloomFilterPolicy(bits);
+        else if(type == FILTER_RIBBON) fp = NewRibbonFilterPolicy(bits);
+        else fp = NewBloomFilterPolicy(bits);
+    }
+    return fp;
+}
+
+static Cache* NewPrivateCache(jlong size, std::vector<Cache*>* owned)
+{
+    Cache* cache = NewLRUCache((size_t)(size > CACHE_SIZE_MIN ? size : CACHE_SIZE_MIN));
+    owned->push_back(cache);
+    return cache;
+}
+
+// opens the DB with the settings common to all leveldb_open*, the DB owns the caches in "owned" and "pcache" unless the open fails
+static jlong OpenDB(JNIEnv* jenv, jstring path, Options& opt, std::vector<Cache*>& owned, PersistentCache* pcache = 0)
+{
+    DB* db = 0;
+    const char* pathptr = (path ? jenv->GetStringUTFChars(path, 0) : 0);
+    if(pathptr)
+    {
+        std::string pathstr(pathptr);
+        jenv->ReleaseStringUTFChars(path, pathptr);
+        opt.write_buffer_manager = g_wbm;
+        g_ro_nocached.fill_cache = false;
+        g_wo_sync.sync = true;
+        if(!DB::Open(opt, pathstr, &db).ok()) db = 0;
+    }
+    if(!db)
+    {
+        for(size_t i = 0; i < owned.size(); ++i)
+            delete owned[i];
+        delete pcache;
+        return 0;
+    }
+    if(!owned.empty() || pcache)
+    {
+        MutexLock l(&g_open_mutex);
+        if(!owned.empty()) g_owned_caches[db].swap(owned);
+        if(pcache) g_owned_pcaches[db] = pcache;
+    }
+    return (jlong)db;
+}
+
 // public static native long leveldb_open(String path, int write_bufsize, int cache_size, boolean use_snappy);
 extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1open)
     (JNIEnv* jenv, jclass jcls, jstring path, jint write_bufsize, jint cache_size, jboolean use_snappy)
 {
-    if(!path) return 0;
-    const char* pathptr = jenv->GetStringUTFChars(path, 0);
-    if(!pathptr) return 0;
-    std::string pathstr(pathptr);
-    jenv->ReleaseStringUTFChars(path, pathptr);
     Options opt;
+    std::vector<Cache*> owned;
     opt.create_if_missing = true;
     if(write_bufsize > 0) opt.write_buffer_size = write_bufsize;
-    if(cache_size > 0) opt.block_cache = NewLRUCache(cache_size > CACHE_SIZE_MIN ? cache_size : CACHE_SIZE_MIN);
+    if(cache_size > 0) opt.block_cache = NewPrivateCache(cache_size, &owned);
     opt.compression = (use_snappy ? kSnappyCompression : kNoCompression);
-    opt.filter_policy = (g_fp ? g_fp : (g_fp = NewBloomFilterPolicy(BLOOM_FILTER_BITS)));
-    g_ro_nocached.fill_cache = false;
-    g_wo_sync.sync = true;
-    DB* db = 0;
-    Status s = DB::Open(opt, pathstr, &db);
-    return s.ok() ? (jlong)db : 0;
+    opt.filter_policy = GetFilterPolicy(BLOOM_FILTER_BITS);
+    return OpenDB(jenv, path, opt, owned);
 }
 
 // public static native long leveldb_open2(String path, int write_bufsize, int cache_size, int file_size, boolean use_snappy);
 extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1open2)
     (JNIEnv* jenv, jclass jcls, jstring path, jint write_bufsize, jint cache_size, jint file_size, jboolean use_snappy)
 {
-    if(!path) return 0;
-    const char* pathptr = jenv->GetStringUTFChars(path, 0);
-    if(!pathptr) return 0;
-    std::string pathstr(pathptr);
-    jenv->ReleaseStringUTFChars(path, pathptr);
     Options opt;
+    std::vector<Cache*> owned;
     opt.create_if_missing = true;
     if(write_bufsize > 0) opt.write_buffer_size = write_bufsize;
-    if(cache_size > 0) opt.block_cache = NewLRUCache(cache_size > CACHE_SIZE_MIN ? cache_size : CACHE_SIZE_MIN);
+    if(cache_size > 0) opt.block_cache = NewPrivateCache(cache_size, &owned);
     if(file_size > 0) opt.max_file_size = file_size;
     opt.compression = (use_snappy ? kSnappyCompression : kNoCompression);
-    opt.filter_policy = (g_fp ? g_fp : (g_fp = NewBloomFilterPolicy(BLOOM_FILTER_BITS)));
-    g_ro_nocached.fill_cache = false;
-    g_wo_sync.sync = true;
-    DB* db = 0;
-    Status s = DB::Open(opt, pathstr, &db);
-    return s.ok() ? (jlong)db : 0;
+    opt.filter_policy = GetFilterPolicy(BLOOM_FILTER_BITS);
+    return OpenDB(jenv, path, opt, owned);
 }
 
 // public static native long leveldb_open3(String path, int write_bufsize, int max_open_files, int cache_size, int file_size, boolean use_snappy, boolean reuse_logs);
 extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1open3)
     (JNIEnv* jenv, jclass jcls, jstring path, jint write_bufsize, jint max_open_files, jint cache_size, jint file_size, jboolean use_snappy, jboolean reuse_logs)
 {
-    if(!path) return 0;
-    const char* pathptr = jenv->GetStringUTFChars(path, 0);
-    if(!pathptr) return 0;
-    std::string pathstr(pathptr);
-    jenv->ReleaseStringUTFChars(path, pathptr);
     Options opt;
+    std::vector<Cache*> owned;
     opt.create_if_missing = true;
     if(write_bufsize > 0) opt.write_buffer_size = write_bufsize;
     if(max_open_files > 0) opt.max_open_files = max_open_files;
-    if(cache_size > 0) opt.block_cache = NewLRUCache(cache_size > CACHE_SIZE_MIN ? cache_size : CACHE_SIZE_MIN);
+    if(cache_size > 0) opt.block_cache = NewPrivateCache(cache_size, &owned);
     if(file_size > 0) opt.max_file_size = file_size;
     opt.compression = (use_snappy ? kSnappyCompression : kNoCompression);
     opt.reuse_logs = reuse_logs;
-    opt.filter_policy = (g_fp ? g_fp : (g_fp = NewBloomFilterPolicy(BLOOM_FILTER_BITS)));
-    g_ro_nocached.fill_cache = false;
-    g_wo_sync.sync = true;
-    DB* db = 0;
-    Status s = DB::Open(opt, pathstr, &db);
-    return s.ok() ? (jlong)db : 0;
+    opt.filter_policy = GetFilterPolicy(BLOOM_FILTER_BITS);
+    return OpenDB(jenv, path, opt, owned);
+}
+
+static bool ParseInt(const std::string& str, int64_t min, int64_t max, int64_t* v)
+{
+    if(str.empty()) return false;
+    char* end;
+    long long n = strtoll(str.c_str(), &end, 10);
+    if(*end || n < min || n > max) return false;
+    *v = n;
+    return true;
+}
+
+// the options of leveldb_open4 applied after all are parsed, so their order does not matter
+struct OpenSettings
+{
+    std::vector<Cache*> owned;      // private caches
+    PersistentCache* pcache;        // private persistent cache or 0
+    bool has_cache_size;
+    int filter_type;                // FILTER_*
+    int filter_bits;
+    std::vector<int> level_filter_bits;
+
+    OpenSettings() : pcache(0), has_cache_size(false), filter_type(FILTER_BLOOM), filter_bits(BLOOM_FILTER_BITS) {}
+};
+
+// applies one "name=value" of leveldb_open4 to "opt" and "st", return false for unknown name or bad value
+static bool SetOption(Options& opt, OpenSettings& st, const std::string& name, const std::string& value)
+{
+    std::vector<Cache*>& owned = st.owned;
+    int64_t v = 0;
+    if(name == "compression")
+    {
+        if(value == "snappy") opt.compression = kSnappyCompression;
+        else if(value == "none") opt.compression = kNoCompression;
+        else return false;
+        return true;
+    }
+    if(name == "filter_type")
+    {
+        if(value == "bloom") st.filter_type = FILTER_BLOOM;
+        else if(value == "blocked_bloom") st.filter_type = FILTER_BLOCKED_BLOOM;
+        else if(value == "ribbon") st.filter_type = FILTER_RIBBON;
+        else return false;
+        return true;
+    }
+    if(name == "level_filter_bits") // comma-separated bits per key of levels 0,1,..., 0 for no filter
+    {
+        st.level_filter_bits.clear();
+        for(size_t pos = 0; pos <= value.size(); )
+        {
+            size_t next = value.find(',', pos);
+            if(next == std::string::npos) next = value.size();
+            if(!ParseInt(value.substr(pos, next - pos), 0, 64, &v)) return false;
+            st.level_filter_bits.push_back((int)v);
+            pos = next + 1;
+        }
+        return true;
+    }
+    if(name == "persistent_cache") // "<size>,<dir>", used with a block cache only
+    {
+        size_t comma = value.find(',');
+        if(comma == std::string::npos || comma + 1 == value.size() ||
+           !ParseInt(value.substr(0, comma), 1, INT64_MAX, &v)) return false;
+        delete st.pcache;
+        st.pcache = 0;
+        return NewPersistentCache(Env::Default(), value.substr(comma + 1), (size_t)v, &st.pcache).ok();
+    }
+    if(!ParseInt(value, 0, INT64_MAX, &v)) return false;
+    if(name == "create_if_missing") opt.create_if_missing = (v != 0);
+    else if(name == "error_if_exists") opt.error_if_exists = (v != 0);
+    else if(name == "paranoid_checks") opt.paranoid_checks = (v != 0);
+    else if(name == "write_buffer_size") opt.write_buffer_size = (size_t)v;
+    else if(name == "max_open_files") opt.max_open_files = (int)std::min<int64_t>(v, INT_MAX);
+    else if(name == "cache_size")
+    {
+        opt.block_cache = (v > 0 ? NewPrivateCache(v, &owned) : 0);
+        st.has_cache_size = true;
+    }
+    else if(name == "cache_index_and_filter_blocks") opt.cache_index_and_filter_blocks = (v != 0);
+    else if(name == "warm_block_cache") opt.warm_block_cache = (v != 0);
+    else if(name == "compressed_cache_size") opt.compressed_block_cache = (v > 0 ? NewPrivateCache(v, &owned) : 0);
+    else if(name == "row_cache_size") opt.row_cache = (v > 0 ? NewPrivateCache(v, &owned) : 0);
+    else if(name == "block_size") opt.block_size = (size_t)v;
+    else if(name == "block_restart_interval") opt.block_restart_interval = (int)std::min<int64_t>(v, INT_MAX);
+    else if(name == "data_block_hash_index") opt.data_block_hash_index = (v != 0);
+    else if(name == "max_file_size") opt.max_file_size = (size_t)v;
+    else if(name == "reuse_logs") opt.reuse_logs = (v != 0);
+    else if(name == "filter_bits") st.filter_bits = (int)std::min<int64_t>(v, 64);
+    else if(name == "full_filter") opt.full_filter = (v != 0);
+    else if(name == "optimize_filters_for_hits") opt.optimize_filters_for_hits = (v != 0);
+    else return false;
+    return true;
+}
+
+// public static native long leveldb_open4(String path, String options, long cache);
+// options="name=value;..." with names of Options fields (cache sizes for private caches, filter_bits=10 and compression=snappy by default),
+// filter_type=bloom|blocked_bloom|ribbon for filter_bits and level_filter_bits (bloom by default),
+// persistent_cache=<size>,<dir> for a private persistent cache behind the block cache;
+// cache=0 or a block cache of leveldb_cache_new shared with other DBs (not with cache_size); return 0 for error
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1open4)
+    (JNIEnv* jenv, jclass jcls, jstring path, jstring options, jlong cache)
+{
+    Options opt;
+    OpenSettings st;
+    opt.create_if_missing = true;
+    bool ok = true;
+    if(options)
+    {
+        const char* optptr = jenv->GetStringUTFChars(options, 0);
+        if(!optptr) return 0;
+        std::string optstr(optptr);
+        jenv->ReleaseStringUTFChars(options, optptr);
+        for(size_t pos = 0; ok && pos < optstr.size(); )
+        {
+            size_t next = optstr.find(';', pos);
+            if(next == std::string::npos) next = optstr.size();
+            std::string item = optstr.substr(pos, next - pos);
+            pos = next + 1;
+            item.erase(0, item.find_first_not_of(" \t\r\n"));
+            item.erase(item.find_last_not_of(" \t\r\n") + 1);
+            if(item.empty()) continue;
+            size_t eq = item.find('=');
+            ok = (eq != std::string::npos && SetOption(opt, st, item.substr(0, eq), item.substr(eq + 1)));
+        }
+    }
+    if(ok && cache)
+    {
+        if(st.has_cache_size) ok = false;
+        else opt.block_cache = (Cache*)cache;
+    }
+    if(!ok)
+    {
+        for(size_t i = 0; i < st.owned.size(); ++i)
+            delete st.owned[i];
+        delete st.pcache;
+        return 0;
+    }
+    opt.filter_policy = GetFilterPolicy(st.filter_bits, st.filter_type);
+    for(size_t i = 0; i < st.level_filter_bits.size(); ++i)
+        opt.level_filter_policies.push_back(GetFilterPolicy(st.level_filter_bits[i], st.filter_type));
+    opt.persistent_cache = st.pcache;
+    return OpenDB(jenv, path, opt, st.owned, st.pcache);
+}
+
+// public static native long leveldb_cache_new(long capacity); // block cache to share by leveldb_open4, delete it after closing all its DBs
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1cache_1new)
+    (JNIEnv* jenv, jclass jcls, jlong capacity)
+{
+    return (jlong)NewLRUCache((size_t)(capacity > CACHE_SIZE_MIN ? capacity : CACHE_SIZE_MIN));
+}
+
+// public static native long leveldb_cache_usage(long cache); // return byte-size of cached blocks
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1cache_1usage)
+    (JNIEnv* jenv, jclass jcls, jlong cache)
+{
+    return cache ? (jlong)((Cache*)cache)->TotalCharge() : 0;
+}
+
+// public static native void leveldb_cache_delete(long cache);
+extern "C" JNIEXPORT void JNICALL DEF_JAVA(leveldb_1cache_1delete)
+    (JNIEnv* jenv, jclass jcls, jlong cache)
+{
+    delete (Cache*)cache;
 }
 
 // public static native void leveldb_close(long handle);
 extern "C" JNIEXPORT void JNICALL DEF_JAVA(leveldb_1close)
     (JNIEnv* jenv, jclass jcls, jlong handle)
 {
-    DB* db = (DBImpl*)handle;
+    DB* db = (DB*)handle;
     if(!db) return;
-    DBImpl* dbi = dynamic_cast<DBImpl*>(db);
-    Cache* cache = (dbi ? dbi->GetOptions().block_cache : 0);
+    std::vector<Cache*> owned;
+    PersistentCache* pcache = 0;
+    {
+        MutexLock l(&g_open_mutex);
+        std::map<DB*, std::vector<Cache*> >::iterator it = g_owned_caches.find(db);
+        if(it != g_owned_caches.end())
+        {
+            owned.swap(it->second);
+            g_owned_caches.erase(it);
+        }
+        std::map<DB*, PersistentCache*>::iterator pit = g_owned_pcaches.find(db);
+        if(pit != g_owned_pcaches.end())
+        {
+            pcache = pit->second;
+            g_owned_pcaches.erase(pit);
+        }
+    }
+    StopAsyncWriter(db);
+    StopCompactionJobs(db);
     delete db;
-    if(cache) delete cache;
+    for(size_t i = 0; i < owned.size(); ++i)
+        delete owned[i];
+    delete pcache;
 }
 
-// public static native byte[] leveldb_get(long handle, byte[] key, int keylen); // return null for not found
-extern "C" JNIEXPORT jbyteArray JNICALL DEF_JAVA(leveldb_1get)
-    (JNIEnv* jenv, jclass jcls, jlong handle, jbyteArray key, jint keylen)
+static const jint READ_NO_FILL_CACHE   = 1; // flags of the read functions taking a snapshot
+static const jint READ_VERIFY_CHECKSUM = 2;
+
+static void SetReadOptions(ReadOptions* ro, jlong snapshot, jint flags, jint readahead)
+{
+    ro->snapshot = (const Snapshot*)snapshot;
+    ro->fill_cache = !(flags & READ_NO_FILL_CACHE);
+    ro->verify_checksums = (flags & READ_VERIFY_CHECKSUM) != 0;
+    ro->readahead_size = (readahead > 0 ? (size_t)readahead : 0);
+}
+
+// public static native long leveldb_snapshot_new(long handle); // return snapshot for the read functions taking one, release it before close
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1snapshot_1new)
+    (JNIEnv* jenv, jclass jcls, jlong handle)
+{
+    DB* db = (DB*)handle;
+    if(!db) return 0;
+    return (jlong)db->GetSnapshot();
+}
+
+// public static native void leveldb_snapshot_release(long handle, long snapshot);
+extern "C" JNIEXPORT void JNICALL DEF_JAVA(leveldb_1snapshot_1release)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jlong snapshot)
 {
     DB* db = (DB*)handle;
+    if(db && snapshot) db->ReleaseSnapshot((const Snapshot*)snapshot);
+}
+
+static jbyteArray GetValue(JNIEnv* jenv, DB* db, const ReadOptions& ro, jbyteArray key, jint keylen)
+{
     if(!db || !key) return 0;
     jsize m = jenv->GetArrayLength(key);
     if(keylen > m) keylen = m;
@@ -179,7 +446,7 @@ extern "C" JNIEXPORT jbyteArray JNICALL DEF_JAVA(leveldb_1get)
     if(!keyptr) return 0;
     jenv->GetByteArrayRegion(key, 0, keylen, (jbyte*)keyptr);
     std::string valstr;
-    Status s = db->Get(g_ro_cached, Slice(keyptr, (size_t)keylen), &valstr);
+    Status s = db->Get(ro, Slice(keyptr, (size_t)keylen), &valstr);
     if(!s.ok()) return 0;
     jsize vallen = (jsize)valstr.size();
     jbyteArray val = jenv->NewByteArray(vallen);
@@ -188,6 +455,120 @@ extern "C" JNIEXPORT jbyteArray JNICALL DEF_JAVA(leveldb_1get)
     return val;
 }
 
+// public static native byte[] leveldb_get(long handle, byte[] key, int keylen); // return null for not found
+extern "C" JNIEXPORT jbyteArray JNICALL DEF_JAVA(leveldb_1get)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jbyteArray key, jint keylen)
+{
+    return GetValue(jenv, (DB*)handle, g_ro_cached, key, keylen);
+}
+
+// public static native byte[] leveldb_get2(long handle, long snapshot, byte[] key, int keylen, int flags); // snapshot=0 for latest; flags=1|2: no fill cache|verify checksums; return null for not found
+extern "C" JNIEXPORT jbyteArray JNICALL DEF_JAVA(leveldb_1get2)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jlong snapshot, jbyteArray key, jint keylen, jint flags)
+{
+    ReadOptions ro;
+    SetReadOptions(&ro, snapshot, flags, 0);
+    return GetValue(jenv, (DB*)handle, ro, key, keylen);
+}
+
+struct DirectValue
+{
+    char* buf;
+    jint cap;
+    jint len;
+};
+
+static void CopyDirectValue(void* arg, const Slice& value)
+{
+    DirectValue* dv = (DirectValue*)arg;
+    dv->len = (jint)value.size();
+    if(dv->len <= dv->cap && !value.empty())
+        memcpy(dv->buf, value.data(), value.size());
+}
+
+// public static native int leveldb_get_direct(long handle, long keyaddr, int keylen, long valaddr, int valcap);
+// addresses of direct ByteBuffers; return value size (value is copied only if <= valcap, else call again with a buffer of that size), -1 for not found, -2 for error
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1get_1direct)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jlong keyaddr, jint keylen, jlong valaddr, jint valcap)
+{
+    DB* db = (DB*)handle;
+    if(!db || !keyaddr || keylen <= 0 || valcap < 0 || (!valaddr && valcap > 0)) return -2;
+    DirectValue dv = { (char*)valaddr, valcap, 0 };
+    Status s = db->GetPinned(g_ro_cached, Slice((const char*)keyaddr, (size_t)keylen), &dv, CopyDirectValue);
+    if(s.ok()) return dv.len;
+    return s.IsNotFound() ? -1 : -2;
+}
+
+// public static native int leveldb_get_direct2(long handle, long snapshot, long keyaddr, int keylen, long valaddr, int valcap, int flags); // as leveldb_get_direct, with snapshot and flags of leveldb_get2
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1get_1direct2)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jlong snapshot, jlong keyaddr, jint keylen, jlong valaddr, jint valcap, jint flags)
+{
+    DB* db = (DB*)handle;
+    if(!db || !keyaddr || keylen <= 0 || valcap < 0 || (!valaddr && valcap > 0)) return -2;
+    ReadOptions ro;
+    SetReadOptions(&ro, snapshot, flags, 0);
+    DirectValue dv = { (char*)valaddr, valcap, 0 };
+    Status s = db->GetPinned(ro, Slice((const char*)keyaddr, (size_t)keylen), &dv, CopyDirectValue);
+    if(s.ok()) return dv.len;
+    return s.IsNotFound() ? -1 : -2;
+}
+
+// public static native int leveldb_put_direct(long handle, long keyaddr, int keylen, long valaddr, int vallen); // addresses of direct ByteBuffers; vallen <= 0 for delete; return 0 for ok
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1put_1direct)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jlong keyaddr, jint keylen, jlong valaddr, jint vallen)
+{
+    DB* db = (DB*)handle;
+    if(!db || !keyaddr || keylen <= 0 || (!valaddr && vallen > 0)) return 1;
+    WriteBatch wb;
+    if(vallen > 0)
+        wb.Put(Slice((const char*)keyaddr, (size_t)keylen), Slice((const char*)valaddr, (size_t)vallen));
+    else
+        wb.Delete(Slice((const char*)keyaddr, (size_t)keylen));
+    return db->Write(g_wo_sync, &wb).ok() ? 0 : 5;
+}
+
+// public static native byte[] leveldb_multiget(long handle, byte[] keys, int keyslen);
+// keys packed as [keylen:varint32, key]...; return values in the same order packed as [vallen+1:varint32, value]... with 0 for not found, or null for error
+extern "C" JNIEXPORT jbyteArray JNICALL DEF_JAVA(leveldb_1multiget)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jbyteArray keys, jint keyslen)
+{
+    DB* db = (DB*)handle;
+    if(!db || !keys || keyslen < 0 || jenv->GetArrayLength(keys) < keyslen) return 0;
+    TempBuffer<3804> keysBuf;
+    char* keysptr = keysBuf.get(keyslen);
+    if(!keysptr) return 0;
+    jenv->GetByteArrayRegion(keys, 0, keyslen, (jbyte*)keysptr);
+    std::vector<Slice> keyslices;
+    Slice input(keysptr, (size_t)keyslen);
+    while(!input.empty())
+    {
+        Slice key;
+        if(!GetLengthPrefixedSlice(&input, &key)) return 0;
+        keyslices.push_back(key);
+    }
+    const int n = (int)keyslices.size();
+    std::vector<std::string> values(n);
+    std::vector<Status> statuses(n);
+    if(n > 0) db->MultiGet(g_ro_cached, n, &keyslices[0], &values[0], &statuses[0]);
+    std::string result;
+    for(int i = 0; i < n; ++i)
+    {
+        if(statuses[i].ok())
+        {
+            PutVarint32(&result, (uint32_t)values[i].size() + 1);
+            result.append(values[i]);
+        }
+        else if(statuses[i].IsNotFound())
+            PutVarint32(&result, 0);
+        else
+            return 0;
+    }
+    jbyteArray val = jenv->NewByteArray((jsize)result.size());
+    if(val && !result.empty())
+        jenv->SetByteArrayRegion(val, 0, (jsize)result.size(), (const jbyte*)result.data());
+    return val;
+}
+
 // public static native int leveldb_write(long handle, Iterator<Entry<Octets, Octets>> it); // return 0 for ok
 extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1write)
     (JNIEnv* jenv, jclass jcls, jlong handle, jobject it)
@@ -232,6 +613,8 @@ extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1write)
     TempBuffer<3604> valBuf;
     while(jenv->CallBooleanMethod(it, mid_hasNext) == JNI_TRUE)
     {
+        // free the local references of each entry as we go, or they pile up for the whole batch
+        if(jenv->PushLocalFrame(8) < 0) return 6;
         jobject entry = jenv->CallObjectMethod(it, mid_next);
         jobject key = jenv->CallObjectMethod(entry, mid_getKey);
         if(key)
@@ -266,6 +649,40 @@ extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1write)
                 }
             }
         }
+        jenv->PopLocalFrame(0);
+    }
+    return db->Write(g_wo_sync, &wb).ok() ? 0 : 5;
+}
+
+// public static native int leveldb_write_arrays(long handle, byte[][] keys, byte[][] vals, int count); // null or empty vals[i] for delete; return 0 for ok
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1write_1arrays)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jobjectArray keys, jobjectArray vals, jint count)
+{
+    DB* db = (DB*)handle;
+    if(!db || !keys || !vals) return 1;
+    if(count < 0 || jenv->GetArrayLength(keys) < count || jenv->GetArrayLength(vals) < count) return 2;
+    WriteBatch wb;
+    for(jint i = 0; i < count; ++i)
+    {
+        jbyteArray key = (jbyteArray)jenv->GetObjectArrayElement(keys, i);
+        jbyteArray val = (jbyteArray)jenv->GetObjectArrayElement(vals, i);
+        jsize keylen = (key ? jenv->GetArrayLength(key) : 0);
+        jsize vallen = (val ? jenv->GetArrayLength(val) : 0);
+        if(keylen > 0)
+        {
+            // copy straight from the java arrays into the batch, no jni calls until released
+            char* keyptr = (char*)jenv->GetPrimitiveArrayCritical(key, 0);
+            char* valptr = (keyptr && vallen > 0 ? (char*)jenv->GetPrimitiveArrayCritical(val, 0) : 0);
+            if(valptr)
+                wb.Put(Slice(keyptr, (size_t)keylen), Slice(valptr, (size_t)vallen));
+            else if(keyptr && vallen <= 0)
+                wb.Delete(Slice(keyptr, (size_t)keylen));
+            if(valptr) jenv->ReleasePrimitiveArrayCritical(val, valptr, JNI_ABORT);
+            if(keyptr) jenv->ReleasePrimitiveArrayCritical(key, keyptr, JNI_ABORT);
+            if(!keyptr || (vallen > 0 && !valptr)) return 3;
+        }
+        if(key) jenv->DeleteLocalRef(key);
+        if(val) jenv->DeleteLocalRef(val);
     }
     return db->Write(g_wo_sync, &wb).ok() ? 0 : 5;
 }
@@ -283,6 +700,178 @@ extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1write_1direct)
     return db->Write(g_wo_sync, &wb).ok() ? 0 : 5;
 }
 
+// Batches submitted by leveldb_write_async are appended to "pending" and
+// written by one background thread per DB. While it waits for the sync of
+// one group, later submissions gather in "pending" and go out together in
+// the next group, so many commits share one fdatasync.
+static const size_t ASYNC_PENDING_MAX = 64 << 20; // submitters wait while pending holds more bytes
+
+struct AsyncWriter
+{
+    DB* db;
+    port::Mutex mu;
+    port::CondVar work_cv;      // signaled when pending grows or on stop
+    port::CondVar done_cv;      // signaled when pending is taken, a group completes or the thread exits
+    WriteBatch batches[2];
+    WriteBatch* pending;        // guarded by mu
+    int64_t submitted;          // last ticket handed out, guarded by mu
+    int64_t done;               // last ticket written and synced (or failed), guarded by mu
+    std::vector<std::pair<int64_t, int64_t> > failed; // [first, last] tickets of failed groups, adjacent ones merged, guarded by mu
+    int64_t reported;           // failed tickets up to this one were returned by leveldb_write_async_done, guarded by mu
+    bool stop;                  // guarded by mu
+    bool running;               // guarded by mu
+
+    explicit AsyncWriter(DB* d) : db(d), work_cv(&mu), done_cv(&mu), pending(&batches[0]),
+        submitted(0), done(0), reported(0), stop(false), running(true) {}
+
+    bool Failed(int64_t ticket) const // REQUIRES: mu held
+    {
+        std::vector<std::pair<int64_t, int64_t> >::const_iterator it =
+            std::upper_bound(failed.begin(), failed.end(), std::make_pair(ticket, INT64_MAX));
+        return it != failed.begin() && ticket <= (--it)->second;
+    }
+
+    // returns the lowest failed ticket not reported yet, 0 if none, and marks the rest of its range reported. REQUIRES: mu held
+    int64_t ReportFailure()
+    {
+        std::vector<std::pair<int64_t, int64_t> >::const_iterator it =
+            std::upper_bound(failed.begin(), failed.end(), std::make_pair(reported, INT64_MAX));
+        if(it != failed.begin() && (it - 1)->second > reported) --it; // grown by a later adjacent failure
+        else if(it == failed.end()) return 0;
+        const int64_t ticket = std::max(it->first, reported + 1);
+        reported = it->second;
+        return ticket;
+    }
+};
+
+static port::Mutex g_async_mutex;
+static std::map<DB*, AsyncWriter*> g_async_writers; // guarded by g_async_mutex
+
+static void AsyncWriterMain(void* arg)
+{
+    AsyncWriter* w = (AsyncWriter*)arg;
+    w->mu.Lock();
+    for(;;)
+    {
+        while(w->done == w->submitted && !w->stop)
+            w->work_cv.Wait();
+        if(w->done == w->submitted) break;
+        WriteBatch* group = w->pending;
+        w->pending = (group == &w->batches[0] ? &w->batches[1] : &w->batches[0]);
+        const int64_t first = w->done + 1, last = w->submitted;
+        w->done_cv.SignalAll();
+        w->mu.Unlock();
+        Status s = w->db->Write(g_wo_sync, group);
+        group->Clear();
+        w->mu.Lock();
+        if(!s.ok())
+        {
+            if(!w->failed.empty() && w->failed.back().second == first - 1)
+                w->failed.back().second = last;
+            else
+                w->failed.push_back(std::make_pair(first, last));
+        }
+        w->done = last;
+        w->done_cv.SignalAll();
+    }
+    w->running = false;
+    w->done_cv.SignalAll();
+    w->mu.Unlock();
+}
+
+static AsyncWriter* GetAsyncWriter(DB* db, bool create)
+{
+    MutexLock l(&g_async_mutex);
+    std::map<DB*, AsyncWriter*>::iterator it = g_async_writers.find(db);
+    if(it != g_async_writers.end()) return it->second;
+    if(!create) return 0;
+    AsyncWriter* w = new AsyncWriter(db);
+    g_async_writers[db] = w;
+    Env::Default()->StartThread(AsyncWriterMain, w);
+    return w;
+}
+
+// writes everything submitted before and stops the thread, before the DB is deleted
+static void StopAsyncWriter(DB* db)
+{
+    AsyncWriter* w;
+    {
+        MutexLock l(&g_async_mutex);
+        std::map<DB*, AsyncWriter*>::iterator it = g_async_writers.find(db);
+        if(it == g_async_writers.end()) return;
+        w = it->second;
+        g_async_writers.erase(it);
+    }
+    w->mu.Lock();
+    w->stop = true;
+    w->work_cv.Signal();
+    while(w->running)
+        w->done_cv.Wait();
+    w->mu.Unlock();
+    delete w;
+}
+
+class NullHandler : public WriteBatch::Handler
+{
+public:
+    void Put(const Slice& key, const Slice& value) override {}
+    void Delete(const Slice& key) override {}
+};
+
+// public static native long leveldb_write_async(long handle, byte[] buf, int size); // same buf as leveldb_write_direct, return ticket(>0) or error(<0) without waiting
+// -3 for a malformed buf, which is not written; waits while too many bytes are pending
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1write_1async)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jbyteArray buf, jint size)
+{
+    DB* db = (DB*)handle;
+    if(!db || !buf) return -1;
+    if(size < 4 || jenv->GetArrayLength(buf) < size) return -2;
+    // parse it alone first, so that a bad one cannot fail the whole group it would join
+    WriteBatch wb;
+    char* pbuf = WriteBatchInternal::Resize(&wb, 8 + size);
+    jenv->GetByteArrayRegion(buf, 0, size, (jbyte*)(pbuf + 8));
+    NullHandler handler;
+    if(!wb.Iterate(&handler).ok()) return -3;
+    AsyncWriter* w = GetAsyncWriter(db, true);
+    MutexLock l(&w->mu);
+    while(WriteBatchInternal::Count(w->pending) > 0 &&
+          WriteBatchInternal::ByteSize(w->pending) + WriteBatchInternal::ByteSize(&wb) > ASYNC_PENDING_MAX)
+        w->done_cv.Wait();
+    WriteBatchInternal::Append(w->pending, &wb);
+    w->work_cv.Signal();
+    return ++w->submitted;
+}
+
+// public static native long leveldb_write_async_done(long handle); // return last ticket written and synced, or -ticket for the lowest failed ticket not returned before
+// all earlier tickets were written and synced except failed ones returned before; returning -ticket also covers the later failed
+// tickets of its group and adjacent failed groups, which leveldb_write_async_wait tells apart
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1write_1async_1done)
+    (JNIEnv* jenv, jclass jcls, jlong handle)
+{
+    DB* db = (DB*)handle;
+    if(!db) return 0;
+    AsyncWriter* w = GetAsyncWriter(db, false);
+    if(!w) return 0;
+    MutexLock l(&w->mu);
+    const int64_t failed = w->ReportFailure();
+    return failed ? -failed : w->done;
+}
+
+// public static native int leveldb_write_async_wait(long handle, long ticket); // block until the ticket is written and synced, return 0 for ok, 5 if its group failed
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1write_1async_1wait)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jlong ticket)
+{
+    DB* db = (DB*)handle;
+    if(!db) return 1;
+    AsyncWriter* w = GetAsyncWriter(db, false);
+    if(!w) return ticket <= 0 ? 0 : 2;
+    MutexLock l(&w->mu);
+    if(ticket > w->submitted) return 2;
+    while(w->done < ticket)
+        w->done_cv.Wait();
+    return w->Failed(ticket) ? 5 : 0;
+}
+
 static int64_t AppendFile(Env& env, const std::string& srcfile, const std::string& dstfile, bool checkmagic)
 {
     uint64_t srcsize = 0, dstsize = 0;
@@ -343,6 +932,19 @@ static int64_t AppendFile(Env& env, const std::string& srcfile, const std::strin
     return res;
 }
 
+// public static native int leveldb_checkpoint(long handle, String dstpath); // dstpath must not exist; hard-links tables and copies logs; return 0 for ok
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1checkpoint)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jstring dstpath)
+{
+    DB* db = (DB*)handle;
+    if(!db || !dstpath) return 1;
+    const char* dstpathptr = jenv->GetStringUTFChars(dstpath, 0);
+    if(!dstpathptr) return 2;
+    std::string dstpathstr(dstpathptr);
+    jenv->ReleaseStringUTFChars(dstpath, dstpathptr);
+    return db->CreateCheckpoint(dstpathstr).ok() ? 0 : 5;
+}
+
 // public static native long leveldb_backup(long handle, String srcpath, String dstpath, String datetime); // return byte-size of copied data
 extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1backup)
     (JNIEnv* jenv, jclass jcls, jlong handle, jstring srcpath, jstring dstpath, jstring datetime)
@@ -418,13 +1020,79 @@ extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1backup)
     return n;
 }
 
-// public static native long leveldb_iter_new(long handle, byte[] key, int keylen, int type); // type=0|1|2|3: <|<=|>=|>key
-extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1iter_1new)
-    (JNIEnv* jenv, jclass jcls, jlong handle, jbyteArray key, jint keylen, jint type)
+// public static native long leveldb_backup_open(String backuppath, int threads, long ratelimit); // ratelimit=bytes per second (0 for none); return engine handle, 0 for failed
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1backup_1open)
+    (JNIEnv* jenv, jclass jcls, jstring backuppath, jint threads, jlong ratelimit)
 {
+    if(!backuppath || threads <= 0 || ratelimit < 0) return 0;
+    const char* backuppathptr = jenv->GetStringUTFChars(backuppath, 0);
+    if(!backuppathptr) return 0;
+    std::string backuppathstr(backuppathptr);
+    jenv->ReleaseStringUTFChars(backuppath, backuppathptr);
+    BackupEngineOptions opt;
+    opt.max_background_operations = threads;
+    opt.rate_limit = (uint64_t)ratelimit;
+    BackupEngine* engine = 0;
+    return BackupEngine::Open(opt, backuppathstr, &engine).ok() ? (jlong)engine : 0;
+}
+
+// public static native long leveldb_backup_create(long engine, long handle); // copies only tables not in earlier backups; return new backup id, <0 for failed
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1backup_1create)
+    (JNIEnv* jenv, jclass jcls, jlong engine, jlong handle)
+{
+    BackupEngine* be = (BackupEngine*)engine;
     DB* db = (DB*)handle;
+    if(!be || !db) return -1;
+    uint32_t id = 0;
+    return be->CreateNewBackup(db, &id).ok() ? (jlong)id : -5;
+}
+
+// public static native int leveldb_backup_verify(long engine, long id); // return 0 for ok
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1backup_1verify)
+    (JNIEnv* jenv, jclass jcls, jlong engine, jlong id)
+{
+    BackupEngine* be = (BackupEngine*)engine;
+    if(!be) return 1;
+    if(id <= 0 || id > UINT32_MAX) return 2;
+    return be->VerifyBackup((uint32_t)id).ok() ? 0 : 5;
+}
+
+// public static native int leveldb_backup_restore(long engine, long id, String dbpath); // id=0 for the latest; db must not be open; return 0 for ok
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1backup_1restore)
+    (JNIEnv* jenv, jclass jcls, jlong engine, jlong id, jstring dbpath)
+{
+    BackupEngine* be = (BackupEngine*)engine;
+    if(!be) return 1;
+    if(!dbpath || id < 0 || id > UINT32_MAX) return 2;
+    const char* dbpathptr = jenv->GetStringUTFChars(dbpath, 0);
+    if(!dbpathptr) return 2;
+    std::string dbpathstr(dbpathptr);
+    jenv->ReleaseStringUTFChars(dbpath, dbpathptr);
+    Status s = (id == 0 ? be->RestoreDBFromLatestBackup(dbpathstr) : be->RestoreDBFromBackup((uint32_t)id, dbpathstr));
+    return s.ok() ? 0 : 5;
+}
+
+// public static native int leveldb_backup_purge(long engine, int keep); // keeps the newest backups; return 0 for ok
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1backup_1purge)
+    (JNIEnv* jenv, jclass jcls, jlong engine, jint keep)
+{
+    BackupEngine* be = (BackupEngine*)engine;
+    if(!be) return 1;
+    if(keep < 0) return 2;
+    return be->PurgeOldBackups(keep).ok() ? 0 : 5;
+}
+
+// public static native void leveldb_backup_close(long engine);
+extern "C" JNIEXPORT void JNICALL DEF_JAVA(leveldb_1backup_1close)
+    (JNIEnv* jenv, jclass jcls, jlong engine)
+{
+    delete (BackupEngine*)engine;
+}
+
+static jlong NewIterator(JNIEnv* jenv, DB* db, const ReadOptions& ro, jbyteArray key, jint keylen, jint type)
+{
     if(!db || type < 0 || type > 3) return 0;
-    Iterator* it = db->NewIterator(g_ro_nocached);
+    Iterator* it = db->NewIterator(ro);
     if(it)
     {
         if(!key || keylen <= 0)
@@ -460,6 +1128,23 @@ extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1iter_1new)
     return (jlong)it;
 }
 
+// public static native long leveldb_iter_new(long handle, byte[] key, int keylen, int type); // type=0|1|2|3: <|<=|>=|>key
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1iter_1new)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jbyteArray key, jint keylen, jint type)
+{
+    return NewIterator(jenv, (DB*)handle, g_ro_nocached, key, keylen, type);
+}
+
+// public static native long leveldb_iter_new2(long handle, long snapshot, byte[] key, int keylen, int type, int flags, int readahead);
+// as leveldb_iter_new, with snapshot and flags of leveldb_get2 (fills cache unless flags has 1), readahead=bytes to read ahead in table files (0 for none)
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1iter_1new2)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jlong snapshot, jbyteArray key, jint keylen, jint type, jint flags, jint readahead)
+{
+    ReadOptions ro;
+    SetReadOptions(&ro, snapshot, flags, readahead);
+    return NewIterator(jenv, (DB*)handle, ro, key, keylen, type);
+}
+
 // public static native void leveldb_iter_delete(long iter);
 extern "C" JNIEXPORT void JNICALL DEF_JAVA(leveldb_1iter_1delete)
     (JNIEnv* jenv, jclass jcls, jlong iter)
@@ -508,6 +1193,79 @@ extern "C" JNIEXPORT jbyteArray JNICALL DEF_JAVA(leveldb_1iter_1value)
     return val;
 }
 
+// Packs entries from "it" into buf as [keylen:varint32, key, vallen:varint32, value]..., moving it forward
+// (or backward if reverse) past each packed entry, and stops after maxcount entries, at the first key
+// at or past bound (if bound is not null), or when the next entry does not fit.
+// Returns the number of entries packed, or -N if not even the first entry fits in a buffer smaller than N bytes.
+static jint PackEntries(Iterator* it, char* buf, jint bufsize, jint maxcount, const Slice* bound, bool reverse, jint* size)
+{
+    jint count = 0;
+    char* p = buf;
+    char* const end = buf + bufsize;
+    *size = 0;
+    for(; count < maxcount && it->Valid(); ++count)
+    {
+        const Slice key = it->key();
+        if(bound && (reverse ? key.compare(*bound) <= 0 : key.compare(*bound) >= 0)) break;
+        const Slice val = it->value();
+        const size_t need = VarintLength(key.size()) + key.size() + VarintLength(val.size()) + val.size();
+        if(need > (size_t)(end - p))
+        {
+            if(count == 0) return -(jint)need;
+            break;
+        }
+        p = EncodeVarint32(p, (uint32_t)key.size());
+        memcpy(p, key.data(), key.size());
+        p += key.size();
+        p = EncodeVarint32(p, (uint32_t)val.size());
+        memcpy(p, val.data(), val.size());
+        p += val.size();
+        if(reverse) it->Prev(); else it->Next();
+    }
+    *size = (jint)(p - buf);
+    return count;
+}
+
+// public static native int leveldb_iter_fetch(long iter, byte[] buf, int bufsize, int maxcount, byte[] bound, int boundlen, boolean reverse);
+// fill buf with up to maxcount entries as [keylen:varint32, key, vallen:varint32, value]..., stopping before any key >= bound (<= bound if reverse; no bound if null),
+// and move iter past them; return the number of entries, or -N if buf is too small for the first entry and needs N bytes
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1iter_1fetch)
+    (JNIEnv* jenv, jclass jcls, jlong iter, jbyteArray buf, jint bufsize, jint maxcount, jbyteArray bound, jint boundlen, jboolean reverse)
+{
+    Iterator* it = (Iterator*)iter;
+    if(!it || !buf || bufsize < 0 || jenv->GetArrayLength(buf) < bufsize) return 0;
+    TempBuffer<3804> boundBuf;
+    Slice boundslice;
+    if(bound && boundlen > 0)
+    {
+        if(boundlen > jenv->GetArrayLength(bound)) return 0;
+        char* boundptr = boundBuf.get(boundlen);
+        if(!boundptr) return 0;
+        jenv->GetByteArrayRegion(bound, 0, boundlen, (jbyte*)boundptr);
+        boundslice = Slice(boundptr, (size_t)boundlen);
+    }
+    TempBuffer<16384> outBuf;
+    char* outptr = outBuf.get(bufsize);
+    if(!outptr) return 0;
+    jint size;
+    jint n = PackEntries(it, outptr, bufsize, maxcount, (bound && boundlen > 0 ? &boundslice : 0), reverse != JNI_FALSE, &size);
+    if(size > 0)
+        jenv->SetByteArrayRegion(buf, 0, size, (const jbyte*)outptr);
+    return n;
+}
+
+// public static native int leveldb_iter_fetch_direct(long iter, long bufaddr, int bufsize, int maxcount, long boundaddr, int boundlen, boolean reverse);
+// same as leveldb_iter_fetch, but buf and bound are addresses of direct ByteBuffers
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1iter_1fetch_1direct)
+    (JNIEnv* jenv, jclass jcls, jlong iter, jlong bufaddr, jint bufsize, jint maxcount, jlong boundaddr, jint boundlen, jboolean reverse)
+{
+    Iterator* it = (Iterator*)iter;
+    if(!it || !bufaddr || bufsize < 0) return 0;
+    Slice boundslice((const char*)boundaddr, (size_t)(boundaddr && boundlen > 0 ? boundlen : 0));
+    jint size;
+    return PackEntries(it, (char*)bufaddr, bufsize, maxcount, (boundslice.empty() ? 0 : &boundslice), reverse != JNI_FALSE, &size);
+}
+
 // public static native boolean leveldb_compact(long handle, byte[] key_from, int key_from_len, byte[] key_to, int key_to_len);
 extern "C" JNIEXPORT jboolean JNICALL DEF_JAVA(leveldb_1compact)
     (JNIEnv* jenv, jclass jcls, jlong handle, jbyteArray key_from, jint key_from_len, jbyteArray key_to, jint key_to_len)
@@ -548,6 +1306,97 @@ extern "C" JNIEXPORT jboolean JNICALL DEF_JAVA(leveldb_1compact)
     return JNI_TRUE;
 }
 
+static port::Mutex g_compact_mutex;
+static std::multimap<DB*, CompactionJob*> g_compact_jobs; // jobs not yet stopped by leveldb_close, guarded by g_compact_mutex
+
+static void StopCompactionJobs(DB* db)
+{
+    std::vector<CompactionJob*> jobs;
+    {
+        MutexLock l(&g_compact_mutex);
+        std::pair<std::multimap<DB*, CompactionJob*>::iterator, std::multimap<DB*, CompactionJob*>::iterator> r = g_compact_jobs.equal_range(db);
+        for(std::multimap<DB*, CompactionJob*>::iterator it = r.first; it != r.second; ++it)
+            jobs.push_back(it->second);
+        g_compact_jobs.erase(r.first, r.second);
+    }
+    for(size_t i = 0; i < jobs.size(); ++i)
+        jobs[i]->Cancel();
+    for(size_t i = 0; i < jobs.size(); ++i)
+        jobs[i]->Wait(); // the jobs are still deleted by leveldb_compact_free
+}
+
+static void GetKey(JNIEnv* jenv, jbyteArray key, jint keylen, std::string* str)
+{
+    if(!key) return;
+    jsize m = jenv->GetArrayLength(key);
+    if(keylen > m) keylen = m;
+    if(keylen <= 0) return;
+    str->resize((size_t)keylen);
+    jenv->GetByteArrayRegion(key, 0, keylen, (jbyte*)&(*str)[0]);
+}
+
+// public static native long leveldb_compact_async(long handle, byte[] key_from, int key_from_len, byte[] key_to, int key_to_len, int start_level, int max_output_level);
+// as leveldb_compact in background, from start_level down until max_output_level is written (<0 for the deepest level with files); return job handle, 0 for failed
+extern "C" JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1compact_1async)
+    (JNIEnv* jenv, jclass jcls, jlong handle, jbyteArray key_from, jint key_from_len, jbyteArray key_to, jint key_to_len, jint start_level, jint max_output_level)
+{
+    DB* db = (DB*)handle;
+    if(!db) return 0;
+    std::string from, to;
+    GetKey(jenv, key_from, key_from_len, &from);
+    GetKey(jenv, key_to, key_to_len, &to);
+    Slice fromslice(from), toslice(to);
+    CompactRangeOptions opt;
+    opt.start_level = start_level;
+    opt.max_output_level = max_output_level;
+    CompactionJob* job = 0;
+    if(!db->CompactRangeAsync(opt, (from.empty() ? 0 : &fromslice), (to.empty() ? 0 : &toslice), &job).ok()) return 0;
+    MutexLock l(&g_compact_mutex);
+    g_compact_jobs.insert(std::make_pair(db, job));
+    return (jlong)job;
+}
+
+// public static native int leveldb_compact_progress(long job, long[] progress); // progress=[bytes_read, bytes_written, total_bytes(estimated), level]; return 0 for running, 1 for done, -1 for bad args
+extern "C" JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1compact_1progress)
+    (JNIEnv* jenv, jclass jcls, jlong job, jlongArray progress)
+{
+    CompactionJob* cj = (CompactionJob*)job;
+    if(!cj || !progress || jenv->GetArrayLength(progress) < 4) return -1;
+    CompactionProgress p;
+    cj->GetProgress(&p);
+    jlong v[4] = { (jlong)p.bytes_read, (jlong)p.bytes_written, (jlong)p.total_bytes, (jlong)p.level };
+    jenv->SetLongArrayRegion(progress, 0, 4, v);
+    return p.done ? 1 : 0;
+}
+
+// public static native void leveldb_compact_cancel(long job); // stops before the next output file; returns at once
+extern "C" JNIEXPORT void JNICALL DEF_JAVA(leveldb_1compact_1cancel)
+    (JNIEnv* jenv, jclass jcls, jlong job)
+{
+    CompactionJob* cj = (CompactionJob*)job;
+    if(cj) cj->Cancel();
+}
+
+// public static native void leveldb_compact_free(long job); // cancels and waits for the job if still running
+extern "C" JNIEXPORT void JNICALL DEF_JAVA(leveldb_1compact_1free)
+    (JNIEnv* jenv, jclass jcls, jlong job)
+{
+    CompactionJob* cj = (CompactionJob*)job;
+    if(!cj) return;
+    {
+        MutexLock l(&g_compact_mutex);
+        for(std::multimap<DB*, CompactionJob*>::iterator it = g_compact_jobs.begin(); it != g_compact_jobs.end(); ++it)
+        {
+            if(it->second == cj)
+            {
+                g_compact_jobs.erase(it);
+                break;
+            }
+        }
+    }
+    delete cj;
+}
+
 // public static native String leveldb_property(long handle, String property);
 extern "C" JNIEXPORT jstring JNICALL DEF_JAVA(leveldb_1property)
     (JNIEnv* jenv, jclass jcls, jlong handle, jstring property)
@@ -562,4 +1411,27 @@ extern "C" JNIEXPORT jstring JNICALL DEF_JAVA(leveldb_1property)
     return r ? jenv->NewStringUTF(result.c_str()) : 0;
 }
 
+// public static native long[] leveldb_memory_usage(long handle); // return null for error
+// [0]mem_table [1]imm_mem_table [2]mem_table_unused [3]table_readers [4]iterator_blocks
+// [5]block_cache [6]compressed_block_cache [7]row_cache [8..]level_filters of level 0,1,...
+extern "C" JNIEXPORT jlongArray JNICALL DEF_JAVA(leveldb_1memory_1usage)
+    (JNIEnv* jenv, jclass jcls, jlong handle)
+{
+    DB* db = (DB*)handle;
+    if(!db) return 0;
+    MemoryUsage usage;
+    if(!db->GetMemoryUsage(&usage).ok()) return 0;
+    jlong values[8 + config::kNumLevels] = {
+        (jlong)usage.mem_table, (jlong)usage.imm_mem_table, (jlong)usage.mem_table_unused,
+        (jlong)usage.table_readers, (jlong)usage.iterator_blocks, (jlong)usage.block_cache,
+        (jlong)usage.compressed_block_cache, (jlong)usage.row_cache };
+    const jsize n = (jsize)(8 + usage.level_filters.size());
+    if(n > (jsize)(sizeof(values) / sizeof(*values))) return 0;
+    for(size_t i = 0; i < usage.level_filters.size(); ++i)
+        values[8 + i] = (jlong)usage.level_filters[i];
+    jlongArray result = jenv->NewLongArray(n);
+    if(result) jenv->SetLongArrayRegion(result, 0, n, values);
+    return result;
+}
+
 #endif
@@ -0,0 +1,184 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <jni.h>
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "leveldb/write_batch.h"
+#include "db/write_batch_internal.h"
+#include "util/testutil.h"
+
+#define DEF_JAVA(F) Java_jane_core_StorageLevelDB_##F
+
+extern "C" {
+JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1write_1async)(JNIEnv*, jclass, jlong,
+                                                         jbyteArray, jint);
+JNIEXPORT jlong JNICALL DEF_JAVA(leveldb_1write_1async_1done)(JNIEnv*, jclass,
+                                                               jlong);
+JNIEXPORT jint JNICALL DEF_JAVA(leveldb_1write_1async_1wait)(JNIEnv*, jclass,
+                                                              jlong, jlong);
+JNIEXPORT void JNICALL DEF_JAVA(leveldb_1close)(JNIEnv*, jclass, jlong);
+}
+
+namespace leveldb {
+
+namespace {
+
+// Fails appends to log files while fail_log_appends is set.
+class FailingEnv : public EnvWrapper {
+ public:
+  FailingEnv() : EnvWrapper(Env::Default()), fail_log_appends(false) {}
+
+  Status NewWritableFile(const std::string& fname,
+                         WritableFile** result) override {
+    Status s = target()->NewWritableFile(fname, result);
+    if (s.ok() && fname.size() > 4 &&
+        fname.compare(fname.size() - 4, 4, ".log") == 0) {
+      *result = new LogFile(this, *result);
+    }
+    return s;
+  }
+
+  std::atomic<bool> fail_log_appends;
+
+ private:
+  class LogFile : public WritableFile {
+   public:
+    LogFile(FailingEnv* env, WritableFile* base) : env_(env), base_(base) {}
+    ~LogFile() override { delete base_; }
+
+    Status Append(const Slice& data) override {
+      if (env_->fail_log_appends.load(std::memory_order_acquire)) {
+        return Status::IOError("simulated log append error");
+      }
+      return base_->Append(data);
+    }
+    Status Close() override { return base_->Close(); }
+    Status Flush() override { return base_->Flush(); }
+    Status Sync() override { return base_->Sync(); }
+
+   private:
+    FailingEnv* const env_;
+    WritableFile* const base_;
+  };
+};
+
+// Just enough of a JNIEnv for the byte array access of the async writes:
+// a jbyteArray is a std::string.
+jsize JNICALL GetArrayLength(JNIEnv*, jarray array) {
+  return static_cast<jsize>(reinterpret_cast<std::string*>(array)->size());
+}
+
+void JNICALL GetByteArrayRegion(JNIEnv*, jbyteArray array, jsize start,
+                                jsize len, jbyte* buf) {
+  std::memcpy(buf, reinterpret_cast<std::string*>(array)->data() + start, len);
+}
+
+}  // namespace
+
+class JniTest : public testing::Test {
+ public:
+  JniTest() : db_(nullptr) {
+    std::memset(&functions_, 0, sizeof(functions_));
+    functions_.GetArrayLength = GetArrayLength;
+    functions_.GetByteArrayRegion = GetByteArrayRegion;
+    jenv_.functions = &functions_;
+
+    dbname_ = testing::TempDir() + "jni_test";
+    DestroyDB(dbname_, Options());
+    Options options;
+    options.env = &env_;
+    options.create_if_missing = true;
+    EXPECT_LEVELDB_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  ~JniTest() {
+    DEF_JAVA(leveldb_1close)(&jenv_, nullptr, handle());
+    DestroyDB(dbname_, Options());
+  }
+
+  jlong handle() { return reinterpret_cast<jlong>(db_); }
+
+  // Submit a batch putting "key" in the layout of leveldb_write_direct:
+  // the WriteBatch contents after the sequence number.
+  jlong WriteAsync(const std::string& key) {
+    WriteBatch batch;
+    batch.Put(key, "v");
+    std::string buf = WriteBatchInternal::Contents(&batch).ToString();
+    buf.erase(0, 8);
+    return DEF_JAVA(leveldb_1write_1async)(
+        &jenv_, nullptr, handle(), reinterpret_cast<jbyteArray>(&buf),
+        static_cast<jint>(buf.size()));
+  }
+
+  jint Wait(jlong ticket) {
+    return DEF_JAVA(leveldb_1write_1async_1wait)(&jenv_, nullptr, handle(),
+                                                 ticket);
+  }
+
+  jlong Done() {
+    return DEF_JAVA(leveldb_1write_1async_1done)(&jenv_, nullptr, handle());
+  }
+
+  FailingEnv env_;
+  JNINativeInterface_ functions_;
+  JNIEnv jenv_;
+  std::string dbname_;
+  DB* db_;
+};
+
+TEST_F(JniTest, AsyncWriteFailureIsReported) {
+  env_.fail_log_appends.store(true, std::memory_order_release);
+  ASSERT_EQ(1, WriteAsync("k1"));
+  ASSERT_EQ(5, Wait(1));
+  ASSERT_EQ(2, WriteAsync("k2"));
+  ASSERT_EQ(3, WriteAsync("k3"));
+  ASSERT_EQ(5, Wait(3));
+  env_.fail_log_appends.store(false, std::memory_order_release);
+  ASSERT_EQ(4, WriteAsync("k4"));
+  ASSERT_EQ(5, WriteAsync("k5"));
+  ASSERT_EQ(0, Wait(5));
+
+  // The failures are reported before later successes hide them, once.
+  ASSERT_EQ(-1, Done());
+  ASSERT_EQ(5, Done());
+  ASSERT_EQ(5, Wait(2));
+  ASSERT_EQ(0, Wait(4));
+
+  // A failure after a reported one is reported on its own.
+  env_.fail_log_appends.store(true, std::memory_order_release);
+  ASSERT_EQ(6, WriteAsync("k6"));
+  ASSERT_EQ(5, Wait(6));
+  env_.fail_log_appends.store(false, std::memory_order_release);
+  ASSERT_EQ(-6, Done());
+  ASSERT_EQ(6, Done());
+
+  std::string value;
+  ASSERT_TRUE(db_->Get(ReadOptions(), "k3", &value).IsNotFound());
+  ASSERT_LEVELDB_OK(db_->Get(ReadOptions(), "k5", &value));
+}
+
+TEST_F(JniTest, AsyncWriteRejectsMalformedBatch) {
+  std::string buf("\x01\x00\x00\x00\x01", 5);  // One put, key missing
+  ASSERT_EQ(-3, DEF_JAVA(leveldb_1write_1async)(
+                    &jenv_, nullptr, handle(),
+                    reinterpret_cast<jbyteArray>(&buf),
+                    static_cast<jint>(buf.size())));
+  ASSERT_EQ(1, WriteAsync("k1"));
+  ASSERT_EQ(0, Wait(1));
+  ASSERT_EQ(1, Done());
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,352 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// The cache is a sequence of numbered files, each a run of records
+//
+//    crc: fixed32        (masked crc32c of the rest of the record)
+//    key_length: fixed32
+//    data_length: fixed32
+//    key: char[key_length]
+//    data: char[data_length]
+//
+// Records are appended to an in-memory buffer that is written out as the
+// next file once it reaches the file size, so files are only ever written
+// sequentially and never read while being written.  The buffer is written
+// by the thread whose insert filled it, outside the lock, and its records
+// are read from memory until the file is open.  An in-memory index maps
+// each key to the location of its record.  When the files exceed the
+// capacity the oldest one is deleted along with its keys.
+
+#include "leveldb/persistent_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+PersistentCache::~PersistentCache() = default;
+
+namespace {
+
+static const size_t kHeaderSize = 12;
+static const size_t kMinFileSize = 64 << 10;
+static const size_t kMaxFileSize = 4 << 20;
+
+static const char kFileSuffix[] = ".pcache";
+
+static bool IsCacheFile(const std::string& name) {
+  const size_t n = sizeof(kFileSuffix) - 1;
+  return name.size() > n && name.compare(name.size() - n, n, kFileSuffix) == 0;
+}
+
+// An eighth of the capacity, so eviction drops a small part of the cache.
+static size_t CacheFileSize(size_t capacity) {
+  return std::min(std::max(std::min(capacity / 8, kMaxFileSize), kMinFileSize),
+                  capacity);
+}
+
+// A full buffer of records, being written out as a file or already written.
+struct CacheFile {
+  uint64_t number;
+  uint64_t size;
+  RandomAccessFile* file;         // Null while being written
+  std::string buffer;             // The records while file is null
+  int refs;                       // The cache's own plus those of readers
+  std::vector<std::string> keys;  // Keys whose records are in this file
+};
+
+class FilePersistentCache : public PersistentCache {
+ public:
+  FilePersistentCache(Env* env, const std::string& dir, size_t capacity)
+      : env_(env),
+        dir_(dir),
+        capacity_(capacity),
+        file_size_(CacheFileSize(capacity)),
+        next_number_(1),
+        last_id_(0),
+        usage_(0) {}
+
+  ~FilePersistentCache() override {
+    for (CacheFile* f : files_) {
+      Unref(f);
+    }
+  }
+
+  Status Insert(const Slice& key, const Slice& data) override;
+  Status Lookup(const Slice& key, std::string* data) override;
+
+  size_t TotalSize() const override {
+    MutexLock l(&mutex_);
+    return usage_;
+  }
+
+  uint64_t NewId() override {
+    MutexLock l(&mutex_);
+    return ++last_id_;
+  }
+
+  // Removes the files left in the directory by an earlier cache.
+  Status Init();
+
+ private:
+  // Location of a record.  "file" is null for records still in active_.
+  struct Location {
+    CacheFile* file;
+    uint64_t offset;
+    size_t size;
+  };
+
+  std::string FileName(uint64_t number) const {
+    char buf[30];
+    std::snprintf(buf, sizeof(buf), "/%06llu%s",
+                  static_cast<unsigned long long>(number), kFileSuffix);
+    return dir_ + buf;
+  }
+
+  // Moves active_ to a new CacheFile, which the caller must pass to
+  // WriteFile() once it has released the lock.
+  CacheFile* SealActiveFile() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Writes out the buffer of "f" and opens the file to serve its records.
+  // Its records are dropped from the index if that fails.
+  void WriteFile(CacheFile* f) LOCKS_EXCLUDED(mutex_);
+
+  // Deletes the oldest files until usage_ is within capacity_.
+  void Evict() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void Unref(CacheFile* f);
+
+  // Checks the record "record" and, if it is the one for "key", stores its
+  // data in *data.
+  static Status ParseRecord(const Slice& record, const Slice& key,
+                            std::string* data);
+
+  Env* const env_;
+  const std::string dir_;
+  const size_t capacity_;
+  const size_t file_size_;
+
+  mutable port::Mutex mutex_;
+  uint64_t next_number_ GUARDED_BY(mutex_);
+  uint64_t last_id_ GUARDED_BY(mutex_);
+  size_t usage_ GUARDED_BY(mutex_);
+  std::string active_ GUARDED_BY(mutex_);
+  std::vector<std::string> active_keys_ GUARDED_BY(mutex_);
+  std::deque<CacheFile*> files_ GUARDED_BY(mutex_);  // Oldest first
+  std::unordered_map<std::string, Location> index_ GUARDED_BY(mutex_);
+};
+
+Status FilePersistentCache::Init() {
+  env_->CreateDir(dir_);  // Ignore error: it may already exist
+  std::vector<std::string> children;
+  Status s = env_->GetChildren(dir_, &children);
+  if (!s.ok()) {
+    return s;
+  }
+  for (const std::string& child : children) {
+    if (IsCacheFile(child)) {
+      env_->RemoveFile(dir_ + "/" + child);
+    }
+  }
+  return Status::OK();
+}
+
+Status FilePersistentCache::Insert(const Slice& key, const Slice& data) {
+  const size_t record_size = kHeaderSize + key.size() + data.size();
+  if (record_size > capacity_) {
+    return Status::InvalidArgument("too large to cache");
+  }
+
+  CacheFile* sealed = nullptr;
+  {
+    MutexLock l(&mutex_);
+    const std::string key_string = key.ToString();
+    if (index_.find(key_string) != index_.end()) {
+      return Status::OK();
+    }
+    if (!active_.empty() && active_.size() + record_size > file_size_) {
+      sealed = SealActiveFile();
+    }
+
+    Location loc;
+    loc.file = nullptr;
+    loc.offset = active_.size();
+    loc.size = record_size;
+    active_.resize(active_.size() + 4);  // Room for the crc
+    PutFixed32(&active_, static_cast<uint32_t>(key.size()));
+    PutFixed32(&active_, static_cast<uint32_t>(data.size()));
+    active_.append(key.data(), key.size());
+    active_.append(data.data(), data.size());
+    EncodeFixed32(&active_[loc.offset],
+                  crc32c::Mask(crc32c::Value(active_.data() + loc.offset + 4,
+                                             record_size - 4)));
+    active_keys_.push_back(key_string);
+    index_[key_string] = loc;
+    usage_ += record_size;
+    Evict();
+  }
+  if (sealed != nullptr) {
+    WriteFile(sealed);
+  }
+  return Status::OK();
+}
+
+Status FilePersistentCache::Lookup(const Slice& key, std::string* data) {
+  Location loc;
+  {
+    MutexLock l(&mutex_);
+    auto it = index_.find(key.ToString());
+    if (it == index_.end()) {
+      return Status::NotFound(Slice());
+    }
+    loc = it->second;
+    if (loc.file == nullptr) {
+      return ParseRecord(Slice(active_.data() + loc.offset, loc.size), key,
+                         data);
+    }
+    if (loc.file->file == nullptr) {
+      return ParseRecord(
+          Slice(loc.file->buffer.data() + loc.offset, loc.size), key, data);
+    }
+    loc.file->refs++;
+  }
+
+  // Read without holding the lock; the reference keeps the file open
+  // even if it is evicted meanwhile.
+  std::string scratch;
+  scratch.resize(loc.size);
+  Slice record;
+  Status s = loc.file->file->Read(loc.offset, loc.size, &record, &scratch[0]);
+  if (s.ok()) {
+    if (record.size() != loc.size) {
+      s = Status::Corruption("truncated persistent cache record");
+    } else {
+      s = ParseRecord(record, key, data);
+    }
+  }
+  MutexLock l(&mutex_);
+  Unref(loc.file);
+  return s;
+}
+
+Status FilePersistentCache::ParseRecord(const Slice& record, const Slice& key,
+                                        std::string* data) {
+  const char* p = record.data();
+  const uint32_t crc = crc32c::Unmask(DecodeFixed32(p));
+  const uint32_t key_length = DecodeFixed32(p + 4);
+  const uint32_t data_length = DecodeFixed32(p + 8);
+  if (crc32c::Value(p + 4, record.size() - 4) != crc ||
+      kHeaderSize + key_length + data_length != record.size() ||
+      Slice(p + kHeaderSize, key_length) != key) {
+    return Status::Corruption("bad persistent cache record");
+  }
+  data->assign(p + kHeaderSize + key_length, data_length);
+  return Status::OK();
+}
+
+CacheFile* FilePersistentCache::SealActiveFile() {
+  CacheFile* f = new CacheFile;
+  f->number = next_number_++;
+  f->size = active_.size();
+  f->file = nullptr;
+  f->buffer.swap(active_);
+  f->refs = 2;  // The cache's own and WriteFile()'s
+  f->keys.swap(active_keys_);
+  for (const std::string& key : f->keys) {
+    index_[key].file = f;
+  }
+  files_.push_back(f);
+  return f;
+}
+
+void FilePersistentCache::WriteFile(CacheFile* f) {
+  // f->buffer does not change until f->file is set under the lock.
+  const std::string fname = FileName(f->number);
+  WritableFile* out;
+  Status s = env_->NewWritableFile(fname, &out);
+  if (s.ok()) {
+    s = out->Append(f->buffer);
+    if (s.ok()) {
+      s = out->Close();
+    }
+    delete out;
+  }
+  RandomAccessFile* in = nullptr;
+  if (s.ok()) {
+    s = env_->NewRandomAccessFile(fname, &in);
+  }
+
+  MutexLock l(&mutex_);
+  if (s.ok()) {
+    f->file = in;
+    std::string().swap(f->buffer);
+  } else {
+    auto it = std::find(files_.begin(), files_.end(), f);
+    if (it != files_.end()) {  // Not evicted meanwhile
+      files_.erase(it);
+      for (const std::string& key : f->keys) {
+        auto index_it = index_.find(key);
+        if (index_it != index_.end() && index_it->second.file == f) {
+          index_.erase(index_it);
+        }
+      }
+      usage_ -= f->size;
+      Unref(f);
+    }
+  }
+  Unref(f);
+}
+
+void FilePersistentCache::Evict() {
+  while (usage_ > capacity_ && !files_.empty()) {
+    CacheFile* f = files_.front();
+    files_.pop_front();
+    for (const std::string& key : f->keys) {
+      auto it = index_.find(key);
+      // The key may have been evicted and cached again in a later file.
+      if (it != index_.end() && it->second.file == f) {
+        index_.erase(it);
+      }
+    }
+    usage_ -= f->size;
+    Unref(f);
+  }
+}
+
+void FilePersistentCache::Unref(CacheFile* f) {
+  assert(f->refs > 0);
+  if (--f->refs == 0) {
+    delete f->file;
+    env_->RemoveFile(FileName(f->number));
+    delete f;
+  }
+}
+
+}  // namespace
+
+Status NewPersistentCache(Env* env, const std::string& dir, size_t capacity,
+                          PersistentCache** result) {
+  *result = nullptr;
+  FilePersistentCache* cache = new FilePersistentCache(env, dir, capacity);
+  Status s = cache->Init();
+  if (s.ok()) {
+    *result = cache;
+  } else {
+    delete cache;
+  }
+  return s;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,160 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/persistent_cache.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+#include "util/coding.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+static std::string Key(int i) {
+  std::string result;
+  PutFixed32(&result, i);
+  return result;
+}
+
+static std::string Value(int i, size_t size) {
+  return std::string(size, static_cast<char>('a' + i % 26));
+}
+
+class PersistentCacheTest : public testing::Test {
+ public:
+  PersistentCacheTest() : env_(Env::Default()), cache_(nullptr) {
+    EXPECT_LEVELDB_OK(env_->GetTestDirectory(&dir_));
+    dir_ += "/persistent_cache_test";
+  }
+
+  ~PersistentCacheTest() { delete cache_; }
+
+  void Open(size_t capacity) {
+    delete cache_;
+    cache_ = nullptr;
+    ASSERT_LEVELDB_OK(NewPersistentCache(env_, dir_, capacity, &cache_));
+  }
+
+  std::string Lookup(int i) {
+    std::string data;
+    Status s = cache_->Lookup(Key(i), &data);
+    return s.ok() ? data : (s.IsNotFound() ? "NOT_FOUND" : s.ToString());
+  }
+
+  int CountFiles() {
+    std::vector<std::string> children;
+    EXPECT_LEVELDB_OK(env_->GetChildren(dir_, &children));
+    int count = 0;
+    for (const std::string& child : children) {
+      if (child.size() > 7 && child.substr(child.size() - 7) == ".pcache") {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  Env* env_;
+  std::string dir_;
+  PersistentCache* cache_;
+};
+
+TEST_F(PersistentCacheTest, InsertAndLookup) {
+  Open(1 << 20);
+  ASSERT_EQ("NOT_FOUND", Lookup(1));
+  ASSERT_LEVELDB_OK(cache_->Insert(Key(1), "one"));
+  ASSERT_LEVELDB_OK(cache_->Insert(Key(2), "two"));
+  ASSERT_EQ("one", Lookup(1));
+  ASSERT_EQ("two", Lookup(2));
+  ASSERT_EQ("NOT_FOUND", Lookup(3));
+
+  // An existing entry is kept.
+  ASSERT_LEVELDB_OK(cache_->Insert(Key(1), "uno"));
+  ASSERT_EQ("one", Lookup(1));
+  ASSERT_GT(cache_->TotalSize(), 0);
+}
+
+TEST_F(PersistentCacheTest, ReadsFromFiles) {
+  const size_t kValueSize = 1000;
+  Open(1 << 20);  // Files of 128KB
+  const int N = 500;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(cache_->Insert(Key(i), Value(i, kValueSize)));
+  }
+  ASSERT_GE(CountFiles(), 3);
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Value(i, kValueSize), Lookup(i)) << i;
+  }
+}
+
+TEST_F(PersistentCacheTest, EvictsOldestFiles) {
+  const size_t kCapacity = 1 << 20;
+  const size_t kValueSize = 1000;
+  Open(kCapacity);
+  const int N = 5000;  // About 5MB of records
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(cache_->Insert(Key(i), Value(i, kValueSize)));
+    ASSERT_LE(cache_->TotalSize(), kCapacity);
+  }
+  ASSERT_LE(CountFiles(), 8);
+  ASSERT_EQ("NOT_FOUND", Lookup(0));
+  for (int i = N - 500; i < N; i++) {
+    ASSERT_EQ(Value(i, kValueSize), Lookup(i)) << i;
+  }
+
+  // Records larger than the whole cache are refused.
+  ASSERT_TRUE(!cache_->Insert(Key(N), Value(N, kCapacity)).ok());
+  ASSERT_EQ("NOT_FOUND", Lookup(N));
+}
+
+TEST_F(PersistentCacheTest, ConcurrentInsertAndLookup) {
+  const size_t kValueSize = 1000;
+  const int kThreads = 4;
+  const int N = 1000;
+  Open(8 << 20);  // Files of 1MB, holding all records
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([this, t]() {
+      // Every insert of another thread may be writing out a file.
+      for (int i = t; i < kThreads * N; i += kThreads) {
+        EXPECT_LEVELDB_OK(cache_->Insert(Key(i), Value(i, kValueSize)));
+        for (int j = i % kThreads; j <= i; j += kThreads * 37) {
+          EXPECT_EQ(Value(j, kValueSize), Lookup(j)) << j;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  ASSERT_GE(CountFiles(), 3);
+  for (int i = 0; i < kThreads * N; i++) {
+    ASSERT_EQ(Value(i, kValueSize), Lookup(i)) << i;
+  }
+}
+
+TEST_F(PersistentCacheTest, StartsEmpty) {
+  Open(1 << 20);
+  for (int i = 0; i < 500; i++) {
+    ASSERT_LEVELDB_OK(cache_->Insert(Key(i), Value(i, 1000)));
+  }
+  ASSERT_GT(CountFiles(), 0);
+  delete cache_;
+  cache_ = nullptr;
+
+  // Files from an earlier cache are removed when a new one opens.
+  Open(1 << 20);
+  ASSERT_EQ(0, CountFiles());
+  ASSERT_EQ("NOT_FOUND", Lookup(0));
+  ASSERT_EQ(0, cache_->TotalSize());
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,256 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A standard Ribbon filter ("Ribbon filter: practically smaller than Bloom
+// and Xor", Dillinger & Walzer 2021).  Each key is hashed to a starting
+// slot, a 64-bit coefficient row and an r-bit result.  Construction solves
+// the linear system over GF(2) in which, for every key, the XOR of the
+// solution rows selected by its coefficients equals its result; a query
+// recomputes that XOR and compares.  A non-member matches with probability
+// 2^-r, and the solution takes only a few percent more than r bits per key,
+// so r = 7 gives the false positive rate of a 10 bits/key bloom filter.
+//
+// The filter is laid out as
+//
+//    [block 0: r words] ... [block N-1: r words]  : 8 bytes each, fixed64
+//    seed                                         : 1 byte
+//    r                                            : 1 byte
+//
+// Block k covers slots [64k, 64k+63]; its word j holds bit j of the
+// solution of each of those slots, so a query reads r words from at most
+// two adjacent blocks.  r == 0 marks a filter that matches every key,
+// written when no seed produced a solvable system.
+
+#include <cstdint>
+#include <vector>
+
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+
+static const int kCoeffBits = 64;  // Width of each key's coefficient row
+static const int kMaxResultBits = 16;
+static const int kMaxSeeds = 16;
+
+static inline uint64_t Mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+static inline int CountTrailingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(x);
+#else
+  int n = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+static inline uint32_t Parity(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<uint32_t>(__builtin_parityll(x));
+#else
+  x ^= x >> 32;
+  x ^= x >> 16;
+  x ^= x >> 8;
+  x ^= x >> 4;
+  x ^= x >> 2;
+  x ^= x >> 1;
+  return static_cast<uint32_t>(x & 1);
+#endif
+}
+
+// The seed-independent part of a key's hash; computed once per key.
+static uint64_t RibbonHash(const Slice& key) {
+  const uint64_t lo = Hash(key.data(), key.size(), 0xbc9f1d34);
+  const uint64_t hi = Hash(key.data(), key.size(), 0x7a2c6e15);
+  return (hi << 32) | lo;
+}
+
+struct RibbonRow {
+  uint32_t start;
+  uint32_t result;
+  uint64_t coeff;
+};
+
+static inline RibbonRow DeriveRow(uint64_t hash, uint32_t seed,
+                                  uint32_t num_starts, int r) {
+  RibbonRow row;
+  const uint64_t h = Mix64(hash + seed * 0x9e3779b97f4a7c15ull);
+  row.start = static_cast<uint32_t>(((h >> 32) * num_starts) >> 32);
+  row.result = static_cast<uint32_t>(h) & ((1u << r) - 1);
+  // The first coefficient is always set so the row begins at its start.
+  row.coeff = Mix64(h ^ 0x2545f4914f6cdd1dull) | 1;
+  return row;
+}
+
+// Number of slots, a multiple of kCoeffBits, to use for "n" keys.  Width 64
+// bands on the first seed with about 8% spare slots up to millions of keys;
+// the fixed slack covers small filters and each retry adds a little more.
+static size_t NumSlots(size_t n, int attempt) {
+  size_t slots = n + n / 12 + n / 64 * attempt + kCoeffBits / 2;
+  slots = (slots + kCoeffBits - 1) / kCoeffBits * kCoeffBits;
+  return slots < static_cast<size_t>(kCoeffBits) ? kCoeffBits : slots;
+}
+
+class RibbonFilterPolicy : public FilterPolicy {
+ public:
+  explicit RibbonFilterPolicy(int bits_per_key) {
+    // Match the false positive rate of a bloom filter with the same
+    // bits_per_key: 2^-r == 0.6185^bits_per_key.
+    r_ = static_cast<int>(bits_per_key * 0.69 + 0.5);  // 0.69 =~ ln(2)
+    if (r_ < 1) r_ = 1;
+    if (r_ > kMaxResultBits) r_ = kMaxResultBits;
+  }
+
+  const char* Name() const override { return "leveldb.RibbonFilter"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    std::vector<uint64_t> hashes(n);
+    for (int i = 0; i < n; i++) {
+      hashes[i] = RibbonHash(keys[i]);
+    }
+
+    std::vector<uint64_t> coeffs;
+    std::vector<uint32_t> results;
+    for (int seed = 0; seed < kMaxSeeds; seed++) {
+      const size_t slots = NumSlots(n, seed / 4);
+      if (Band(hashes, seed, slots, &coeffs, &results)) {
+        Solve(coeffs, results, seed, dst);
+        return;
+      }
+    }
+
+    // Practically unreachable; fall back to a filter that matches all keys.
+    dst->push_back(0);  // seed
+    dst->push_back(0);  // r
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& filter) const override {
+    const size_t len = filter.size();
+    if (len < 2) return false;
+
+    const char* array = filter.data();
+    const int r = static_cast<unsigned char>(array[len - 1]);
+    const uint32_t seed = static_cast<unsigned char>(array[len - 2]);
+    if (r == 0 || r > kMaxResultBits) {
+      // Unsolved filter or reserved encoding.  Consider it a match.
+      return true;
+    }
+    const size_t block_bytes = 8 * r;
+    if ((len - 2) % block_bytes != 0 || len - 2 < block_bytes) return true;
+    const size_t slots = (len - 2) / block_bytes * kCoeffBits;
+
+    const RibbonRow row = DeriveRow(
+        RibbonHash(key), seed, static_cast<uint32_t>(slots - kCoeffBits + 1),
+        r);
+    const size_t block = row.start / kCoeffBits;
+    const int shift = row.start % kCoeffBits;
+    const char* lo = array + block * block_bytes;
+    const char* hi = lo + block_bytes;
+    for (int j = 0; j < r; j++) {
+      uint64_t bits = DecodeFixed64(lo + 8 * j) >> shift;
+      if (shift != 0) {
+        bits |= DecodeFixed64(hi + 8 * j) << (kCoeffBits - shift);
+      }
+      if (Parity(bits & row.coeff) != ((row.result >> j) & 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  // Gaussian elimination on the fly: each row is reduced against the rows
+  // already placed until it lands on a free pivot slot.  Returns false if
+  // some key's equation is inconsistent with the others.
+  bool Band(const std::vector<uint64_t>& hashes, uint32_t seed, size_t slots,
+            std::vector<uint64_t>* coeffs,
+            std::vector<uint32_t>* results) const {
+    coeffs->assign(slots, 0);
+    results->assign(slots, 0);
+    const uint32_t num_starts = static_cast<uint32_t>(slots - kCoeffBits + 1);
+    for (size_t k = 0; k < hashes.size(); k++) {
+      RibbonRow row = DeriveRow(hashes[k], seed, num_starts, r_);
+      size_t i = row.start;
+      for (;;) {
+        if ((*coeffs)[i] == 0) {
+          (*coeffs)[i] = row.coeff;
+          (*results)[i] = row.result;
+          break;
+        }
+        row.coeff ^= (*coeffs)[i];
+        row.result ^= (*results)[i];
+        if (row.coeff == 0) {
+          // Duplicate keys reduce to 0 == 0; anything else is unsolvable.
+          if (row.result != 0) return false;
+          break;
+        }
+        const int tz = CountTrailingZeros(row.coeff);
+        i += tz;
+        row.coeff >>= tz;
+      }
+    }
+    return true;
+  }
+
+  // Back substitution from the last slot down, appending the solution in
+  // the interleaved layout described at the top of this file.
+  void Solve(const std::vector<uint64_t>& coeffs,
+             const std::vector<uint32_t>& results, uint32_t seed,
+             std::string* dst) const {
+    const size_t slots = coeffs.size();
+    const size_t num_blocks = slots / kCoeffBits;
+    const size_t init_size = dst->size();
+    dst->resize(init_size + num_blocks * 8 * r_);
+    char* array = &(*dst)[init_size];
+
+    // state[j] bit t is bit j of the solution of slot i + t.
+    uint64_t state[kMaxResultBits] = {0};
+    for (size_t i = slots; i-- > 0;) {
+      const uint64_t c = coeffs[i];
+      // Free slots may hold anything; pseudo-random keeps the false
+      // positive rate at 2^-r for queries that land on them.
+      const uint32_t value =
+          c == 0 ? static_cast<uint32_t>(Mix64(i + seed)) : results[i];
+      for (int j = 0; j < r_; j++) {
+        state[j] <<= 1;
+        uint32_t bit = (value >> j) & 1;
+        if (c != 0) bit ^= Parity(c & state[j]);
+        state[j] |= bit;
+      }
+      if (i % kCoeffBits == 0) {
+        char* block = array + (i / kCoeffBits) * 8 * r_;
+        for (int j = 0; j < r_; j++) {
+          EncodeFixed64(block + 8 * j, state[j]);
+        }
+      }
+    }
+    dst->push_back(static_cast<char>(seed));
+    dst->push_back(static_cast<char>(r_));
+  }
+
+  int r_;
+};
+
+}  // namespace
+
+const FilterPolicy* NewRibbonFilterPolicy(int bits_per_key) {
+  return new RibbonFilterPolicy(bits_per_key);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,206 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "benchmark/benchmark.h"
+#include "leveldb/filter_policy.h"
+#include "util/coding.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+static const int kVerbose = 1;
+
+static Slice Key(int i, char* buffer) {
+  EncodeFixed32(buffer, i);
+  return Slice(buffer, sizeof(uint32_t));
+}
+
+class RibbonFilterTest : public testing::Test {
+ public:
+  RibbonFilterTest() : policy_(NewRibbonFilterPolicy(10)) {}
+
+  ~RibbonFilterTest() { delete policy_; }
+
+  void Reset() {
+    keys_.clear();
+    filter_.clear();
+  }
+
+  void Add(const Slice& s) { keys_.push_back(s.ToString()); }
+
+  void Build() {
+    std::vector<Slice> key_slices;
+    for (size_t i = 0; i < keys_.size(); i++) {
+      key_slices.push_back(Slice(keys_[i]));
+    }
+    filter_.clear();
+    policy_->CreateFilter(key_slices.data(),
+                          static_cast<int>(key_slices.size()), &filter_);
+    keys_.clear();
+  }
+
+  size_t FilterSize() const { return filter_.size(); }
+
+  bool Matches(const Slice& s) {
+    if (!keys_.empty()) {
+      Build();
+    }
+    return policy_->KeyMayMatch(s, filter_);
+  }
+
+  double FalsePositiveRate() {
+    char buffer[sizeof(int)];
+    int result = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (Matches(Key(i + 1000000000, buffer))) {
+        result++;
+      }
+    }
+    return result / 10000.0;
+  }
+
+ private:
+  const FilterPolicy* policy_;
+  std::string filter_;
+  std::vector<std::string> keys_;
+};
+
+TEST_F(RibbonFilterTest, EmptyFilter) {
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(RibbonFilterTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(RibbonFilterTest, DuplicateKeys) {
+  for (int i = 0; i < 1000; i++) {
+    Add("same");
+    Add("other");
+  }
+  ASSERT_TRUE(Matches("same"));
+  ASSERT_TRUE(Matches("other"));
+}
+
+TEST_F(RibbonFilterTest, LargeFilters) {
+  char buffer[sizeof(int)];
+  for (int length = 1000; length <= 200000; length *= 5) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    // A 10 bits/key bloom filter is length * 10 / 8 bytes; ribbon must
+    // reach the same false positive rate in well under that.
+    const double bits_per_key = FilterSize() * 8.0 / length;
+    ASSERT_LE(bits_per_key, 8.5) << length;
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+    }
+
+    double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      std::fprintf(stderr,
+                   "False positives: %5.2f%% @ length = %6d ; bits/key = %.2f\n",
+                   rate * 100.0, length, bits_per_key);
+    }
+    ASSERT_LE(rate, 0.0125);
+  }
+}
+
+TEST_F(RibbonFilterTest, ReservedEncodings) {
+  const FilterPolicy* policy = NewRibbonFilterPolicy(10);
+  // r == 0 is the unsolved filter; r > 16 is reserved.  Both match.
+  ASSERT_TRUE(policy->KeyMayMatch("foo", std::string("\0\0", 2)));
+  ASSERT_TRUE(policy->KeyMayMatch("foo", std::string("\0\x20", 2)));
+  delete policy;
+}
+
+// Construction and query cost of each policy at 10 bits/key.
+// Arg 0 selects the policy: 0 = bloom, 1 = blocked bloom, 2 = ribbon.
+static const FilterPolicy* NewBenchmarkPolicy(int type) {
+  switch (type) {
+    case 0:
+      return NewBloomFilterPolicy(10);
+    case 1:
+      return NewBlockedBloomFilterPolicy(10);
+    default:
+      return NewRibbonFilterPolicy(10);
+  }
+}
+
+static void MakeBenchmarkKeys(int n, std::vector<std::string>* keys,
+                              std::vector<Slice>* slices) {
+  char buffer[sizeof(int)];
+  for (int i = 0; i < n; i++) {
+    keys->push_back(Key(i, buffer).ToString());
+  }
+  for (size_t i = 0; i < keys->size(); i++) {
+    slices->push_back(Slice((*keys)[i]));
+  }
+}
+
+static void BM_FilterBuild(benchmark::State& state) {
+  const FilterPolicy* policy = NewBenchmarkPolicy(state.range(0));
+  const int n = state.range(1);
+  std::vector<std::string> keys;
+  std::vector<Slice> slices;
+  MakeBenchmarkKeys(n, &keys, &slices);
+
+  std::string filter;
+  for (auto st : state) {
+    filter.clear();
+    policy->CreateFilter(slices.data(), n, &filter);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.SetLabel(policy->Name());
+  delete policy;
+}
+
+static void BM_FilterQuery(benchmark::State& state) {
+  const FilterPolicy* policy = NewBenchmarkPolicy(state.range(0));
+  const int n = state.range(1);
+  std::vector<std::string> keys;
+  std::vector<Slice> slices;
+  MakeBenchmarkKeys(n, &keys, &slices);
+  std::string filter;
+  policy->CreateFilter(slices.data(), n, &filter);
+
+  // Mostly absent keys, as in a lookup that misses most tables.
+  char buffer[sizeof(int)];
+  int i = 0;
+  int matches = 0;
+  for (auto st : state) {
+    matches += policy->KeyMayMatch(Key(n + (i++ & 0xfffff), buffer), filter);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(policy->Name());
+  benchmark::DoNotOptimize(matches);
+  delete policy;
+}
+
+BENCHMARK(BM_FilterBuild)->ArgsProduct({{0, 1, 2}, {10000, 1000000}});
+BENCHMARK(BM_FilterQuery)->ArgsProduct({{0, 1, 2}, {10000, 1000000}});
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return RUN_ALL_TESTS();
+}